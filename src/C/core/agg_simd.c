@@ -0,0 +1,397 @@
+/* agg_simd.c - Vectorized aggregation kernels with runtime dispatch */
+
+#include "agg_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AGG_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*StatsI64Fn)(const int64_t *, size_t, int64_t *, int64_t *, int64_t *);
+typedef void (*StatsF64Fn)(const double *, size_t, double *, double *, double *);
+typedef int64_t (*SumI64Fn)(const int64_t *, size_t);
+typedef double (*SumF64Fn)(const double *, size_t);
+
+typedef struct {
+    const char *name;
+    StatsI64Fn stats_i64;
+    StatsF64Fn stats_f64;
+    SumI64Fn sum_i64;
+    SumF64Fn sum_f64;
+} AggImpl;
+
+/* ========== Scalar Kernels ========== */
+
+/* All kernels below are only called with n >= 1 */
+
+static void stats_i64_scalar(const int64_t *v, size_t n,
+                             int64_t *sum, int64_t *min, int64_t *max) {
+    uint64_t s = 0;
+    int64_t lo = v[0], hi = v[0];
+    for (size_t i = 0; i < n; i++) {
+        s += (uint64_t)v[i];
+        lo = v[i] < lo ? v[i] : lo;
+        hi = v[i] > hi ? v[i] : hi;
+    }
+    *sum = (int64_t)s;
+    *min = lo;
+    *max = hi;
+}
+
+static void stats_f64_scalar(const double *v, size_t n,
+                             double *sum, double *min, double *max) {
+    double s = 0.0, lo = v[0], hi = v[0];
+    for (size_t i = 0; i < n; i++) {
+        s += v[i];
+        lo = v[i] < lo ? v[i] : lo;
+        hi = v[i] > hi ? v[i] : hi;
+    }
+    *sum = s;
+    *min = lo;
+    *max = hi;
+}
+
+static int64_t sum_i64_scalar(const int64_t *v, size_t n) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += (uint64_t)v[i];
+        s1 += (uint64_t)v[i + 1];
+        s2 += (uint64_t)v[i + 2];
+        s3 += (uint64_t)v[i + 3];
+    }
+    for (; i < n; i++) s0 += (uint64_t)v[i];
+    return (int64_t)(s0 + s1 + s2 + s3);
+}
+
+static double sum_f64_scalar(const double *v, size_t n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += v[i];
+        s1 += v[i + 1];
+        s2 += v[i + 2];
+        s3 += v[i + 3];
+    }
+    for (; i < n; i++) s0 += v[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static const AggImpl agg_scalar = {
+    "scalar", stats_i64_scalar, stats_f64_scalar, sum_i64_scalar, sum_f64_scalar
+};
+
+#ifdef AGG_HAVE_X86
+
+/* ========== SSE2 Kernels (x86-64 baseline) ========== */
+
+/* Signed 64-bit a > b built from 32-bit compares (pcmpgtq is SSE4.2) */
+static inline __m128i sse2_cmpgt_epi64(__m128i a, __m128i b) {
+    const __m128i low_sign = _mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000);
+    __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, low_sign), _mm_xor_si128(b, low_sign));
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    __m128i gt_lo = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128i gt_hi = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128i eq_hi = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+    return _mm_or_si128(gt_hi, _mm_and_si128(eq_hi, gt_lo));
+}
+
+static inline __m128i sse2_select(__m128i mask, __m128i yes, __m128i no) {
+    return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+}
+
+static void stats_i64_sse2(const int64_t *v, size_t n,
+                           int64_t *sum, int64_t *min, int64_t *max) {
+    __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+    __m128i lo = _mm_set1_epi64x(v[0]), hi = lo;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(v + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(v + i + 2));
+        s0 = _mm_add_epi64(s0, a);
+        s1 = _mm_add_epi64(s1, b);
+        lo = sse2_select(sse2_cmpgt_epi64(lo, a), a, lo);
+        lo = sse2_select(sse2_cmpgt_epi64(lo, b), b, lo);
+        hi = sse2_select(sse2_cmpgt_epi64(a, hi), a, hi);
+        hi = sse2_select(sse2_cmpgt_epi64(b, hi), b, hi);
+    }
+
+    int64_t ls[2], ll[2], lh[2];
+    _mm_storeu_si128((__m128i *)ls, _mm_add_epi64(s0, s1));
+    _mm_storeu_si128((__m128i *)ll, lo);
+    _mm_storeu_si128((__m128i *)lh, hi);
+
+    uint64_t s = (uint64_t)ls[0] + (uint64_t)ls[1];
+    int64_t rlo = ll[0] < ll[1] ? ll[0] : ll[1];
+    int64_t rhi = lh[0] > lh[1] ? lh[0] : lh[1];
+    for (; i < n; i++) {
+        s += (uint64_t)v[i];
+        rlo = v[i] < rlo ? v[i] : rlo;
+        rhi = v[i] > rhi ? v[i] : rhi;
+    }
+
+    *sum = (int64_t)s;
+    *min = rlo;
+    *max = rhi;
+}
+
+static void stats_f64_sse2(const double *v, size_t n,
+                           double *sum, double *min, double *max) {
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    __m128d lo = _mm_set1_pd(v[0]), hi = lo;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128d a = _mm_loadu_pd(v + i);
+        __m128d b = _mm_loadu_pd(v + i + 2);
+        s0 = _mm_add_pd(s0, a);
+        s1 = _mm_add_pd(s1, b);
+        lo = _mm_min_pd(lo, _mm_min_pd(a, b));
+        hi = _mm_max_pd(hi, _mm_max_pd(a, b));
+    }
+
+    double ls[2], ll[2], lh[2];
+    _mm_storeu_pd(ls, _mm_add_pd(s0, s1));
+    _mm_storeu_pd(ll, lo);
+    _mm_storeu_pd(lh, hi);
+
+    double s = ls[0] + ls[1];
+    double rlo = ll[0] < ll[1] ? ll[0] : ll[1];
+    double rhi = lh[0] > lh[1] ? lh[0] : lh[1];
+    for (; i < n; i++) {
+        s += v[i];
+        rlo = v[i] < rlo ? v[i] : rlo;
+        rhi = v[i] > rhi ? v[i] : rhi;
+    }
+
+    *sum = s;
+    *min = rlo;
+    *max = rhi;
+}
+
+static int64_t sum_i64_sse2(const int64_t *v, size_t n) {
+    __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_epi64(s0, _mm_loadu_si128((const __m128i *)(v + i)));
+        s1 = _mm_add_epi64(s1, _mm_loadu_si128((const __m128i *)(v + i + 2)));
+    }
+    int64_t ls[2];
+    _mm_storeu_si128((__m128i *)ls, _mm_add_epi64(s0, s1));
+    uint64_t s = (uint64_t)ls[0] + (uint64_t)ls[1];
+    for (; i < n; i++) s += (uint64_t)v[i];
+    return (int64_t)s;
+}
+
+static double sum_f64_sse2(const double *v, size_t n) {
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(v + i));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(v + i + 2));
+    }
+    double ls[2];
+    _mm_storeu_pd(ls, _mm_add_pd(s0, s1));
+    double s = ls[0] + ls[1];
+    for (; i < n; i++) s += v[i];
+    return s;
+}
+
+static const AggImpl agg_sse2 = {
+    "sse2", stats_i64_sse2, stats_f64_sse2, sum_i64_sse2, sum_f64_sse2
+};
+
+/* ========== AVX2 Kernels ========== */
+
+__attribute__((target("avx2")))
+static void stats_i64_avx2(const int64_t *v, size_t n,
+                           int64_t *sum, int64_t *min, int64_t *max) {
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    __m256i lo = _mm256_set1_epi64x(v[0]), hi = lo;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(v + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(v + i + 4));
+        s0 = _mm256_add_epi64(s0, a);
+        s1 = _mm256_add_epi64(s1, b);
+        lo = _mm256_blendv_epi8(lo, a, _mm256_cmpgt_epi64(lo, a));
+        lo = _mm256_blendv_epi8(lo, b, _mm256_cmpgt_epi64(lo, b));
+        hi = _mm256_blendv_epi8(hi, a, _mm256_cmpgt_epi64(a, hi));
+        hi = _mm256_blendv_epi8(hi, b, _mm256_cmpgt_epi64(b, hi));
+    }
+
+    int64_t ls[4], ll[4], lh[4];
+    _mm256_storeu_si256((__m256i *)ls, _mm256_add_epi64(s0, s1));
+    _mm256_storeu_si256((__m256i *)ll, lo);
+    _mm256_storeu_si256((__m256i *)lh, hi);
+
+    uint64_t s = 0;
+    int64_t rlo = ll[0], rhi = lh[0];
+    for (int k = 0; k < 4; k++) {
+        s += (uint64_t)ls[k];
+        rlo = ll[k] < rlo ? ll[k] : rlo;
+        rhi = lh[k] > rhi ? lh[k] : rhi;
+    }
+    for (; i < n; i++) {
+        s += (uint64_t)v[i];
+        rlo = v[i] < rlo ? v[i] : rlo;
+        rhi = v[i] > rhi ? v[i] : rhi;
+    }
+
+    *sum = (int64_t)s;
+    *min = rlo;
+    *max = rhi;
+}
+
+__attribute__((target("avx2")))
+static void stats_f64_avx2(const double *v, size_t n,
+                           double *sum, double *min, double *max) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d lo = _mm256_set1_pd(v[0]), hi = lo;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_loadu_pd(v + i);
+        __m256d b = _mm256_loadu_pd(v + i + 4);
+        s0 = _mm256_add_pd(s0, a);
+        s1 = _mm256_add_pd(s1, b);
+        lo = _mm256_min_pd(lo, _mm256_min_pd(a, b));
+        hi = _mm256_max_pd(hi, _mm256_max_pd(a, b));
+    }
+
+    double ls[4], ll[4], lh[4];
+    _mm256_storeu_pd(ls, _mm256_add_pd(s0, s1));
+    _mm256_storeu_pd(ll, lo);
+    _mm256_storeu_pd(lh, hi);
+
+    double s = (ls[0] + ls[1]) + (ls[2] + ls[3]);
+    double rlo = ll[0], rhi = lh[0];
+    for (int k = 1; k < 4; k++) {
+        rlo = ll[k] < rlo ? ll[k] : rlo;
+        rhi = lh[k] > rhi ? lh[k] : rhi;
+    }
+    for (; i < n; i++) {
+        s += v[i];
+        rlo = v[i] < rlo ? v[i] : rlo;
+        rhi = v[i] > rhi ? v[i] : rhi;
+    }
+
+    *sum = s;
+    *min = rlo;
+    *max = rhi;
+}
+
+__attribute__((target("avx2")))
+static int64_t sum_i64_avx2(const int64_t *v, size_t n) {
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_epi64(s0, _mm256_loadu_si256((const __m256i *)(v + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_loadu_si256((const __m256i *)(v + i + 4)));
+    }
+    int64_t ls[4];
+    _mm256_storeu_si256((__m256i *)ls, _mm256_add_epi64(s0, s1));
+    uint64_t s = (uint64_t)ls[0] + (uint64_t)ls[1] + (uint64_t)ls[2] + (uint64_t)ls[3];
+    for (; i < n; i++) s += (uint64_t)v[i];
+    return (int64_t)s;
+}
+
+__attribute__((target("avx2")))
+static double sum_f64_avx2(const double *v, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(v + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(v + i + 4));
+    }
+    double ls[4];
+    _mm256_storeu_pd(ls, _mm256_add_pd(s0, s1));
+    double s = (ls[0] + ls[1]) + (ls[2] + ls[3]);
+    for (; i < n; i++) s += v[i];
+    return s;
+}
+
+static const AggImpl agg_avx2 = {
+    "avx2", stats_i64_avx2, stats_f64_avx2, sum_i64_avx2, sum_f64_avx2
+};
+
+#endif /* AGG_HAVE_X86 */
+
+/* ========== Runtime Dispatch ========== */
+
+static const AggImpl *agg_impl = &agg_scalar;
+static pthread_once_t agg_once = PTHREAD_ONCE_INIT;
+
+static void agg_select(void) {
+    const char *force = getenv("LCORE_SIMD");
+
+#ifdef AGG_HAVE_X86
+    __builtin_cpu_init();
+    int has_avx2 = __builtin_cpu_supports("avx2");
+
+    if (force && strcmp(force, "scalar") == 0) {
+        agg_impl = &agg_scalar;
+    } else if (force && strcmp(force, "sse2") == 0) {
+        agg_impl = &agg_sse2;
+    } else {
+        agg_impl = has_avx2 ? &agg_avx2 : &agg_sse2;
+    }
+#else
+    (void)force;
+    agg_impl = &agg_scalar;
+#endif
+}
+
+static inline const AggImpl *agg_get(void) {
+    pthread_once(&agg_once, agg_select);
+    return agg_impl;
+}
+
+const char *agg_simd_level(void) {
+    return agg_get()->name;
+}
+
+/* ========== Public Kernels ========== */
+
+void agg_stats_i64(const int64_t *values, size_t n,
+                   int64_t *sum, int64_t *min, int64_t *max) {
+    if (n == 0) {
+        *sum = 0;
+        return;
+    }
+    agg_get()->stats_i64(values, n, sum, min, max);
+}
+
+void agg_stats_f64(const double *values, size_t n,
+                   double *sum, double *min, double *max) {
+    if (n == 0) {
+        *sum = 0.0;
+        return;
+    }
+    agg_get()->stats_f64(values, n, sum, min, max);
+}
+
+int64_t agg_sum_i64(const int64_t *values, size_t n) {
+    return n ? agg_get()->sum_i64(values, n) : 0;
+}
+
+int64_t agg_min_i64(const int64_t *values, size_t n) {
+    int64_t sum, min = 0, max = 0;
+    agg_stats_i64(values, n, &sum, &min, &max);
+    return min;
+}
+
+int64_t agg_max_i64(const int64_t *values, size_t n) {
+    int64_t sum, min = 0, max = 0;
+    agg_stats_i64(values, n, &sum, &min, &max);
+    return max;
+}
+
+double agg_sum_f64(const double *values, size_t n) {
+    return n ? agg_get()->sum_f64(values, n) : 0.0;
+}
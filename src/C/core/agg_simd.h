@@ -0,0 +1,35 @@
+#ifndef AGG_SIMD_H
+#define AGG_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Vectorized aggregation kernels over contiguous value columns.
+ *
+ * The implementation is picked once at first use: AVX2 when the CPU
+ * reports it, SSE2 on any other x86-64 machine, and a portable scalar
+ * loop elsewhere. Setting LCORE_SIMD=scalar|sse2|avx2 forces a level
+ * (an unsupported request falls back to the best available one).
+ *
+ * Empty inputs leave min/max untouched and produce a zero sum.
+ */
+
+/* Fused single pass: sum, min and max of an int64 column */
+void agg_stats_i64(const int64_t *values, size_t n,
+                   int64_t *sum, int64_t *min, int64_t *max);
+
+/* Fused single pass: sum, min and max of a double column */
+void agg_stats_f64(const double *values, size_t n,
+                   double *sum, double *min, double *max);
+
+/* Single-result kernels */
+int64_t agg_sum_i64(const int64_t *values, size_t n);
+int64_t agg_min_i64(const int64_t *values, size_t n);
+int64_t agg_max_i64(const int64_t *values, size_t n);
+double agg_sum_f64(const double *values, size_t n);
+
+/* Name of the selected implementation ("avx2", "sse2" or "scalar") */
+const char *agg_simd_level(void);
+
+#endif
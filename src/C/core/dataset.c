@@ -1,54 +1,376 @@
 #include "dataset.h"
+#include "agg_simd.h"
+#include "hash.h"
+#include "quantile.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 /* Global instance definition */
-DataSetRegistry BI_Registry = { .count = 0 };
+DataSetRegistry BI_Registry = { 0 };
 
 /* --------------------------------- */
 /* Dataset Core Implementation       */
 /* --------------------------------- */
 
+#define DATASET_INITIAL_ROWS 16
+#define DATASET_INITIAL_ARENA 256
+
 void dataset_init(DataSet *ds, const char *title) {
     if (!ds) return;
 
     strncpy(ds->title, title, DATASET_MAX_TITLE - 1);
     ds->title[DATASET_MAX_TITLE - 1] = '\0';
 
+    ds->values = NULL;
+    ds->label_offsets = NULL;
+    ds->label_arena = NULL;
+    ds->arena_used = 0;
+    ds->arena_capacity = 0;
     ds->count = 0;
+    ds->capacity = 0;
+    ds->columns = NULL;
+    ds->column_count = 0;
+    ds->base = NULL;
+    ds->sel = NULL;
+    ds->column = 0;
+    ds->refs = 1;
+    ds->encoded = NULL;
+}
+
+static void dataset_encoding_free(DataSetEncoding *enc, size_t extra) {
+    if (!enc) return;
+    for (size_t c = 0; enc->columns && c <= extra; c++) encoded_column_free(&enc->columns[c]);
+    free(enc->columns);
+    encoded_labels_free(&enc->labels);
+    free(enc);
+}
+
+size_t dataset_memory(const DataSet *ds) {
+    if (!ds || ds->base) return 0;
+
+    size_t bytes = 0;
+    for (size_t c = 0; c <= ds->column_count; c++) {
+        bytes += ds->encoded ? encoded_bytes(&ds->encoded->columns[c]) : ds->capacity * sizeof(int64_t);
+    }
+    if (ds->encoded && ds->encoded->dictionary) return bytes + encoded_labels_bytes(&ds->encoded->labels);
+
+    /* Plain labels of an encoded dataset keep offsets for 'count' rows */
+    size_t label_rows = ds->encoded ? ds->count : ds->capacity;
+    return bytes + label_rows * sizeof(size_t) + ds->arena_capacity;
 }
 
-int dataset_add(DataSet *ds, const char *label, int value) {
+int dataset_compress(DataSet *ds) {
+    if (!ds || ds->base) return -1;
+    if (ds->encoded || ds->count == 0) return 0;
+    if (ds->count > UINT32_MAX) return -1;
+
+    DataSetEncoding *enc = calloc(1, sizeof(DataSetEncoding));
+    EncodedColumn *cols = calloc(ds->column_count + 1, sizeof(EncodedColumn));
+    if (!enc || !cols) {
+        free(enc);
+        free(cols);
+        return -1;
+    }
+    enc->columns = cols;
+
+    size_t built = 0, encoded = 0;
+    int rc = 0;
+    for (; rc == 0 && built <= ds->column_count; built++) {
+        const int64_t *values = built ? ds->columns[built - 1].values : ds->values;
+        rc = encoded_column_build(&cols[built], values, ds->count);
+        if (rc == 0) encoded += encoded_bytes(&cols[built]);
+    }
+    size_t plain_labels = ds->capacity * sizeof(size_t) + ds->arena_capacity;
+    if (rc == 0 && encoded_labels_build(&enc->labels, ds->label_arena, ds->label_offsets, ds->count) == 0) {
+        enc->dictionary = encoded_labels_bytes(&enc->labels) < plain_labels;
+        if (!enc->dictionary) encoded_labels_free(&enc->labels);
+    }
+    encoded += enc->dictionary ? encoded_labels_bytes(&enc->labels) : ds->count * sizeof(size_t) + ds->arena_capacity;
+
+    /* Only worth it for a saving of at least 25% */
+    if (rc != 0 || encoded * 4 > dataset_memory(ds) * 3) {
+        dataset_encoding_free(enc, built ? built - 1 : 0);
+        return rc;
+    }
+
+    free(ds->values);
+    ds->values = NULL;
+    for (size_t c = 0; c < ds->column_count; c++) {
+        free(ds->columns[c].values);
+        ds->columns[c].values = NULL;
+    }
+    if (enc->dictionary) {
+        free(ds->label_offsets);
+        free(ds->label_arena);
+        ds->label_offsets = NULL;
+        ds->label_arena = NULL;
+        ds->arena_used = 0;
+        ds->arena_capacity = 0;
+    } else {
+        /* The offsets stay plain; trim them to the rows in use */
+        size_t *offsets = realloc(ds->label_offsets, ds->count * sizeof(size_t));
+        if (offsets) ds->label_offsets = offsets;
+    }
+    ds->capacity = 0;
+    ds->encoded = enc;
+    return 1;
+}
+
+int dataset_decompress(DataSet *ds) {
+    if (!ds || !ds->encoded) return 0;
+
+    DataSetEncoding *enc = ds->encoded;
+    size_t rows = ds->count ? ds->count : 1;
+    int ok = (ds->values = malloc(rows * sizeof(int64_t))) != NULL;
+    for (size_t c = 0; ok && c < ds->column_count; c++) {
+        ok = (ds->columns[c].values = malloc(rows * sizeof(int64_t))) != NULL;
+    }
+
+    size_t arena_len = 0;
+    for (size_t i = 0; ok && enc->dictionary && i < ds->count; i++) {
+        arena_len += strlen(encoded_label(&enc->labels, i)) + 1;
+    }
+    if (ok && enc->dictionary) {
+        ds->label_offsets = malloc(rows * sizeof(size_t));
+        ds->label_arena = malloc(arena_len ? arena_len : 1);
+        ok = ds->label_offsets && ds->label_arena;
+    }
+
+    if (!ok) {
+        free(ds->values);
+        ds->values = NULL;
+        for (size_t c = 0; c < ds->column_count; c++) {
+            free(ds->columns[c].values);
+            ds->columns[c].values = NULL;
+        }
+        if (enc->dictionary) {
+            free(ds->label_offsets);
+            free(ds->label_arena);
+            ds->label_offsets = NULL;
+            ds->label_arena = NULL;
+        }
+        return -1;
+    }
+
+    encoded_decode(&enc->columns[0], 0, ds->count, ds->values);
+    for (size_t c = 0; c < ds->column_count; c++) {
+        encoded_decode(&enc->columns[c + 1], 0, ds->count, ds->columns[c].values);
+    }
+    if (enc->dictionary) {
+        size_t used = 0;
+        for (size_t i = 0; i < ds->count; i++) {
+            const char *label = encoded_label(&enc->labels, i);
+            size_t len = strlen(label) + 1;
+            memcpy(ds->label_arena + used, label, len);
+            ds->label_offsets[i] = used;
+            used += len;
+        }
+        ds->arena_used = used;
+        ds->arena_capacity = arena_len ? arena_len : 1;
+    }
+
+    ds->capacity = rows;
+    ds->encoded = NULL;
+    dataset_encoding_free(enc, ds->column_count);
+    return 0;
+}
+
+static int dataset_grow_rows(DataSet *ds, size_t rows) {
+    if (rows <= ds->capacity) return 0;
+    if (dataset_decompress(ds) != 0) return -1;
+    if (rows <= ds->capacity) return 0;
+
+    size_t cap = ds->capacity ? ds->capacity : DATASET_INITIAL_ROWS;
+    while (cap < rows) cap *= 2;
+
+    int64_t *values = realloc(ds->values, cap * sizeof(int64_t));
+    if (!values) return -1;
+    ds->values = values;
+
+    size_t *offsets = realloc(ds->label_offsets, cap * sizeof(size_t));
+    if (!offsets) return -1;
+    ds->label_offsets = offsets;
+
+    for (size_t c = 0; c < ds->column_count; c++) {
+        int64_t *col = realloc(ds->columns[c].values, cap * sizeof(int64_t));
+        if (!col) return -1;
+        ds->columns[c].values = col;
+    }
+
+    ds->capacity = cap;
+    return 0;
+}
+
+static int dataset_grow_arena(DataSet *ds, size_t bytes) {
+    if (bytes <= ds->arena_capacity) return 0;
+    if (dataset_decompress(ds) != 0) return -1;
+    if (bytes <= ds->arena_capacity) return 0;
+
+    size_t cap = ds->arena_capacity ? ds->arena_capacity : DATASET_INITIAL_ARENA;
+    while (cap < bytes) cap *= 2;
+
+    char *arena = realloc(ds->label_arena, cap);
+    if (!arena) return -1;
+
+    ds->label_arena = arena;
+    ds->arena_capacity = cap;
+    return 0;
+}
+
+int dataset_reserve(DataSet *ds, size_t rows, size_t label_bytes) {
+    if (!ds || ds->base) return -1;
+    if (dataset_grow_rows(ds, rows) != 0) return -1;
+    return dataset_grow_arena(ds, label_bytes);
+}
+
+int dataset_add(DataSet *ds, const char *label, int64_t value) {
+    if (!label) return -1;
+    return dataset_add_n(ds, label, strlen(label), value);
+}
+
+int dataset_add_n(DataSet *ds, const char *label, size_t label_len, int64_t value) {
     if (!ds || !label) return -1;
 
-    if (ds->count >= DATASET_MAX_ROWS) {
-        return -1; /* Full */
+    if (ds->base) {
+        fprintf(stderr, "Dataset error: '%s' is a read-only view.\n", ds->title);
+        return -1;
+    }
+
+    size_t len = label_len + 1;
+    if (dataset_grow_rows(ds, ds->count + 1) != 0 ||
+        dataset_grow_arena(ds, ds->arena_used + len) != 0) {
+        fprintf(stderr, "Dataset error: out of memory adding row %zu to '%s'.\n",
+                ds->count, ds->title);
+        return -1;
     }
 
-    strncpy(ds->labels[ds->count], label, DATASET_MAX_LABEL - 1);
-    ds->labels[ds->count][DATASET_MAX_LABEL - 1] = '\0';
+    memcpy(ds->label_arena + ds->arena_used, label, label_len);
+    ds->label_arena[ds->arena_used + label_len] = '\0';
+    ds->label_offsets[ds->count] = ds->arena_used;
+    ds->arena_used += len;
 
     ds->values[ds->count] = value;
+    for (size_t c = 0; c < ds->column_count; c++) ds->columns[c].values[ds->count] = 0;
     ds->count++;
 
     return 0;
 }
 
+void dataset_free(DataSet *ds) {
+    if (!ds) return;
+
+    if (ds->base) dataset_release(ds->base);
+    free(ds->sel);
+    dataset_encoding_free(ds->encoded, ds->column_count);
+    free(ds->values);
+    free(ds->label_offsets);
+    free(ds->label_arena);
+    for (size_t c = 0; c < ds->column_count; c++) free(ds->columns[c].values);
+    free(ds->columns);
+
+    ds->encoded = NULL;
+    ds->columns = NULL;
+    ds->column_count = 0;
+    ds->column = 0;
+    ds->base = NULL;
+    ds->sel = NULL;
+    ds->values = NULL;
+    ds->label_offsets = NULL;
+    ds->label_arena = NULL;
+    ds->arena_used = 0;
+    ds->arena_capacity = 0;
+    ds->count = 0;
+    ds->capacity = 0;
+}
+
+DataSet *dataset_view_new(DataSet *src, uint32_t *sel, size_t count, const char *title) {
+    DataSet *view = src ? malloc(sizeof(DataSet)) : NULL;
+    if (!view) {
+        free(sel);
+        return NULL;
+    }
+
+    dataset_init(view, title);
+    view->base = dataset_physical(src);
+    view->sel = sel;
+    view->count = count;
+    view->column = src->column;
+    dataset_retain(view->base);
+    return view;
+}
+
+int dataset_add_column(DataSet *ds, const char *name) {
+    if (!ds || !name || ds->base || dataset_decompress(ds) != 0) return -1;
+    if (dataset_find_column(ds, name) >= 0) {
+        fprintf(stderr, "Dataset error: '%s' already has a column '%s'.\n", ds->title, name);
+        return -1;
+    }
+
+    DataSetColumn *cols = realloc(ds->columns, (ds->column_count + 1) * sizeof(DataSetColumn));
+    if (!cols) return -1;
+    ds->columns = cols;
+
+    DataSetColumn *col = &cols[ds->column_count];
+    col->values = calloc(ds->capacity ? ds->capacity : 1, sizeof(int64_t));
+    if (!col->values) return -1;
+    strncpy(col->name, name, DATASET_MAX_TITLE - 1);
+    col->name[DATASET_MAX_TITLE - 1] = '\0';
+
+    return (int)++ds->column_count;
+}
+
+int dataset_find_column(const DataSet *ds, const char *name) {
+    if (!ds || !name) return -1;
+    if (strcmp(name, "value") == 0) return 0;
+
+    const DataSet *p = ds->base ? ds->base : ds;
+    for (size_t c = 0; c < p->column_count; c++) {
+        if (strcmp(p->columns[c].name, name) == 0) return (int)(c + 1);
+    }
+    return -1;
+}
+
+DataSet *dataset_column_view(DataSet *src, size_t column, const char *title) {
+    if (!src || column > dataset_physical(src)->column_count) return NULL;
+
+    uint32_t *sel = NULL;
+    if (src->sel) {
+        sel = malloc((src->count ? src->count : 1) * sizeof(uint32_t));
+        if (!sel) return NULL;
+        memcpy(sel, src->sel, src->count * sizeof(uint32_t));
+    }
+
+    DataSet *view = dataset_view_new(src, sel, src->count, title);
+    if (view) view->column = column;
+    return view;
+}
+
+void dataset_retain(DataSet *ds) {
+    if (ds) ds->refs++;
+}
+
+void dataset_release(DataSet *ds) {
+    if (!ds || --ds->refs > 0) return;
+    dataset_free(ds);
+    free(ds);
+}
+
 void dataset_plot(const DataSet *ds) {
     if (!ds) return;
 
     printf("\n--- %s ---\n", ds->title);
 
     for (size_t i = 0; i < ds->count; i++) {
-        printf("%-10s | ", ds->labels[i]);
+        printf("%-10s | ", dataset_label(ds, i));
 
-        int bar_len = ds->values[i] / 10;
-        for (int b = 0; b < bar_len; b++) {
+        int64_t value = dataset_value(ds, i);
+        for (int64_t b = 0; b < value / 10; b++) {
             printf("█");
         }
 
-        printf(" (%d)\n", ds->values[i]);
+        printf(" (%" PRId64 ")\n", value);
     }
 
     printf("----------------\n");
@@ -59,84 +381,327 @@ void dataset_plot(const DataSet *ds) {
 /* Registry Implementation           */
 /* --------------------------------- */
 
+#define REGISTRY_INITIAL_SLOTS 64
+#define REGISTRY_NAME_CHUNK 4096
+
+/* Keep load factor at or below 70% */
+static int registry_needs_grow(size_t count, size_t capacity) {
+    return capacity == 0 || (count + 1) * 10 > capacity * 7;
+}
+
+static const char *name_pool_store(const char *name, size_t len) {
+    DataSetNameChunk *chunk = BI_Registry.name_pool;
+
+    if (!chunk || chunk->capacity - chunk->used < len + 1) {
+        size_t cap = len + 1 > REGISTRY_NAME_CHUNK ? len + 1 : REGISTRY_NAME_CHUNK;
+        chunk = malloc(sizeof(DataSetNameChunk) + cap);
+        if (!chunk) return NULL;
+        chunk->used = 0;
+        chunk->capacity = cap;
+        chunk->next = BI_Registry.name_pool;
+        BI_Registry.name_pool = chunk;
+    }
+
+    char *dst = chunk->data + chunk->used;
+    memcpy(dst, name, len + 1);
+    chunk->used += len + 1;
+    return dst;
+}
+
+static int name_set_grow(void) {
+    size_t cap = BI_Registry.name_capacity ? BI_Registry.name_capacity * 2
+                                           : REGISTRY_INITIAL_SLOTS;
+    const char **names = calloc(cap, sizeof(const char *));
+    uint64_t *hashes = calloc(cap, sizeof(uint64_t));
+    if (!names || !hashes) {
+        free(names);
+        free(hashes);
+        return -1;
+    }
+
+    for (size_t i = 0; i < BI_Registry.name_capacity; i++) {
+        if (!BI_Registry.names[i]) continue;
+        size_t slot = BI_Registry.name_hashes[i] & (cap - 1);
+        while (names[slot]) slot = (slot + 1) & (cap - 1);
+        names[slot] = BI_Registry.names[i];
+        hashes[slot] = BI_Registry.name_hashes[i];
+    }
+
+    free(BI_Registry.names);
+    free(BI_Registry.name_hashes);
+    BI_Registry.names = names;
+    BI_Registry.name_hashes = hashes;
+    BI_Registry.name_capacity = cap;
+    return 0;
+}
+
+/* Intern a registry name; equal names always return the same pointer */
+static const char *name_intern_hashed(const char *name, uint64_t hash) {
+    if (registry_needs_grow(BI_Registry.name_count, BI_Registry.name_capacity) &&
+        name_set_grow() != 0) {
+        return NULL;
+    }
+
+    size_t mask = BI_Registry.name_capacity - 1;
+    size_t slot = hash & mask;
+    while (BI_Registry.names[slot]) {
+        if (BI_Registry.name_hashes[slot] == hash &&
+            strcmp(BI_Registry.names[slot], name) == 0) {
+            return BI_Registry.names[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    const char *interned = name_pool_store(name, strlen(name));
+    if (!interned) return NULL;
+
+    BI_Registry.names[slot] = interned;
+    BI_Registry.name_hashes[slot] = hash;
+    BI_Registry.name_count++;
+    return interned;
+}
+
+/* Find the slot holding 'name', or the empty slot where it would go */
+static DataSetRegistryEntry *registry_find_slot(const char *name, uint64_t hash) {
+    size_t mask = BI_Registry.capacity - 1;
+    size_t slot = hash & mask;
+
+    for (;;) {
+        DataSetRegistryEntry *e = &BI_Registry.entries[slot];
+        if (!e->name) return e;
+        if (e->hash == hash && (e->name == name || strcmp(e->name, name) == 0)) {
+            return e;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+static int registry_grow(void) {
+    size_t old_cap = BI_Registry.capacity;
+    DataSetRegistryEntry *old = BI_Registry.entries;
+
+    size_t cap = old_cap ? old_cap * 2 : REGISTRY_INITIAL_SLOTS;
+    DataSetRegistryEntry *entries = calloc(cap, sizeof(DataSetRegistryEntry));
+    if (!entries) return -1;
+
+    BI_Registry.entries = entries;
+    BI_Registry.capacity = cap;
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].name) continue;
+        *registry_find_slot(old[i].name, old[i].hash) = old[i];
+    }
+
+    free(old);
+    return 0;
+}
+
+/* Compress large physical datasets as they are registered */
+static void registry_compress(DataSet *ds) {
+    if (ds->base || ds->encoded || ds->count < DATASET_COMPRESS_MIN_ROWS) return;
+
+    const char *env = getenv("LCORE_COMPRESS");
+    if (env && (strcmp(env, "0") == 0 || strcmp(env, "off") == 0)) return;
+    dataset_compress(ds);
+}
+
 int dataset_registry_add(const char *name, DataSet *ds) {
-    if (BI_Registry.count >= DATASET_MAX_DATASETS) {
-        fprintf(stderr, "Registry error: Max dataset limit reached.\n");
+    if (!name || !ds) return -1;
+
+    if (registry_needs_grow(BI_Registry.count, BI_Registry.capacity) &&
+        registry_grow() != 0) {
+        fprintf(stderr, "Registry error: out of memory adding '%s'.\n", name);
         return -1;
     }
 
+    uint64_t hash = hash_string(name);
+    DataSetRegistryEntry *e = registry_find_slot(name, hash);
+
     // Check if name already exists
-    for (size_t i = 0; i < BI_Registry.count; i++) {
-        if (strcmp(BI_Registry.names[i], name) == 0) {
-            fprintf(stderr, "Registry error: Dataset '%s' already exists.\n", name);
-            return -1;
-        }
+    if (e->name) {
+        fprintf(stderr, "Registry error: Dataset '%s' already exists.\n", name);
+        return -1;
+    }
+
+    const char *interned = name_intern_hashed(name, hash);
+    if (!interned) {
+        fprintf(stderr, "Registry error: out of memory adding '%s'.\n", name);
+        return -1;
     }
 
-    strncpy(BI_Registry.names[BI_Registry.count], name, DATASET_MAX_NAME - 1);
-    BI_Registry.names[BI_Registry.count][DATASET_MAX_NAME - 1] = '\0';
-    
-    BI_Registry.datasets[BI_Registry.count] = ds;
+    e->name = interned;
+    e->hash = hash;
+    e->dataset = ds;
     BI_Registry.count++;
+    registry_compress(ds);
 
     return 0;
 }
 
-DataSet *dataset_registry_get(const char *name) {
-    for (size_t i = 0; i < BI_Registry.count; i++) {
-        if (strcmp(BI_Registry.names[i], name) == 0) {
-            return BI_Registry.datasets[i];
+int dataset_registry_replace(const char *name, DataSet *ds) {
+    if (!name || !ds) return -1;
+
+    if (BI_Registry.count > 0) {
+        DataSetRegistryEntry *e = registry_find_slot(name, hash_string(name));
+        if (e->name) {
+            DataSet *old = e->dataset;
+            e->dataset = ds;
+            if (old != ds) dataset_release(old);
+            registry_compress(ds);
+            return 0;
         }
     }
-    return NULL;
+    return dataset_registry_add(name, ds);
+}
+
+DataSet *dataset_registry_get(const char *name) {
+    if (!name || BI_Registry.count == 0) return NULL;
+
+    DataSetRegistryEntry *e = registry_find_slot(name, hash_string(name));
+    return e->name ? e->dataset : NULL;
 }
 
 void dataset_registry_free() {
-    for (size_t i = 0; i < BI_Registry.count; i++) {
-        // Free the DataSet object that was dynamically allocated in main.c
-        free(BI_Registry.datasets[i]);
-        BI_Registry.datasets[i] = NULL;
+    for (size_t i = 0; i < BI_Registry.capacity; i++) {
+        DataSetRegistryEntry *e = &BI_Registry.entries[i];
+        if (!e->name) continue;
+        // Drop the registry's reference; views keep their bases alive
+        dataset_release(e->dataset);
     }
-    BI_Registry.count = 0;
+    free(BI_Registry.entries);
+
+    while (BI_Registry.name_pool) {
+        DataSetNameChunk *next = BI_Registry.name_pool->next;
+        free(BI_Registry.name_pool);
+        BI_Registry.name_pool = next;
+    }
+    free(BI_Registry.names);
+    free(BI_Registry.name_hashes);
+
+    memset(&BI_Registry, 0, sizeof(BI_Registry));
     fprintf(stderr, "BI_Registry: Cleaned up and freed all datasets.\n");
 }
 
 /* ---------- Aggregation Helpers ---------- */
 
-long dataset_sum(const DataSet *ds) {
+/* Views are aggregated a block at a time: rows are gathered through
+   the selection vector into a contiguous buffer the kernels can use */
+const int64_t *dataset_values_block(const DataSet *ds, size_t start, size_t n, int64_t *buf) {
+    const DataSet *p = ds->base ? ds->base : ds;
+    const uint32_t *sel = ds->sel ? ds->sel + start : NULL;
+
+    if (p->encoded) {
+        const EncodedColumn *col = &p->encoded->columns[ds->column];
+        if (!sel) encoded_decode(col, start, n, buf);
+        for (size_t j = 0; sel && j < n; j++) buf[j] = encoded_get(col, sel[j]);
+        return buf;
+    }
+
+    const int64_t *values = dataset_column_data(ds);
+    if (!sel) return values + start;
+    for (size_t j = 0; j < n; j++) buf[j] = values[sel[j]];
+    return buf;
+}
+
+/* sum/min/max/count/mean in one vectorized pass over the value column */
+int dataset_stats(const DataSet *ds, DataSetStats *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
     if (!ds || ds->count == 0) return 0;
-    long s = 0;
-    for (size_t i = 0; i < ds->count; ++i) {
-        s += ds->values[i];
+
+    const DataSet *p = dataset_physical((DataSet *)ds);
+    if (p->encoded && !ds->sel) {
+        /* Straight off the encoded column */
+        encoded_stats(&p->encoded->columns[ds->column], &out->sum, &out->min, &out->max);
+    } else if (!ds->base) {
+        agg_stats_i64(ds->values, ds->count, &out->sum, &out->min, &out->max);
+    } else {
+        int64_t buf[DATASET_BLOCK_ROWS];
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ds->count; ) {
+            size_t n = ds->count - i < DATASET_BLOCK_ROWS ? ds->count - i : DATASET_BLOCK_ROWS;
+            const int64_t *block = dataset_values_block(ds, i, n, buf);
+            int64_t s, lo, hi;
+            agg_stats_i64(block, n, &s, &lo, &hi);
+            sum += (uint64_t)s;
+            if (i == 0 || lo < out->min) out->min = lo;
+            if (i == 0 || hi > out->max) out->max = hi;
+            i += n;
+        }
+        out->sum = (int64_t)sum;
     }
-    return s;
+
+    out->count = ds->count;
+    out->mean = (double)out->sum / (double)ds->count;
+    return 0;
+}
+
+int64_t dataset_sum(const DataSet *ds) {
+    if (!ds || ds->count == 0) return 0;
+    if (!ds->base && !ds->encoded) return agg_sum_i64(ds->values, ds->count);
+
+    DataSetStats st;
+    dataset_stats(ds, &st);
+    return st.sum;
 }
 
 double dataset_avg(const DataSet *ds) {
     if (!ds || ds->count == 0) return 0.0;
-    long s = dataset_sum(ds);
+    int64_t s = dataset_sum(ds);
     return (double)s / (double)ds->count;
 }
 
-int dataset_min(const DataSet *ds) {
+int64_t dataset_min(const DataSet *ds) {
     if (!ds || ds->count == 0) return 0;
-    int m = ds->values[0];
-    for (size_t i = 1; i < ds->count; ++i) {
-        if (ds->values[i] < m) m = ds->values[i];
-    }
-    return m;
+    if (!ds->base && !ds->encoded) return agg_min_i64(ds->values, ds->count);
+
+    DataSetStats st;
+    dataset_stats(ds, &st);
+    return st.min;
 }
 
-int dataset_max(const DataSet *ds) {
+int64_t dataset_max(const DataSet *ds) {
     if (!ds || ds->count == 0) return 0;
-    int m = ds->values[0];
-    for (size_t i = 1; i < ds->count; ++i) {
-        if (ds->values[i] > m) m = ds->values[i];
-    }
-    return m;
+    if (!ds->base && !ds->encoded) return agg_max_i64(ds->values, ds->count);
+
+    DataSetStats st;
+    dataset_stats(ds, &st);
+    return st.max;
 }
 
 size_t dataset_count(const DataSet *ds) {
     if (!ds) return 0;
     return ds->count;
 }
+
+double dataset_stddev(const DataSet *ds) {
+    if (!ds || ds->count < 2) return 0.0;
+
+    WelfordState w;
+    welford_init(&w);
+    for (size_t i = 0; i < ds->count; i++) {
+        welford_add(&w, (double)dataset_value(ds, i));
+    }
+    return welford_stddev(&w);
+}
+
+double dataset_percentile(const DataSet *ds, double p) {
+    if (!ds || ds->count == 0) return 0.0;
+
+    /* Selection reorders its input, so work on a scratch copy */
+    int64_t *scratch = malloc(ds->count * sizeof(int64_t));
+    if (!scratch) {
+        fprintf(stderr, "Dataset error: out of memory computing percentile of '%s'.\n",
+                ds->title);
+        return 0.0;
+    }
+    for (size_t i = 0; i < ds->count; i++) scratch[i] = dataset_value(ds, i);
+
+    double result = percentile_i64(scratch, ds->count, p);
+    free(scratch);
+    return result;
+}
+
+double dataset_median(const DataSet *ds) {
+    return dataset_percentile(ds, 50.0);
+}
@@ -2,29 +2,107 @@
 #define DATASET_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "encoding.h"
 
-#define DATASET_MAX_ROWS 100
 #define DATASET_MAX_TITLE 64
-#define DATASET_MAX_LABEL 32
 
-// Constants for the global registry
-#define DATASET_MAX_DATASETS 50
-#define DATASET_MAX_NAME 32 // The identifier name used in LCore, e.g., 'Sales'
+/* Rows handed out per call by dataset_values_block */
+#define DATASET_BLOCK_ROWS 1024
 
-// Full definition of the DataSet structure
+/* Extra named value column, e.g. the right-hand values of a join */
 typedef struct {
+    char name[DATASET_MAX_TITLE];
+    int64_t *values;    // 'capacity' slots, like the primary column
+} DataSetColumn;
+
+/*
+ * Full definition of the DataSet structure.
+ *
+ * Rows are stored column-wise and grow geometrically:
+ *   - values:        one contiguous 64-bit value column
+ *   - label_offsets: per-row offset of the label inside label_arena
+ *   - label_arena:   NUL-terminated label bytes, packed back to back
+ * An empty dataset owns no heap memory.
+ *
+ * A dataset can also be a read-only selection view: 'base' points at a
+ * physical dataset, 'sel' lists the base rows it exposes, and no
+ * columns of its own are allocated. Views hold a reference on their
+ * base, so heap datasets are reference counted (see dataset_release).
+ *
+ * Besides the primary 'values' column a physical dataset may carry
+ * extra named int64 columns. Column 0 is always 'values'; column k is
+ * columns[k - 1]. A view reads one of them as its value ('column').
+ *
+ * A compressed dataset ('encoded', see dataset_compress) holds its
+ * value columns, and its labels when a dictionary is smaller, only in
+ * encoded form; the plain arrays are NULL until it has to grow.
+ */
+typedef struct DataSetEncoding {
+    EncodedColumn *columns;     /* columns[0] is 'values', columns[k] extra column k */
+    EncodedLabels labels;
+    int dictionary;             /* Labels are dictionary encoded */
+} DataSetEncoding;
+
+typedef struct DataSet {
     char title[DATASET_MAX_TITLE];
-    char labels[DATASET_MAX_ROWS][DATASET_MAX_LABEL];
-    int values[DATASET_MAX_ROWS];
+
+    int64_t *values;
+    size_t *label_offsets;
+    char *label_arena;
+    size_t arena_used;
+    size_t arena_capacity;
+
     size_t count;
+    size_t capacity;
+
+    DataSetColumn *columns; // Extra value columns (physical datasets)
+    size_t column_count;
+
+    struct DataSet *base;   // Physical dataset behind a view, else NULL
+    uint32_t *sel;          // View row i is base row sel[i] (NULL: row i)
+    size_t column;          // Column a view reads as its value
+    size_t refs;            // References held on a heap-allocated dataset
+
+    DataSetEncoding *encoded; // Compressed columns, or NULL
 } DataSet;
 
 
-// Global Registry Structure
+// One slot of the registry hash table; name is NULL for an empty slot
 typedef struct {
-    DataSet *datasets[DATASET_MAX_DATASETS];
-    char names[DATASET_MAX_DATASETS][DATASET_MAX_NAME]; // LCore identifier names
+    const char *name;   // Interned LCore identifier, e.g., 'Sales'
+    uint64_t hash;
+    DataSet *dataset;
+} DataSetRegistryEntry;
+
+// Chunk of the name intern pool; interned names never move
+typedef struct DataSetNameChunk {
+    struct DataSetNameChunk *next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} DataSetNameChunk;
+
+/*
+ * Global Registry Structure
+ *
+ * Open-addressing table with linear probing over a power-of-two slot
+ * array, grown before it passes 70% load. Names are interned once into
+ * a chunked pool, so a registered name is stored a single time and
+ * callers holding an interned pointer match on pointer equality.
+ */
+typedef struct {
+    DataSetRegistryEntry *entries;
+    size_t capacity;
     size_t count;
+
+    // Name intern set (same probing scheme, slots hold pool pointers)
+    const char **names;
+    uint64_t *name_hashes;
+    size_t name_capacity;
+    size_t name_count;
+    DataSetNameChunk *name_pool;
 } DataSetRegistry;
 
 extern DataSetRegistry BI_Registry; // Global instance declaration
@@ -36,8 +114,95 @@ extern DataSetRegistry BI_Registry; // Global instance declaration
 /* Create a new dataset with a given title */
 void dataset_init(DataSet *ds, const char *title);
 
+/* Pre-size the columns for 'rows' rows and 'label_bytes' bytes of labels */
+int dataset_reserve(DataSet *ds, size_t rows, size_t label_bytes);
+
 /* Add a single row (label, value) */
-int dataset_add(DataSet *ds, const char *label, int value);
+int dataset_add(DataSet *ds, const char *label, int64_t value);
+
+/* Same, with the label given as 'label_len' bytes (no NUL needed) */
+int dataset_add_n(DataSet *ds, const char *label, size_t label_len, int64_t value);
+
+/* Release the column storage; the dataset is left empty and reusable */
+void dataset_free(DataSet *ds);
+
+/*
+ * Create a heap view over the physical dataset behind 'src' exposing
+ * the physical rows in 'sel' (ownership of 'sel' passes to the view).
+ * Returns NULL on failure, in which case 'sel' is freed.
+ */
+DataSet *dataset_view_new(DataSet *src, uint32_t *sel, size_t count, const char *title);
+
+/*
+ * Add a zero-filled extra column named 'name' to a physical dataset.
+ * Returns its column index (>= 1), or -1 on failure.
+ */
+int dataset_add_column(DataSet *ds, const char *name);
+
+/* Index of the column called 'name' ("value" is column 0), or -1 */
+int dataset_find_column(const DataSet *ds, const char *name);
+
+/* Heap view exposing the rows of 'src' with 'column' as the value */
+DataSet *dataset_column_view(DataSet *src, size_t column, const char *title);
+
+/* Reference counting for heap datasets; the last release frees it */
+void dataset_retain(DataSet *ds);
+void dataset_release(DataSet *ds);
+
+/* Physical dataset that owns the rows of 'ds' (ds itself if not a view) */
+static inline DataSet *dataset_physical(DataSet *ds) {
+    return ds->base ? ds->base : ds;
+}
+
+/* Physical row id behind row i */
+static inline size_t dataset_row(const DataSet *ds, size_t i) {
+    return ds->sel ? ds->sel[i] : i;
+}
+
+/* Label of physical row 'row' of the physical dataset 'p' */
+static inline const char *dataset_row_label(const DataSet *p, size_t row) {
+    if (p->encoded && p->encoded->dictionary) return encoded_label(&p->encoded->labels, row);
+    return p->label_arena + p->label_offsets[row];
+}
+
+/* Row accessors (valid for physical datasets and views alike) */
+static inline const char *dataset_label(const DataSet *ds, size_t i) {
+    const DataSet *p = ds->base ? ds->base : ds;
+    return dataset_row_label(p, dataset_row(ds, i));
+}
+
+/* Physical column 'ds' reads its values from, indexed by physical row
+   (NULL when the physical dataset is compressed) */
+static inline int64_t *dataset_column_data(const DataSet *ds) {
+    const DataSet *p = ds->base ? ds->base : ds;
+    return ds->column ? p->columns[ds->column - 1].values : p->values;
+}
+
+static inline int64_t dataset_value(const DataSet *ds, size_t i) {
+    const DataSet *p = ds->base ? ds->base : ds;
+    if (p->encoded) return encoded_get(&p->encoded->columns[ds->column], dataset_row(ds, i));
+    return dataset_column_data(ds)[dataset_row(ds, i)];
+}
+
+/*
+ * Values of rows [start, start + n) as one contiguous array: a pointer
+ * into the column when it is plain and unselected, else the rows
+ * gathered or decoded into 'buf' (room for n values).
+ */
+const int64_t *dataset_values_block(const DataSet *ds, size_t start, size_t n, int64_t *buf);
+
+/*
+ * Re-encode a physical dataset's columns (see encoding.h) and drop the
+ * plain arrays when that saves at least a quarter of their memory.
+ * Returns 1 if compressed, 0 if left as is, -1 on failure.
+ */
+int dataset_compress(DataSet *ds);
+
+/* Bring a compressed dataset back to plain arrays */
+int dataset_decompress(DataSet *ds);
+
+/* Bytes held by the columns and labels of a physical dataset */
+size_t dataset_memory(const DataSet *ds);
 
 /* ASCII visualization */
 void dataset_plot(const DataSet *ds);
@@ -47,21 +212,46 @@ void dataset_plot(const DataSet *ds);
 /* Registry Functions                */
 /* --------------------------------- */
 
-/* Add a dataset to the global registry */
+#define DATASET_COMPRESS_MIN_ROWS 4096
+
+/* Add a dataset to the global registry (the registry takes over the
+   caller's reference). Physical datasets of at least
+   DATASET_COMPRESS_MIN_ROWS rows are compressed on the way in unless
+   LCORE_COMPRESS=0. */
 int dataset_registry_add(const char *name, DataSet *ds);
 
+/* Bind 'name' to 'ds', releasing whatever it was bound to before */
+int dataset_registry_replace(const char *name, DataSet *ds);
+
 /* Retrieve a dataset from the global registry */
 DataSet *dataset_registry_get(const char *name);
 
 /* Free all dynamically allocated datasets in the registry */
 void dataset_registry_free();
 
+/* Result of a fused single-pass aggregation */
+typedef struct {
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    size_t count;
+    double mean;
+} DataSetStats;
+
 /* Aggregation helpers */
-long dataset_sum(const DataSet *ds);
+int dataset_stats(const DataSet *ds, DataSetStats *out);
+int64_t dataset_sum(const DataSet *ds);
 double dataset_avg(const DataSet *ds);
-int dataset_min(const DataSet *ds);
-int dataset_max(const DataSet *ds);
+int64_t dataset_min(const DataSet *ds);
+int64_t dataset_max(const DataSet *ds);
 size_t dataset_count(const DataSet *ds);
 
+/* Sample standard deviation (one-pass Welford) */
+double dataset_stddev(const DataSet *ds);
+
+/* Exact median / p-th percentile (0..100) via selection, no full sort */
+double dataset_median(const DataSet *ds);
+double dataset_percentile(const DataSet *ds, double p);
+
 
-#endif
\ No newline at end of file
+#endif
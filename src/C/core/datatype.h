@@ -0,0 +1,13 @@
+#ifndef DATATYPE_H
+#define DATATYPE_H
+
+/* Value types shared by the AST and the typed tables */
+typedef enum {
+    DATA_TYPE_INT,
+    DATA_TYPE_FLOAT,
+    DATA_TYPE_STRING,
+    DATA_TYPE_DATE,
+    DATA_TYPE_BOOL,
+} DataType;
+
+#endif
@@ -0,0 +1,372 @@
+/* encoding.c - Lightweight column encodings and kernels over them */
+
+#include "encoding.h"
+#include "agg_simd.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== Bit Packing ========== */
+
+/* Bits needed to hold 0..span */
+static unsigned bit_width(uint64_t span) {
+    return span ? 64u - (unsigned)__builtin_clzll(span) : 0u;
+}
+
+/* One pad word lets pack_get read two words without a bounds check */
+static size_t packed_words(size_t n, unsigned width) {
+    return (n * width + 63) / 64 + 1;
+}
+
+static void pack_put(uint64_t *words, size_t i, unsigned width, uint64_t v) {
+    if (width == 0) return;
+    size_t bit = i * width;
+    unsigned shift = bit & 63;
+    words[bit >> 6] |= v << shift;
+    if (shift + width > 64) words[(bit >> 6) + 1] |= v >> (64 - shift);
+}
+
+static inline uint64_t pack_get(const uint64_t *words, size_t i, unsigned width) {
+    size_t bit = i * width;
+    unsigned shift = bit & 63;
+    uint64_t v = words[bit >> 6] >> shift;
+    if (shift + width > 64) v |= words[(bit >> 6) + 1] << (64 - shift);
+    return width == 64 ? v : v & ((UINT64_C(1) << width) - 1);
+}
+
+/* ========== Int64 Columns ========== */
+
+const char *encoding_name(ColumnEncoding e) {
+    switch (e) {
+        case ENCODING_FOR:   return "for";
+        case ENCODING_DELTA: return "delta";
+        case ENCODING_RLE:   return "rle";
+        default:             return "plain";
+    }
+}
+
+/* Difference v[i] - v[i - 1], wrapping */
+static int64_t delta_at(const int64_t *v, size_t i) {
+    return (int64_t)((uint64_t)v[i] - (uint64_t)v[i - 1]);
+}
+
+static int build_for(EncodedColumn *col, const int64_t *v, size_t n) {
+    col->width = bit_width((uint64_t)col->max - (uint64_t)col->min);
+    col->reference = col->min;
+    col->packed = calloc(packed_words(n, col->width), sizeof(uint64_t));
+    if (!col->packed) return -1;
+    for (size_t i = 0; i < n; i++) {
+        pack_put(col->packed, i, col->width, (uint64_t)v[i] - (uint64_t)col->reference);
+    }
+    return 0;
+}
+
+static int build_delta(EncodedColumn *col, const int64_t *v, size_t n,
+                       int64_t dlo, int64_t dhi) {
+    size_t blocks = (n + ENCODING_BLOCK - 1) / ENCODING_BLOCK;
+    col->width = bit_width((uint64_t)dhi - (uint64_t)dlo);
+    col->reference = dlo;
+    col->packed = calloc(packed_words(n, col->width), sizeof(uint64_t));
+    col->anchors = malloc(blocks * sizeof(int64_t));
+    if (!col->packed || !col->anchors) return -1;
+
+    /* Block-leading rows keep a zero entry and are read from 'anchors' */
+    for (size_t i = 0; i < n; i++) {
+        if (i % ENCODING_BLOCK == 0) {
+            col->anchors[i / ENCODING_BLOCK] = v[i];
+            continue;
+        }
+        pack_put(col->packed, i, col->width, (uint64_t)delta_at(v, i) - (uint64_t)dlo);
+    }
+    return 0;
+}
+
+static int build_rle(EncodedColumn *col, const int64_t *v, size_t n, size_t runs) {
+    col->values = malloc(runs * sizeof(int64_t));
+    col->run_ends = malloc(runs * sizeof(uint32_t));
+    if (!col->values || !col->run_ends) return -1;
+
+    size_t r = 0;
+    for (size_t i = 1; i <= n; i++) {
+        if (i < n && v[i] == v[i - 1]) continue;
+        col->values[r] = v[i - 1];
+        col->run_ends[r] = (uint32_t)i;
+        r++;
+    }
+    col->run_count = runs;
+    return 0;
+}
+
+int encoded_column_build(EncodedColumn *col, const int64_t *values, size_t n) {
+    memset(col, 0, sizeof(*col));
+    col->encoding = ENCODING_PLAIN;
+    col->count = n;
+    if (n == 0) return 0;
+    if (n > UINT32_MAX) return -1;
+
+    /* One statistics pass drives the choice */
+    int64_t lo = values[0], hi = values[0];
+    int64_t dlo = 0, dhi = 0;
+    int have_delta = 0;
+    size_t runs = 1;
+    for (size_t i = 1; i < n; i++) {
+        int64_t v = values[i];
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+        runs += v != values[i - 1];
+        if (i % ENCODING_BLOCK == 0) continue;
+        int64_t d = delta_at(values, i);
+        if (!have_delta || d < dlo) dlo = d;
+        if (!have_delta || d > dhi) dhi = d;
+        have_delta = 1;
+    }
+    col->min = lo;
+    col->max = hi;
+
+    size_t blocks = (n + ENCODING_BLOCK - 1) / ENCODING_BLOCK;
+    size_t best = n * sizeof(int64_t);
+    size_t for_bytes = packed_words(n, bit_width((uint64_t)hi - (uint64_t)lo)) * sizeof(uint64_t);
+    size_t rle_bytes = runs * (sizeof(int64_t) + sizeof(uint32_t));
+    size_t delta_bytes = packed_words(n, bit_width((uint64_t)dhi - (uint64_t)dlo)) * sizeof(uint64_t) +
+                         blocks * sizeof(int64_t);
+
+    if (for_bytes < best) {
+        col->encoding = ENCODING_FOR;
+        best = for_bytes;
+    }
+    if (rle_bytes < best) {
+        col->encoding = ENCODING_RLE;
+        best = rle_bytes;
+    }
+    if (delta_bytes < best) col->encoding = ENCODING_DELTA;
+
+    int rc;
+    switch (col->encoding) {
+        case ENCODING_FOR:   rc = build_for(col, values, n); break;
+        case ENCODING_RLE:   rc = build_rle(col, values, n, runs); break;
+        case ENCODING_DELTA: rc = build_delta(col, values, n, dlo, dhi); break;
+        default:
+            col->values = malloc(n * sizeof(int64_t));
+            rc = col->values ? 0 : -1;
+            if (rc == 0) memcpy(col->values, values, n * sizeof(int64_t));
+            break;
+    }
+    if (rc != 0) encoded_column_free(col);
+    return rc;
+}
+
+void encoded_column_free(EncodedColumn *col) {
+    if (!col) return;
+    free(col->packed);
+    free(col->anchors);
+    free(col->values);
+    free(col->run_ends);
+    memset(col, 0, sizeof(*col));
+}
+
+/* First run whose end lies past row i */
+static size_t rle_find(const EncodedColumn *col, size_t i) {
+    size_t lo = 0, hi = col->run_count - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (col->run_ends[mid] > i) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+int64_t encoded_get(const EncodedColumn *col, size_t i) {
+    switch (col->encoding) {
+        case ENCODING_FOR:
+            return (int64_t)((uint64_t)col->reference + pack_get(col->packed, i, col->width));
+        case ENCODING_RLE:
+            return col->values[rle_find(col, i)];
+        case ENCODING_DELTA: {
+            size_t first = i - i % ENCODING_BLOCK;
+            uint64_t v = (uint64_t)col->anchors[i / ENCODING_BLOCK];
+            for (size_t j = first + 1; j <= i; j++) {
+                v += (uint64_t)col->reference + pack_get(col->packed, j, col->width);
+            }
+            return (int64_t)v;
+        }
+        default:
+            return col->values[i];
+    }
+}
+
+void encoded_decode(const EncodedColumn *col, size_t start, size_t n, int64_t *out) {
+    if (n == 0) return;
+
+    switch (col->encoding) {
+        case ENCODING_FOR:
+            for (size_t j = 0; j < n; j++) {
+                out[j] = (int64_t)((uint64_t)col->reference +
+                                   pack_get(col->packed, start + j, col->width));
+            }
+            break;
+        case ENCODING_RLE: {
+            size_t r = rle_find(col, start);
+            for (size_t j = 0; j < n; j++) {
+                if (start + j >= col->run_ends[r]) r++;
+                out[j] = col->values[r];
+            }
+            break;
+        }
+        case ENCODING_DELTA: {
+            uint64_t v = (uint64_t)encoded_get(col, start);
+            out[0] = (int64_t)v;
+            for (size_t j = 1; j < n; j++) {
+                size_t row = start + j;
+                if (row % ENCODING_BLOCK == 0) v = (uint64_t)col->anchors[row / ENCODING_BLOCK];
+                else v += (uint64_t)col->reference + pack_get(col->packed, row, col->width);
+                out[j] = (int64_t)v;
+            }
+            break;
+        }
+        default:
+            memcpy(out, col->values + start, n * sizeof(int64_t));
+            break;
+    }
+}
+
+void encoded_stats(const EncodedColumn *col, int64_t *sum, int64_t *min, int64_t *max) {
+    *sum = 0;
+    if (col->count == 0) return;
+    *min = col->min;
+    *max = col->max;
+
+    uint64_t s = 0;
+    switch (col->encoding) {
+        case ENCODING_FOR:
+            /* n * reference + the packed offsets */
+            s = (uint64_t)col->count * (uint64_t)col->reference;
+            if (col->width > 0) {
+                for (size_t i = 0; i < col->count; i++) s += pack_get(col->packed, i, col->width);
+            }
+            break;
+        case ENCODING_RLE:
+            for (size_t r = 0, start = 0; r < col->run_count; r++) {
+                s += (uint64_t)col->values[r] * (col->run_ends[r] - start);
+                start = col->run_ends[r];
+            }
+            break;
+        case ENCODING_DELTA:
+            /* Running value kept in a register, block by block */
+            for (size_t b = 0; b * ENCODING_BLOCK < col->count; b++) {
+                size_t first = b * ENCODING_BLOCK;
+                size_t end = first + ENCODING_BLOCK < col->count ? first + ENCODING_BLOCK : col->count;
+                uint64_t v = (uint64_t)col->anchors[b];
+                s += v;
+                for (size_t i = first + 1; i < end; i++) {
+                    v += (uint64_t)col->reference + pack_get(col->packed, i, col->width);
+                    s += v;
+                }
+            }
+            break;
+        default:
+            s = (uint64_t)agg_sum_i64(col->values, col->count);
+            break;
+    }
+    *sum = (int64_t)s;
+}
+
+size_t encoded_bytes(const EncodedColumn *col) {
+    switch (col->encoding) {
+        case ENCODING_FOR:
+            return packed_words(col->count, col->width) * sizeof(uint64_t);
+        case ENCODING_DELTA:
+            return packed_words(col->count, col->width) * sizeof(uint64_t) +
+                   (col->count + ENCODING_BLOCK - 1) / ENCODING_BLOCK * sizeof(int64_t);
+        case ENCODING_RLE:
+            return col->run_count * (sizeof(int64_t) + sizeof(uint32_t));
+        default:
+            return col->count * sizeof(int64_t);
+    }
+}
+
+/* ========== Label Dictionaries ========== */
+
+int encoded_labels_build(EncodedLabels *labels, const char *arena,
+                         const size_t *offsets, size_t n) {
+    memset(labels, 0, sizeof(*labels));
+    labels->count = n;
+
+    /* Open addressing over code + 1, sized for the worst case */
+    size_t slot_cap = 16;
+    while (slot_cap < n * 2) slot_cap *= 2;
+    uint32_t *slots = calloc(slot_cap, sizeof(uint32_t));
+    uint32_t *row_codes = malloc((n ? n : 1) * sizeof(uint32_t));
+    size_t *dict = malloc((n ? n : 1) * sizeof(size_t));
+    char *pool = malloc(16);
+    size_t pool_cap = 16;
+    if (!slots || !row_codes || !dict || !pool || n > UINT32_MAX) {
+        free(slots);
+        free(row_codes);
+        free(dict);
+        free(pool);
+        return -1;
+    }
+
+    int rc = 0;
+    for (size_t i = 0; rc == 0 && i < n; i++) {
+        const char *label = arena + offsets[i];
+        size_t slot = hash_string(label) & (slot_cap - 1);
+        while (slots[slot] && strcmp(pool + dict[slots[slot] - 1], label) != 0) {
+            slot = (slot + 1) & (slot_cap - 1);
+        }
+        if (!slots[slot]) {
+            size_t len = strlen(label) + 1;
+            if (labels->arena_used + len > pool_cap) {
+                while (labels->arena_used + len > pool_cap) pool_cap *= 2;
+                char *grown = realloc(pool, pool_cap);
+                if (!grown) {
+                    rc = -1;
+                    break;
+                }
+                pool = grown;
+            }
+            memcpy(pool + labels->arena_used, label, len);
+            dict[labels->distinct] = labels->arena_used;
+            labels->arena_used += len;
+            slots[slot] = (uint32_t)++labels->distinct;
+        }
+        row_codes[i] = slots[slot] - 1;
+    }
+    free(slots);
+
+    labels->arena = pool;
+    labels->offsets = dict;
+    labels->width = bit_width(labels->distinct ? labels->distinct - 1 : 0);
+    labels->codes = rc == 0 ? calloc(packed_words(n, labels->width), sizeof(uint64_t)) : NULL;
+    if (!labels->codes) {
+        free(row_codes);
+        encoded_labels_free(labels);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) pack_put(labels->codes, i, labels->width, row_codes[i]);
+    free(row_codes);
+
+    /* Trim the over-allocated dictionary */
+    size_t *shrunk = realloc(dict, (labels->distinct ? labels->distinct : 1) * sizeof(size_t));
+    if (shrunk) labels->offsets = shrunk;
+    char *trimmed = realloc(pool, labels->arena_used ? labels->arena_used : 1);
+    if (trimmed) labels->arena = trimmed;
+    return 0;
+}
+
+void encoded_labels_free(EncodedLabels *labels) {
+    if (!labels) return;
+    free(labels->arena);
+    free(labels->offsets);
+    free(labels->codes);
+    memset(labels, 0, sizeof(*labels));
+}
+
+const char *encoded_label(const EncodedLabels *labels, size_t i) {
+    return labels->arena + labels->offsets[pack_get(labels->codes, i, labels->width)];
+}
+
+size_t encoded_labels_bytes(const EncodedLabels *labels) {
+    return labels->arena_used + labels->distinct * sizeof(size_t) +
+           packed_words(labels->count, labels->width) * sizeof(uint64_t);
+}
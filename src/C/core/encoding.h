@@ -0,0 +1,92 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Lightweight column encodings.
+ *
+ * An int64 column is encoded in whichever of these formats is smallest
+ * for its data, decided from a single statistics pass:
+ *   - FOR:   frame of reference; each row is stored as (value - min)
+ *            bit-packed at the width of (max - min)
+ *   - DELTA: the first row of every ENCODING_BLOCK rows is kept in
+ *            full, the rest as bit-packed differences from the previous
+ *            row (offset by the smallest difference); wins on sorted keys,
+ *            timestamps and counters
+ *   - RLE:   (value, end row) runs; wins on sorted or clustered keys
+ *   - PLAIN: when nothing else is smaller
+ * Labels are dictionary encoded: each distinct string is stored once
+ * and rows hold bit-packed codes.
+ *
+ * Aggregates run on the encoded form: sum is taken over runs, packed
+ * offsets or deltas, and min/max come from the build statistics, so no
+ * column is ever materialized to answer them.
+ */
+
+#define ENCODING_BLOCK 128
+
+typedef enum {
+    ENCODING_PLAIN,
+    ENCODING_FOR,
+    ENCODING_DELTA,
+    ENCODING_RLE
+} ColumnEncoding;
+
+typedef struct {
+    ColumnEncoding encoding;
+    size_t count;
+    int64_t min;            /* Row statistics (undefined when count == 0) */
+    int64_t max;
+
+    unsigned width;         /* FOR / DELTA: bits per packed entry */
+    int64_t reference;      /* FOR: min; DELTA: smallest difference */
+    uint64_t *packed;       /* FOR / DELTA: packed entries (+1 pad word) */
+    int64_t *anchors;       /* DELTA: first value of every block */
+
+    int64_t *values;        /* PLAIN: every row; RLE: value of each run */
+    uint32_t *run_ends;     /* RLE: row after the end of each run */
+    size_t run_count;
+} EncodedColumn;
+
+typedef struct {
+    char *arena;            /* Distinct labels, NUL-terminated, back to back */
+    size_t arena_used;
+    size_t *offsets;        /* offsets[code] into arena */
+    size_t distinct;
+    unsigned width;         /* Bits per row code */
+    uint64_t *codes;        /* Packed row codes (+1 pad word) */
+    size_t count;
+} EncodedLabels;
+
+/* Encode 'n' values (n < 2^32); returns -1 when out of memory */
+int encoded_column_build(EncodedColumn *col, const int64_t *values, size_t n);
+void encoded_column_free(EncodedColumn *col);
+
+/* Value of row i */
+int64_t encoded_get(const EncodedColumn *col, size_t i);
+
+/* Rows [start, start + n) into 'out' */
+void encoded_decode(const EncodedColumn *col, size_t start, size_t n, int64_t *out);
+
+/* Sum (wrapping like agg_sum_i64), min and max without decoding */
+void encoded_stats(const EncodedColumn *col, int64_t *sum, int64_t *min, int64_t *max);
+
+/* Bytes held by the encoded column */
+size_t encoded_bytes(const EncodedColumn *col);
+
+/*
+ * Dictionary-encode 'n' labels; row i's label is arena + offsets[i].
+ * Returns -1 when out of memory.
+ */
+int encoded_labels_build(EncodedLabels *labels, const char *arena,
+                         const size_t *offsets, size_t n);
+void encoded_labels_free(EncodedLabels *labels);
+const char *encoded_label(const EncodedLabels *labels, size_t i);
+size_t encoded_labels_bytes(const EncodedLabels *labels);
+
+/* "plain", "for", "delta" or "rle" */
+const char *encoding_name(ColumnEncoding e);
+
+#endif
@@ -0,0 +1,203 @@
+/* expr.c - Block-at-a-time bytecode interpreter for computed columns */
+
+#include "expr.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXPR_BLOCK 1024
+
+/* Rows per worker before splitting the evaluation is worth a thread */
+#define EXPR_MIN_ROWS_PER_TASK 65536
+
+/* ========== Compilation ========== */
+
+void expr_program_init(ExprProgram *prog) {
+    memset(prog, 0, sizeof(*prog));
+}
+
+void expr_program_free(ExprProgram *prog) {
+    if (!prog) return;
+    free(prog->code);
+    memset(prog, 0, sizeof(*prog));
+}
+
+/* Scalar semantics shared by constant folding and the block kernels */
+static inline int64_t expr_div(int64_t a, int64_t b) {
+    if (b == 0) return 0;
+    if (b == -1) return (int64_t)(0 - (uint64_t)a);   /* INT64_MIN / -1 */
+    return a / b;
+}
+
+static inline int64_t expr_mod(int64_t a, int64_t b) {
+    return (b == 0 || b == -1) ? 0 : a % b;
+}
+
+static int64_t expr_apply(ExprOpcode op, int64_t a, int64_t b) {
+    switch (op) {
+        case EXPR_ADD: return (int64_t)((uint64_t)a + (uint64_t)b);
+        case EXPR_SUB: return (int64_t)((uint64_t)a - (uint64_t)b);
+        case EXPR_MUL: return (int64_t)((uint64_t)a * (uint64_t)b);
+        case EXPR_DIV: return expr_div(a, b);
+        case EXPR_MOD: return expr_mod(a, b);
+        default:       return 0;
+    }
+}
+
+int expr_emit(ExprProgram *prog, ExprOpcode op, int64_t arg) {
+    int binary = op != EXPR_LOAD && op != EXPR_CONST && op != EXPR_NEG;
+    size_t needs = binary ? 2 : (op == EXPR_NEG ? 1 : 0);
+    if (prog->depth < needs) return -1;
+
+    /* Fold operations whose operands are all constants */
+    ExprInstr *code = prog->code;
+    size_t n = prog->length;
+    if (op == EXPR_NEG && n >= 1 && code[n - 1].op == EXPR_CONST) {
+        code[n - 1].arg = (int64_t)(0 - (uint64_t)code[n - 1].arg);
+        return 0;
+    }
+    if (binary && n >= 2 && code[n - 1].op == EXPR_CONST && code[n - 2].op == EXPR_CONST) {
+        code[n - 2].arg = expr_apply(op, code[n - 2].arg, code[n - 1].arg);
+        prog->length--;
+        prog->depth--;
+        return 0;
+    }
+
+    if (prog->length == prog->capacity) {
+        size_t cap = prog->capacity ? prog->capacity * 2 : 16;
+        ExprInstr *grown = realloc(prog->code, cap * sizeof(ExprInstr));
+        if (!grown) return -1;
+        prog->code = grown;
+        prog->capacity = cap;
+    }
+
+    prog->code[prog->length].op = op;
+    prog->code[prog->length].arg = arg;
+    prog->length++;
+
+    if (op == EXPR_LOAD || op == EXPR_CONST) {
+        prog->depth++;
+        if (prog->depth > prog->max_depth) prog->max_depth = prog->depth;
+        if (op == EXPR_LOAD && (size_t)arg + 1 > prog->inputs) prog->inputs = (size_t)arg + 1;
+    } else if (binary) {
+        prog->depth--;
+    }
+    return 0;
+}
+
+/* ========== Block Kernels ========== */
+
+/*
+ * Each kernel is a straight loop over one block with no calls or
+ * data-dependent branches in the common cases, so the compiler can
+ * vectorize add/sub/mul/neg.
+ */
+static void kernel_binary(ExprOpcode op, const int64_t *a, const int64_t *b,
+                          int64_t *out, size_t n) {
+    const uint64_t *ua = (const uint64_t *)a;
+    const uint64_t *ub = (const uint64_t *)b;
+    uint64_t *uo = (uint64_t *)out;
+
+    switch (op) {
+        case EXPR_ADD: for (size_t i = 0; i < n; i++) uo[i] = ua[i] + ub[i]; break;
+        case EXPR_SUB: for (size_t i = 0; i < n; i++) uo[i] = ua[i] - ub[i]; break;
+        case EXPR_MUL: for (size_t i = 0; i < n; i++) uo[i] = ua[i] * ub[i]; break;
+        case EXPR_DIV: for (size_t i = 0; i < n; i++) out[i] = expr_div(a[i], b[i]); break;
+        case EXPR_MOD: for (size_t i = 0; i < n; i++) out[i] = expr_mod(a[i], b[i]); break;
+        default: break;
+    }
+}
+
+/* ========== Evaluation ========== */
+
+typedef struct {
+    const ExprProgram *prog;
+    const DataSet *const *inputs;
+    size_t rows;
+    size_t tasks;
+    int64_t *out;
+    int failed;
+} ExprJob;
+
+/*
+ * Run the program over rows [begin, end). Stack slots are pointers:
+ * loads of physical columns point straight into them, and only results
+ * of operations are written to the slot's own block buffer.
+ */
+static int expr_run_range(const ExprJob *job, size_t begin, size_t end) {
+    const ExprProgram *prog = job->prog;
+    size_t depth = prog->max_depth;
+
+    int64_t *buffers = malloc(depth * EXPR_BLOCK * sizeof(int64_t));
+    const int64_t **slots = malloc(depth * sizeof(int64_t *));
+    if (!buffers || !slots) {
+        free(buffers);
+        free(slots);
+        return -1;
+    }
+
+    for (size_t start = begin; start < end; start += EXPR_BLOCK) {
+        size_t n = end - start < EXPR_BLOCK ? end - start : EXPR_BLOCK;
+        size_t sp = 0;
+
+        for (size_t pc = 0; pc < prog->length; pc++) {
+            const ExprInstr *ins = &prog->code[pc];
+            int64_t *buf = buffers + sp * EXPR_BLOCK;
+
+            switch (ins->op) {
+                case EXPR_LOAD: {
+                    slots[sp++] = dataset_values_block(job->inputs[ins->arg], start, n, buf);
+                    break;
+                }
+                case EXPR_CONST:
+                    for (size_t i = 0; i < n; i++) buf[i] = ins->arg;
+                    slots[sp++] = buf;
+                    break;
+                case EXPR_NEG: {
+                    int64_t *dst = buf - EXPR_BLOCK;
+                    const uint64_t *src = (const uint64_t *)slots[sp - 1];
+                    for (size_t i = 0; i < n; i++) dst[i] = (int64_t)(0 - src[i]);
+                    slots[sp - 1] = dst;
+                    break;
+                }
+                default: {
+                    int64_t *dst = buf - 2 * EXPR_BLOCK;
+                    kernel_binary(ins->op, slots[sp - 2], slots[sp - 1], dst, n);
+                    slots[sp - 2] = dst;
+                    sp--;
+                    break;
+                }
+            }
+        }
+
+        memcpy(job->out + start, slots[0], n * sizeof(int64_t));
+    }
+
+    free(buffers);
+    free(slots);
+    return 0;
+}
+
+static void expr_task(void *ctx, size_t task) {
+    ExprJob *job = ctx;
+    size_t begin = job->rows * task / job->tasks;
+    size_t end = job->rows * (task + 1) / job->tasks;
+    if (expr_run_range(job, begin, end) != 0) job->failed = 1;
+}
+
+int expr_eval(const ExprProgram *prog, const DataSet *const *inputs, size_t rows, int64_t *out) {
+    if (!prog || !out || prog->length == 0 || prog->depth != 1) return -1;
+    for (size_t k = 0; k < prog->inputs; k++) {
+        if (!inputs[k] || inputs[k]->count < rows) return -1;
+    }
+
+    ExprJob job = { prog, inputs, rows, parallel_plan(rows, EXPR_MIN_ROWS_PER_TASK), out, 0 };
+    parallel_run(job.tasks, expr_task, &job);
+
+    if (job.failed) {
+        fprintf(stderr, "Expression error: out of memory evaluating %zu rows.\n", rows);
+        return -1;
+    }
+    return 0;
+}
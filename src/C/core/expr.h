@@ -0,0 +1,55 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+
+/*
+ * Bytecode for computed columns. Programs run on a stack whose slots
+ * are whole blocks of rows, so every instruction is one tight loop over
+ * a block instead of one dispatch per row.
+ */
+typedef enum {
+    EXPR_LOAD,      /* Push input #arg */
+    EXPR_CONST,     /* Push the constant arg */
+    EXPR_ADD,       /* Pop b, pop a, push a + b */
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,       /* Integer division; x / 0 is 0 */
+    EXPR_MOD,       /* Remainder; x % 0 is 0 */
+    EXPR_NEG,       /* Negate the top */
+} ExprOpcode;
+
+typedef struct {
+    ExprOpcode op;
+    int64_t arg;
+} ExprInstr;
+
+typedef struct {
+    ExprInstr *code;
+    size_t length;
+    size_t capacity;
+    size_t depth;       /* Stack depth after the last instruction */
+    size_t max_depth;   /* Stack slots needed to run the program */
+    size_t inputs;      /* 1 + highest input index loaded */
+} ExprProgram;
+
+void expr_program_init(ExprProgram *prog);
+void expr_program_free(ExprProgram *prog);
+
+/*
+ * Append one instruction. Operations on constants are folded at emit
+ * time. Returns -1 on stack underflow or when out of memory.
+ */
+int expr_emit(ExprProgram *prog, ExprOpcode op, int64_t arg);
+
+/*
+ * Evaluate a complete program (depth 1) over 'rows' rows. Input k is
+ * inputs[k], which must have at least 'rows' rows; results are written
+ * to out[0 .. rows-1]. Arithmetic wraps on overflow.
+ * Returns 0 on success, -1 on failure.
+ */
+int expr_eval(const ExprProgram *prog, const DataSet *const *inputs, size_t rows, int64_t *out);
+
+#endif
@@ -0,0 +1,219 @@
+/* filter.c - Block-at-a-time, branch-free predicate evaluation */
+
+#include "filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILTER_BLOCK 1024
+
+/* ========== Predicate Construction ========== */
+
+static FilterExpr *filter_node(FilterNodeKind kind) {
+    FilterExpr *e = calloc(1, sizeof(FilterExpr));
+    if (e) e->kind = kind;
+    return e;
+}
+
+FilterExpr *filter_compare_value(FilterOp op, const int64_t *numbers, size_t count) {
+    FilterExpr *e = filter_node(FILTER_NODE_COMPARE);
+    if (!e) return NULL;
+
+    e->column = FILTER_COL_VALUE;
+    e->op = op;
+    e->item_count = count;
+    e->numbers = malloc((count ? count : 1) * sizeof(int64_t));
+    if (!e->numbers) {
+        free(e);
+        return NULL;
+    }
+    if (count) memcpy(e->numbers, numbers, count * sizeof(int64_t));
+    return e;
+}
+
+FilterExpr *filter_compare_label(FilterOp op, const char *const *strings, size_t count) {
+    FilterExpr *e = filter_node(FILTER_NODE_COMPARE);
+    if (!e) return NULL;
+
+    e->column = FILTER_COL_LABEL;
+    e->op = op;
+    e->strings = calloc(count ? count : 1, sizeof(char *));
+    if (!e->strings) {
+        free(e);
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        e->strings[i] = strdup(strings[i]);
+        if (!e->strings[i]) {
+            filter_expr_free(e);
+            return NULL;
+        }
+        e->item_count++;
+    }
+    return e;
+}
+
+FilterExpr *filter_logical(FilterNodeKind kind, FilterExpr *left, FilterExpr *right) {
+    FilterExpr *e = (left && (right || kind == FILTER_NODE_NOT)) ? filter_node(kind) : NULL;
+    if (!e) {
+        filter_expr_free(left);
+        filter_expr_free(right);
+        return NULL;
+    }
+    e->left = left;
+    e->right = right;
+    return e;
+}
+
+void filter_expr_free(FilterExpr *expr) {
+    if (!expr) return;
+    filter_expr_free(expr->left);
+    filter_expr_free(expr->right);
+    if (expr->strings) {
+        for (size_t i = 0; i < expr->item_count; i++) free(expr->strings[i]);
+        free(expr->strings);
+    }
+    free(expr->numbers);
+    free(expr);
+}
+
+/* ========== Block Evaluation ========== */
+
+/* One block of rows: values are contiguous, labels resolved per row */
+typedef struct {
+    const DataSet *physical;
+    const uint32_t *rows;   /* NULL when the block is physical rows start.. */
+    size_t start;
+    size_t n;
+    const int64_t *values;
+} FilterBlock;
+
+static void compare_values(FilterOp op, int64_t c, const int64_t *v, size_t n, uint8_t *m) {
+    switch (op) {
+        case FILTER_EQ: for (size_t j = 0; j < n; j++) m[j] = v[j] == c; break;
+        case FILTER_NE: for (size_t j = 0; j < n; j++) m[j] = v[j] != c; break;
+        case FILTER_LT: for (size_t j = 0; j < n; j++) m[j] = v[j] < c; break;
+        case FILTER_LE: for (size_t j = 0; j < n; j++) m[j] = v[j] <= c; break;
+        case FILTER_GT: for (size_t j = 0; j < n; j++) m[j] = v[j] > c; break;
+        case FILTER_GE: for (size_t j = 0; j < n; j++) m[j] = v[j] >= c; break;
+        default: memset(m, 0, n); break;
+    }
+}
+
+static int label_test(FilterOp op, int cmp) {
+    switch (op) {
+        case FILTER_EQ: return cmp == 0;
+        case FILTER_NE: return cmp != 0;
+        case FILTER_LT: return cmp < 0;
+        case FILTER_LE: return cmp <= 0;
+        case FILTER_GT: return cmp > 0;
+        case FILTER_GE: return cmp >= 0;
+        default: return 0;
+    }
+}
+
+static void filter_compare(const FilterExpr *e, const FilterBlock *b, uint8_t *m) {
+    int set_op = e->op == FILTER_IN || e->op == FILTER_NOT_IN;
+
+    if (e->column == FILTER_COL_VALUE) {
+        if (!set_op) {
+            compare_values(e->op, e->numbers[0], b->values, b->n, m);
+            return;
+        }
+        memset(m, 0, b->n);
+        for (size_t k = 0; k < e->item_count; k++) {
+            int64_t c = e->numbers[k];
+            for (size_t j = 0; j < b->n; j++) m[j] |= b->values[j] == c;
+        }
+    } else {
+        const DataSet *p = b->physical;
+        for (size_t j = 0; j < b->n; j++) {
+            size_t row = b->rows ? b->rows[j] : b->start + j;
+            const char *label = dataset_row_label(p, row);
+            if (!set_op) {
+                m[j] = (uint8_t)label_test(e->op, strcmp(label, e->strings[0]));
+                continue;
+            }
+            uint8_t hit = 0;
+            for (size_t k = 0; k < e->item_count; k++) {
+                hit |= strcmp(label, e->strings[k]) == 0;
+            }
+            m[j] = hit;
+        }
+    }
+
+    if (e->op == FILTER_NOT_IN) {
+        for (size_t j = 0; j < b->n; j++) m[j] ^= 1;
+    }
+}
+
+static void filter_eval(const FilterExpr *e, const FilterBlock *b, uint8_t *m) {
+    uint8_t rhs[FILTER_BLOCK];
+
+    switch (e->kind) {
+        case FILTER_NODE_COMPARE:
+            filter_compare(e, b, m);
+            break;
+        case FILTER_NODE_AND:
+            filter_eval(e->left, b, m);
+            filter_eval(e->right, b, rhs);
+            for (size_t j = 0; j < b->n; j++) m[j] &= rhs[j];
+            break;
+        case FILTER_NODE_OR:
+            filter_eval(e->left, b, m);
+            filter_eval(e->right, b, rhs);
+            for (size_t j = 0; j < b->n; j++) m[j] |= rhs[j];
+            break;
+        case FILTER_NODE_NOT:
+            filter_eval(e->left, b, m);
+            for (size_t j = 0; j < b->n; j++) m[j] ^= 1;
+            break;
+    }
+}
+
+/* ========== Operator ========== */
+
+DataSet *filter_dataset(DataSet *src, const FilterExpr *expr, const char *title) {
+    if (!src || !expr) return NULL;
+
+    DataSet *physical = dataset_physical(src);
+    if (physical->count > UINT32_MAX) {
+        fprintf(stderr, "Filter error: '%s' has too many rows to select from.\n", src->title);
+        return NULL;
+    }
+
+    uint32_t *sel = malloc((src->count ? src->count : 1) * sizeof(uint32_t));
+    if (!sel) {
+        fprintf(stderr, "Filter error: out of memory filtering '%s'.\n", src->title);
+        return NULL;
+    }
+
+    int64_t gathered[FILTER_BLOCK];
+    uint8_t mask[FILTER_BLOCK];
+    size_t out = 0;
+
+    for (size_t start = 0; start < src->count; start += FILTER_BLOCK) {
+        FilterBlock b;
+        b.physical = physical;
+        b.start = start;
+        b.n = src->count - start < FILTER_BLOCK ? src->count - start : FILTER_BLOCK;
+
+        b.rows = src->sel ? src->sel + start : NULL;
+        b.values = dataset_values_block(src, start, b.n, gathered);
+
+        filter_eval(expr, &b, mask);
+
+        /* Branch-free compaction: always write, advance only on a match */
+        for (size_t j = 0; j < b.n; j++) {
+            sel[out] = b.rows ? b.rows[j] : (uint32_t)(start + j);
+            out += mask[j];
+        }
+    }
+
+    if (out < src->count) {
+        uint32_t *shrunk = realloc(sel, (out ? out : 1) * sizeof(uint32_t));
+        if (shrunk) sel = shrunk;
+    }
+
+    return dataset_view_new(src, sel, out, title);
+}
@@ -0,0 +1,63 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+
+/* Columns a dataset predicate can test */
+typedef enum {
+    FILTER_COL_VALUE,
+    FILTER_COL_LABEL,
+} FilterColumn;
+
+typedef enum {
+    FILTER_EQ,
+    FILTER_NE,
+    FILTER_LT,
+    FILTER_LE,
+    FILTER_GT,
+    FILTER_GE,
+    FILTER_IN,
+    FILTER_NOT_IN,
+} FilterOp;
+
+typedef enum {
+    FILTER_NODE_COMPARE,
+    FILTER_NODE_AND,
+    FILTER_NODE_OR,
+    FILTER_NODE_NOT,
+} FilterNodeKind;
+
+/*
+ * Predicate tree. Comparisons carry one literal (numbers[0] or
+ * strings[0]) or, for IN / NOT IN, a list of 'item_count' literals of
+ * the column's type. AND / OR use both children, NOT only 'left'.
+ */
+typedef struct FilterExpr {
+    FilterNodeKind kind;
+    FilterColumn column;
+    FilterOp op;
+    int64_t *numbers;
+    char **strings;
+    size_t item_count;
+    struct FilterExpr *left;
+    struct FilterExpr *right;
+} FilterExpr;
+
+/* Constructors; each returns NULL when out of memory */
+FilterExpr *filter_compare_value(FilterOp op, const int64_t *numbers, size_t count);
+FilterExpr *filter_compare_label(FilterOp op, const char *const *strings, size_t count);
+FilterExpr *filter_logical(FilterNodeKind kind, FilterExpr *left, FilterExpr *right);
+void filter_expr_free(FilterExpr *expr);
+
+/*
+ * Evaluate 'expr' over every row of 'src' and return a view of the
+ * matching rows, titled 'title'. Rows are processed in blocks: each
+ * comparison writes a 0/1 byte mask without branching, masks are
+ * combined with &, | and ^, and the survivors are compacted into the
+ * view's selection vector. No column data is copied.
+ */
+DataSet *filter_dataset(DataSet *src, const FilterExpr *expr, const char *title);
+
+#endif
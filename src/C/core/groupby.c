@@ -0,0 +1,200 @@
+/* groupby.c - Hash group-by aggregation with per-thread partial tables */
+
+#include "groupby.h"
+#include "hash.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Rows per worker before splitting the input is worth a thread */
+#define GROUPBY_MIN_ROWS_PER_TASK 65536
+#define GROUPBY_INITIAL_SLOTS 64
+
+/* Open-addressing table under construction; empty slots have key NULL */
+typedef struct {
+    GroupSlot *slots;
+    size_t capacity;
+    size_t count;
+    int failed;
+} GroupHash;
+
+static GroupSlot *group_find(GroupHash *t, const char *key, uint64_t hash) {
+    size_t mask = t->capacity - 1;
+    size_t slot = hash & mask;
+
+    for (;;) {
+        GroupSlot *g = &t->slots[slot];
+        if (!g->key) return g;
+        if (g->hash == hash && strcmp(g->key, key) == 0) return g;
+        slot = (slot + 1) & mask;
+    }
+}
+
+static int group_grow(GroupHash *t) {
+    size_t old_cap = t->capacity;
+    GroupSlot *old = t->slots;
+
+    size_t cap = old_cap ? old_cap * 2 : GROUPBY_INITIAL_SLOTS;
+    GroupSlot *slots = calloc(cap, sizeof(GroupSlot));
+    if (!slots) return -1;
+
+    t->slots = slots;
+    t->capacity = cap;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].key) *group_find(t, old[i].key, old[i].hash) = old[i];
+    }
+
+    free(old);
+    return 0;
+}
+
+/* Find or create the slot for 'key' (load factor kept at or below 70%) */
+static GroupSlot *group_upsert(GroupHash *t, const char *key, uint64_t hash, size_t row) {
+    if ((t->count + 1) * 10 > t->capacity * 7 && group_grow(t) != 0) {
+        t->failed = 1;
+        return NULL;
+    }
+
+    GroupSlot *g = group_find(t, key, hash);
+    if (!g->key) {
+        g->key = key;
+        g->hash = hash;
+        g->first_row = row;
+        welford_init(&g->var);
+        t->count++;
+    }
+    return g;
+}
+
+static void group_accumulate(GroupHash *t, const DataSet *src, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        const char *key = dataset_label(src, i);
+        int64_t v = dataset_value(src, i);
+
+        GroupSlot *g = group_upsert(t, key, hash_string(key), i);
+        if (!g) return;
+
+        if (g->count == 0 || v < g->min) g->min = v;
+        if (g->count == 0 || v > g->max) g->max = v;
+        g->sum += v;
+        g->count++;
+        welford_add(&g->var, (double)v);
+    }
+}
+
+static void group_merge_slot(GroupHash *t, const GroupSlot *part) {
+    GroupSlot *g = group_upsert(t, part->key, part->hash, part->first_row);
+    if (!g) return;
+
+    if (g->count == 0) {
+        *g = *part;
+        return;
+    }
+
+    if (part->first_row < g->first_row) g->first_row = part->first_row;
+    if (part->min < g->min) g->min = part->min;
+    if (part->max > g->max) g->max = part->max;
+    g->sum += part->sum;
+    g->count += part->count;
+    welford_merge(&g->var, &part->var);
+}
+
+/* ========== Parallel Build ========== */
+
+typedef struct {
+    const DataSet *src;
+    size_t tasks;
+    GroupHash *partials;
+} GroupJob;
+
+static void group_task(void *ctx, size_t task) {
+    GroupJob *job = ctx;
+    size_t n = job->src->count;
+    size_t begin = n * task / job->tasks;
+    size_t end = n * (task + 1) / job->tasks;
+    group_accumulate(&job->partials[task], job->src, begin, end);
+}
+
+static int compare_first_row(const void *a, const void *b) {
+    size_t x = ((const GroupSlot *)a)->first_row;
+    size_t y = ((const GroupSlot *)b)->first_row;
+    return (x > y) - (x < y);
+}
+
+int groupby_label(const DataSet *src, GroupTable *out) {
+    if (!src || !out) return -1;
+    out->groups = NULL;
+    out->count = 0;
+
+    size_t tasks = parallel_plan(src->count, GROUPBY_MIN_ROWS_PER_TASK);
+    GroupHash *partials = calloc(tasks, sizeof(GroupHash));
+    if (!partials) return -1;
+
+    GroupJob job = { src, tasks, partials };
+    parallel_run(tasks, group_task, &job);
+
+    /* Merge the partial tables into the first one */
+    GroupHash *final = &partials[0];
+    for (size_t t = 1; t < tasks; t++) {
+        for (size_t i = 0; i < partials[t].capacity; i++) {
+            if (partials[t].slots[i].key) group_merge_slot(final, &partials[t].slots[i]);
+        }
+        final->failed |= partials[t].failed;
+        free(partials[t].slots);
+    }
+
+    if (final->failed) {
+        fprintf(stderr, "Group-by error: out of memory grouping '%s'.\n", src->title);
+        free(final->slots);
+        free(partials);
+        return -1;
+    }
+
+    /* Compact occupied slots to the front and restore input order */
+    size_t n = 0;
+    for (size_t i = 0; i < final->capacity; i++) {
+        if (final->slots[i].key) final->slots[n++] = final->slots[i];
+    }
+    qsort(final->slots, n, sizeof(GroupSlot), compare_first_row);
+
+    out->groups = final->slots;
+    out->count = n;
+    free(partials);
+    return 0;
+}
+
+void groupby_free(GroupTable *t) {
+    if (!t) return;
+    free(t->groups);
+    t->groups = NULL;
+    t->count = 0;
+}
+
+static int64_t group_value(const GroupSlot *g, GroupAggregate agg) {
+    switch (agg) {
+        case GROUP_AGG_SUM:    return g->sum;
+        case GROUP_AGG_AVG:    return g->count ? llround((double)g->sum / (double)g->count) : 0;
+        case GROUP_AGG_MIN:    return g->min;
+        case GROUP_AGG_MAX:    return g->max;
+        case GROUP_AGG_COUNT:  return (int64_t)g->count;
+        case GROUP_AGG_STDDEV: return llround(welford_stddev(&g->var));
+    }
+    return 0;
+}
+
+int groupby_to_dataset(const GroupTable *t, GroupAggregate agg,
+                       const char *title, DataSet *out) {
+    dataset_init(out, title);
+    if (!t || t->count == 0) return 0;
+
+    if (dataset_reserve(out, t->count, 0) != 0) return -1;
+    for (size_t i = 0; i < t->count; i++) {
+        if (dataset_add(out, t->groups[i].key, group_value(&t->groups[i], agg)) != 0) {
+            dataset_free(out);
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef GROUPBY_H
+#define GROUPBY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+#include "quantile.h"
+
+/* Aggregates a group-by can produce from its per-group accumulators */
+typedef enum {
+    GROUP_AGG_SUM,
+    GROUP_AGG_AVG,
+    GROUP_AGG_MIN,
+    GROUP_AGG_MAX,
+    GROUP_AGG_COUNT,
+    GROUP_AGG_STDDEV,
+} GroupAggregate;
+
+/* Per-group accumulators, all filled in the same pass over the rows */
+typedef struct {
+    const char *key;    /* Label; points into the source dataset's arena */
+    uint64_t hash;
+    size_t first_row;   /* First occurrence, keeps output in input order */
+    size_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    WelfordState var;
+} GroupSlot;
+
+/*
+ * Result of a group-by: one dense slot per distinct key, ordered by
+ * first appearance in the input.
+ */
+typedef struct {
+    GroupSlot *groups;
+    size_t count;
+} GroupTable;
+
+/*
+ * Group 'src' by label. Rows are hashed into open-addressing tables
+ * (linear probing, slots hold the accumulators inline); large inputs
+ * are split across worker threads that each fill a partial table,
+ * and the partials are merged at the end.
+ */
+int groupby_label(const DataSet *src, GroupTable *out);
+void groupby_free(GroupTable *t);
+
+/* Materialize one aggregate per group into 'out' (initialized here) */
+int groupby_to_dataset(const GroupTable *t, GroupAggregate agg,
+                       const char *title, DataSet *out);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * 64-bit FNV-1a, the string hash behind every hash table in the tree
+ * (registry, group-by, join, label and column dictionaries, cache file
+ * names). Header-only so the per-row callers inline it.
+ */
+
+#define HASH_FNV_OFFSET 14695981039346656037ULL
+#define HASH_FNV_PRIME 1099511628211ULL
+
+/* Hash of a NUL-terminated string */
+static inline uint64_t hash_string(const char *s) {
+    uint64_t h = HASH_FNV_OFFSET;
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        h ^= *p;
+        h *= HASH_FNV_PRIME;
+    }
+    return h;
+}
+
+/* Hash of 'len' bytes; equals hash_string() over the same text */
+static inline uint64_t hash_bytes(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = HASH_FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= HASH_FNV_PRIME;
+    }
+    return h;
+}
+
+/*
+ * Word-at-a-time variant for checksumming large blocks: eight bytes per
+ * multiply, with a shift to fold the high bits back down. Not equal to
+ * hash_bytes().
+ */
+static inline uint64_t hash_words(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = HASH_FNV_OFFSET;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * HASH_FNV_PRIME;
+        h ^= h >> 29;
+    }
+    for (; i < len; i++) h = (h ^ p[i]) * HASH_FNV_PRIME;
+    return h;
+}
+
+#endif
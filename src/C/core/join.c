@@ -0,0 +1,279 @@
+/* join.c - In-memory hash join on labels with a Bloom pre-filter */
+
+#include "join.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JOIN_NO_ROW UINT32_MAX
+
+/* Probe/build size ratio from which a Bloom filter pays for itself */
+#define JOIN_BLOOM_RATIO 4
+#define JOIN_BLOOM_BITS_PER_KEY 10
+
+/* ========== Build Side ========== */
+
+/* One slot per distinct build label; its rows are chained through 'next' */
+typedef struct {
+    const char *key;    /* NULL for an empty slot */
+    uint64_t hash;
+    uint32_t head;      /* First build row with this label */
+} JoinSlot;
+
+typedef struct {
+    JoinSlot *slots;
+    size_t mask;
+    uint32_t *next;     /* Next build row with the same label, or JOIN_NO_ROW */
+
+    uint64_t *bloom;    /* NULL when the probe side is not worth filtering */
+    size_t bloom_mask;  /* Bit count - 1 */
+} JoinTable;
+
+static JoinSlot *join_find(const JoinTable *t, const char *key, uint64_t hash) {
+    size_t slot = hash & t->mask;
+    for (;;) {
+        JoinSlot *s = &t->slots[slot];
+        if (!s->key) return s;
+        if (s->hash == hash && strcmp(s->key, key) == 0) return s;
+        slot = (slot + 1) & t->mask;
+    }
+}
+
+/* Three probe bits derived from one hash (double hashing) */
+static inline void bloom_add(JoinTable *t, uint64_t hash) {
+    uint64_t h2 = (hash >> 32) | 1;
+    for (int i = 0; i < 3; i++) {
+        size_t bit = (hash + i * h2) & t->bloom_mask;
+        t->bloom[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+static inline int bloom_may_contain(const JoinTable *t, uint64_t hash) {
+    uint64_t h2 = (hash >> 32) | 1;
+    for (int i = 0; i < 3; i++) {
+        size_t bit = (hash + i * h2) & t->bloom_mask;
+        if (!(t->bloom[bit >> 6] & (1ULL << (bit & 63)))) return 0;
+    }
+    return 1;
+}
+
+static void join_table_free(JoinTable *t) {
+    free(t->slots);
+    free(t->next);
+    free(t->bloom);
+}
+
+static int join_table_build(JoinTable *t, const DataSet *build, size_t probe_rows) {
+    memset(t, 0, sizeof(*t));
+
+    /* Sized for at most 50% load even if every label is distinct */
+    size_t cap = 16;
+    while (cap < build->count * 2) cap *= 2;
+
+    t->slots = calloc(cap, sizeof(JoinSlot));
+    t->next = malloc((build->count ? build->count : 1) * sizeof(uint32_t));
+    if (!t->slots || !t->next) {
+        join_table_free(t);
+        return -1;
+    }
+    t->mask = cap - 1;
+
+    /* Insert back to front so every chain lists its rows in order */
+    size_t distinct = 0;
+    for (size_t i = build->count; i-- > 0;) {
+        const char *key = dataset_label(build, i);
+        uint64_t hash = hash_string(key);
+        JoinSlot *s = join_find(t, key, hash);
+        if (!s->key) {
+            s->key = key;
+            s->hash = hash;
+            s->head = JOIN_NO_ROW;
+            distinct++;
+        }
+        t->next[i] = s->head;
+        s->head = (uint32_t)i;
+    }
+
+    if (probe_rows >= distinct * JOIN_BLOOM_RATIO) {
+        size_t bits = 64;
+        while (bits < distinct * JOIN_BLOOM_BITS_PER_KEY) bits *= 2;
+        t->bloom = calloc(bits / 64, sizeof(uint64_t));
+        if (t->bloom) {
+            t->bloom_mask = bits - 1;
+            for (size_t c = 0; c <= t->mask; c++) {
+                if (t->slots[c].key) bloom_add(t, t->slots[c].hash);
+            }
+        }
+    }
+    return 0;
+}
+
+/* ========== Probe ========== */
+
+/* Matched (left row, right row) pairs; right is JOIN_NO_ROW for LEFT misses */
+typedef struct {
+    uint32_t *left;
+    uint32_t *right;
+    size_t count;
+    size_t capacity;
+} JoinPairs;
+
+static int pairs_push(JoinPairs *p, uint32_t l, uint32_t r) {
+    if (p->count == p->capacity) {
+        size_t cap = p->capacity ? p->capacity * 2 : 256;
+        uint32_t *nl = realloc(p->left, cap * sizeof(uint32_t));
+        if (!nl) return -1;
+        p->left = nl;
+        uint32_t *nr = realloc(p->right, cap * sizeof(uint32_t));
+        if (!nr) return -1;
+        p->right = nr;
+        p->capacity = cap;
+    }
+    p->left[p->count] = l;
+    p->right[p->count] = r;
+    p->count++;
+    return 0;
+}
+
+/*
+ * Stable counting sort of the pairs by left row. Used when the table
+ * was built on the left input, so pairs were produced in right order.
+ */
+static int pairs_order_by_left(JoinPairs *p, size_t left_rows) {
+    size_t *start = calloc(left_rows + 1, sizeof(size_t));
+    uint32_t *l = malloc((p->count ? p->count : 1) * sizeof(uint32_t));
+    uint32_t *r = malloc((p->count ? p->count : 1) * sizeof(uint32_t));
+    if (!start || !l || !r) {
+        free(start);
+        free(l);
+        free(r);
+        return -1;
+    }
+
+    for (size_t i = 0; i < p->count; i++) start[p->left[i] + 1]++;
+    for (size_t i = 0; i < left_rows; i++) start[i + 1] += start[i];
+    for (size_t i = 0; i < p->count; i++) {
+        size_t pos = start[p->left[i]]++;
+        l[pos] = p->left[i];
+        r[pos] = p->right[i];
+    }
+
+    free(p->left);
+    free(p->right);
+    free(start);
+    p->left = l;
+    p->right = r;
+    return 0;
+}
+
+static int join_probe(const JoinTable *t, const DataSet *probe, int probe_is_left,
+                      JoinKind kind, uint8_t *matched, JoinPairs *out) {
+    for (size_t i = 0; i < probe->count; i++) {
+        const char *key = dataset_label(probe, i);
+        uint64_t hash = hash_string(key);
+
+        uint32_t row = JOIN_NO_ROW;
+        if (!t->bloom || bloom_may_contain(t, hash)) {
+            const JoinSlot *s = join_find(t, key, hash);
+            if (s->key) row = s->head;
+        }
+
+        if (probe_is_left) {
+            if (row == JOIN_NO_ROW && kind == JOIN_LEFT &&
+                pairs_push(out, (uint32_t)i, JOIN_NO_ROW) != 0) return -1;
+            for (; row != JOIN_NO_ROW; row = t->next[row]) {
+                if (pairs_push(out, (uint32_t)i, row) != 0) return -1;
+            }
+        } else {
+            for (; row != JOIN_NO_ROW; row = t->next[row]) {
+                if (pairs_push(out, row, (uint32_t)i) != 0) return -1;
+                if (matched) matched[row] = 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* ========== Entry Point ========== */
+
+static int join_fill(DataSet *ds, const DataSet *left, const DataSet *right,
+                     const JoinPairs *pairs, const char *right_column) {
+    if (dataset_reserve(ds, pairs->count, 0) != 0) return -1;
+    for (size_t i = 0; i < pairs->count; i++) {
+        size_t l = pairs->left[i];
+        if (dataset_add(ds, dataset_label(left, l), dataset_value(left, l)) != 0) return -1;
+    }
+
+    int col = dataset_add_column(ds, right_column);
+    if (col < 0) return -1;
+
+    int64_t *rv = ds->columns[col - 1].values;
+    for (size_t i = 0; i < pairs->count; i++) {
+        uint32_t r = pairs->right[i];
+        rv[i] = r == JOIN_NO_ROW ? 0 : dataset_value(right, r);
+    }
+    return 0;
+}
+
+/* Produce the matched pairs in left row order */
+static int join_pairs(const DataSet *left, const DataSet *right, JoinKind kind, JoinPairs *pairs) {
+    /* Build on the smaller side, probe with the larger */
+    int build_left = left->count < right->count;
+    const DataSet *build = build_left ? left : right;
+    const DataSet *probe = build_left ? right : left;
+
+    JoinTable table;
+    if (join_table_build(&table, build, probe->count) != 0) return -1;
+
+    uint8_t *matched = NULL;
+    if (build_left && kind == JOIN_LEFT) {
+        matched = calloc(left->count ? left->count : 1, 1);
+        if (!matched) {
+            join_table_free(&table);
+            return -1;
+        }
+    }
+
+    int rc = join_probe(&table, probe, !build_left, kind, matched, pairs);
+    join_table_free(&table);
+
+    if (rc == 0 && build_left) {
+        for (size_t i = 0; matched && rc == 0 && i < left->count; i++) {
+            if (!matched[i]) rc = pairs_push(pairs, (uint32_t)i, JOIN_NO_ROW);
+        }
+        if (rc == 0) rc = pairs_order_by_left(pairs, left->count);
+    }
+
+    free(matched);
+    return rc;
+}
+
+DataSet *join_datasets(const DataSet *left, const DataSet *right, JoinKind kind,
+                       const char *right_column, const char *title) {
+    if (!left || !right || !right_column) return NULL;
+
+    if (left->count >= JOIN_NO_ROW || right->count >= JOIN_NO_ROW) {
+        fprintf(stderr, "Join error: inputs have too many rows to join.\n");
+        return NULL;
+    }
+
+    JoinPairs pairs = { 0 };
+    DataSet *ds = malloc(sizeof(DataSet));
+    if (ds) dataset_init(ds, title);
+
+    if (!ds || join_pairs(left, right, kind, &pairs) != 0 ||
+        join_fill(ds, left, right, &pairs, right_column) != 0) {
+        fprintf(stderr, "Join error: failed to join '%s' and '%s'.\n",
+                left->title, right->title);
+        if (ds) {
+            dataset_free(ds);
+            free(ds);
+        }
+        ds = NULL;
+    }
+
+    free(pairs.left);
+    free(pairs.right);
+    return ds;
+}
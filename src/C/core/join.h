@@ -0,0 +1,31 @@
+#ifndef JOIN_H
+#define JOIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+
+typedef enum {
+    JOIN_INNER,
+    JOIN_LEFT,
+} JoinKind;
+
+/*
+ * Hash join of 'left' and 'right' on their labels. The hash table is
+ * built on the smaller input and probed with the larger one; when the
+ * probe side is much larger, probes are pre-filtered with a Bloom
+ * filter so misses skip the table entirely.
+ *
+ * Returns a new heap dataset titled 'title' with one row per matching
+ * pair, in left row order (then right row order). Each row carries the
+ * shared label, the left value as 'value' and the right value in an
+ * extra column named 'right_column'. LEFT joins also keep left rows
+ * without a match, with 0 in the right column. Columns have no NULL,
+ * so that 0 cannot be told apart from a matched right value of 0; an
+ * INNER join of the same inputs gives just the matched rows.
+ * NULL on failure.
+ */
+DataSet *join_datasets(const DataSet *left, const DataSet *right, JoinKind kind,
+                       const char *right_column, const char *title);
+
+#endif
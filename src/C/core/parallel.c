@@ -0,0 +1,77 @@
+/* parallel.c - Fork/join task runner on top of pthreads */
+
+#include "parallel.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static size_t parallel_thread_budget = 0;
+
+size_t parallel_threads(void) {
+    if (parallel_thread_budget == 0) {
+        const char *env = getenv("LCORE_THREADS");
+        long n = env ? strtol(env, NULL, 10) : 0;
+        if (n <= 0) n = sysconf(_SC_NPROCESSORS_ONLN);
+        parallel_thread_budget = n > 0 ? (size_t)n : 1;
+    }
+    return parallel_thread_budget;
+}
+
+void parallel_set_threads(size_t n) {
+    parallel_thread_budget = n;
+}
+
+size_t parallel_plan(size_t items, size_t min_per_task) {
+    size_t tasks = parallel_threads();
+    if (min_per_task == 0) min_per_task = 1;
+    if (items / min_per_task < tasks) tasks = items / min_per_task;
+    return tasks ? tasks : 1;
+}
+
+typedef struct {
+    void (*fn)(void *ctx, size_t task);
+    void *ctx;
+    size_t task;
+} ParallelTask;
+
+static void *parallel_thread_main(void *arg) {
+    ParallelTask *t = arg;
+    t->fn(t->ctx, t->task);
+    return NULL;
+}
+
+void parallel_run(size_t tasks, void (*fn)(void *ctx, size_t task), void *ctx) {
+    if (tasks <= 1) {
+        if (tasks == 1) fn(ctx, 0);
+        return;
+    }
+
+    pthread_t *threads = malloc(tasks * sizeof(pthread_t));
+    ParallelTask *args = malloc(tasks * sizeof(ParallelTask));
+    char *started = calloc(tasks, 1);
+    if (!threads || !args || !started) {
+        free(threads);
+        free(args);
+        free(started);
+        for (size_t i = 0; i < tasks; i++) fn(ctx, i);
+        return;
+    }
+
+    for (size_t i = 1; i < tasks; i++) {
+        args[i].fn = fn;
+        args[i].ctx = ctx;
+        args[i].task = i;
+        started[i] = pthread_create(&threads[i], NULL, parallel_thread_main, &args[i]) == 0;
+    }
+
+    fn(ctx, 0);
+
+    for (size_t i = 1; i < tasks; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        else fn(ctx, i);
+    }
+
+    free(threads);
+    free(args);
+    free(started);
+}
@@ -0,0 +1,29 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/*
+ * Minimal fork/join helper for the parallel operators.
+ *
+ * The worker count defaults to the number of online CPUs and can be
+ * overridden with the LCORE_THREADS environment variable or
+ * parallel_set_threads().
+ */
+
+/* Worker thread budget (always >= 1) */
+size_t parallel_threads(void);
+void parallel_set_threads(size_t n);
+
+/* Split 'items' into at most parallel_threads() tasks of at least
+   'min_per_task' items each; returns the task count (>= 1) */
+size_t parallel_plan(size_t items, size_t min_per_task);
+
+/*
+ * Run fn(ctx, task) for every task in [0, tasks). Task 0 runs on the
+ * calling thread; the call returns after every task has finished.
+ * Falls back to running tasks serially if a thread cannot be started.
+ */
+void parallel_run(size_t tasks, void (*fn)(void *ctx, size_t task), void *ctx);
+
+#endif
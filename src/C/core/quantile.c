@@ -0,0 +1,345 @@
+/* quantile.c - Running variance, exact selection and the KLL sketch */
+
+#include "quantile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ========== Welford ========== */
+
+void welford_init(WelfordState *w) {
+    w->n = 0;
+    w->mean = 0.0;
+    w->m2 = 0.0;
+}
+
+void welford_add(WelfordState *w, double x) {
+    w->n++;
+    double delta = x - w->mean;
+    w->mean += delta / (double)w->n;
+    w->m2 += delta * (x - w->mean);
+}
+
+void welford_merge(WelfordState *dst, const WelfordState *src) {
+    if (src->n == 0) return;
+    if (dst->n == 0) {
+        *dst = *src;
+        return;
+    }
+
+    double n_a = (double)dst->n, n_b = (double)src->n;
+    double n = n_a + n_b;
+    double delta = src->mean - dst->mean;
+
+    dst->mean += delta * n_b / n;
+    dst->m2 += src->m2 + delta * delta * n_a * n_b / n;
+    dst->n += src->n;
+}
+
+double welford_variance(const WelfordState *w) {
+    if (w->n < 2) return 0.0;
+    return w->m2 / (double)(w->n - 1);
+}
+
+double welford_stddev(const WelfordState *w) {
+    return sqrt(welford_variance(w));
+}
+
+/* ========== Introselect ========== */
+
+#define SELECT_SMALL 16
+
+/*
+ * Typed selection over the half-open range [lo, hi). Duplicates are
+ * handled with a three-way partition so runs of equal keys terminate
+ * immediately.
+ */
+#define DEFINE_SELECT(T, SUFFIX)                                              \
+static void insertion_sort_##SUFFIX(T *v, size_t lo, size_t hi) {            \
+    for (size_t i = lo + 1; i < hi; i++) {                                    \
+        T x = v[i];                                                           \
+        size_t j = i;                                                         \
+        while (j > lo && v[j - 1] > x) {                                      \
+            v[j] = v[j - 1];                                                  \
+            j--;                                                              \
+        }                                                                     \
+        v[j] = x;                                                             \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static T median3_##SUFFIX(T a, T b, T c) {                                    \
+    if (a > b) { T t = a; a = b; b = t; }                                     \
+    if (b > c) b = c;                                                         \
+    return a > b ? a : b;                                                     \
+}                                                                             \
+                                                                              \
+static T select_range_##SUFFIX(T *v, size_t lo, size_t hi, size_t k);         \
+                                                                              \
+/* Guaranteed-good pivot: median of the medians of groups of five */         \
+static T median_of_medians_##SUFFIX(T *v, size_t lo, size_t hi) {             \
+    size_t groups = 0;                                                        \
+    for (size_t g = lo; g < hi; g += 5) {                                     \
+        size_t end = g + 5 < hi ? g + 5 : hi;                                 \
+        insertion_sort_##SUFFIX(v, g, end);                                   \
+        size_t mid = g + (end - g) / 2;                                       \
+        T t = v[lo + groups]; v[lo + groups] = v[mid]; v[mid] = t;            \
+        groups++;                                                             \
+    }                                                                         \
+    return select_range_##SUFFIX(v, lo, lo + groups, lo + groups / 2);        \
+}                                                                             \
+                                                                              \
+static T select_range_##SUFFIX(T *v, size_t lo, size_t hi, size_t k) {        \
+    int budget = 4;                                                           \
+    for (size_t len = hi - lo; len > 1; len >>= 1) budget += 2;               \
+                                                                              \
+    while (hi - lo > SELECT_SMALL) {                                          \
+        T pivot = budget-- > 0                                                \
+            ? median3_##SUFFIX(v[lo], v[lo + (hi - lo) / 2], v[hi - 1])       \
+            : median_of_medians_##SUFFIX(v, lo, hi);                          \
+                                                                              \
+        /* [lo, lt) < pivot, [lt, i) == pivot, (gt, hi) > pivot */            \
+        size_t lt = lo, i = lo, gt = hi;                                      \
+        while (i < gt) {                                                      \
+            T x = v[i];                                                       \
+            if (x < pivot) {                                                  \
+                v[i++] = v[lt];                                               \
+                v[lt++] = x;                                                  \
+            } else if (x > pivot) {                                           \
+                v[i] = v[--gt];                                               \
+                v[gt] = x;                                                    \
+            } else {                                                          \
+                i++;                                                          \
+            }                                                                 \
+        }                                                                     \
+                                                                              \
+        if (k < lt) hi = lt;                                                  \
+        else if (k >= gt) lo = gt;                                            \
+        else return pivot;                                                    \
+    }                                                                         \
+                                                                              \
+    insertion_sort_##SUFFIX(v, lo, hi);                                       \
+    return v[k];                                                              \
+}                                                                             \
+                                                                              \
+T select_nth_##SUFFIX(T *v, size_t n, size_t k) {                             \
+    if (n == 0) return 0;                                                     \
+    if (k >= n) k = n - 1;                                                    \
+    return select_range_##SUFFIX(v, 0, n, k);                                 \
+}                                                                             \
+                                                                              \
+double percentile_##SUFFIX(T *v, size_t n, double p) {                        \
+    if (n == 0) return 0.0;                                                   \
+    if (p < 0.0) p = 0.0;                                                     \
+    if (p > 100.0) p = 100.0;                                                 \
+                                                                              \
+    double pos = p / 100.0 * (double)(n - 1);                                 \
+    size_t k = (size_t)pos;                                                   \
+    double frac = pos - (double)k;                                            \
+                                                                              \
+    T a = select_nth_##SUFFIX(v, n, k);                                       \
+    if (frac == 0.0 || k + 1 >= n) return (double)a;                          \
+                                                                              \
+    /* After selection everything right of k is >= a; take its minimum */    \
+    T b = v[k + 1];                                                           \
+    for (size_t i = k + 2; i < n; i++) {                                      \
+        if (v[i] < b) b = v[i];                                               \
+    }                                                                         \
+    return (double)a + frac * ((double)b - (double)a);                        \
+}
+
+DEFINE_SELECT(int64_t, i64)
+DEFINE_SELECT(double, f64)
+
+/* ========== KLL Sketch ========== */
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* xorshift64: cheap coin flips for the compaction offset */
+static int kll_coin(KLLSketch *s) {
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 7;
+    s->rng ^= s->rng << 17;
+    return (int)(s->rng & 1);
+}
+
+/* Level h of H holds ceil(k * (2/3)^(H-1-h)) items, at least 2 */
+static void kll_update_capacities(KLLSketch *s) {
+    for (uint32_t h = 0; h < s->num_levels; h++) {
+        double cap = ceil((double)s->k * pow(2.0 / 3.0, (double)(s->num_levels - 1 - h)));
+        s->capacities[h] = cap < 2.0 ? 2 : (uint32_t)cap;
+    }
+}
+
+static int kll_reserve(KLLSketch *s, uint32_t h, uint32_t size) {
+    if (size <= s->allocated[h]) return 0;
+
+    uint32_t cap = s->allocated[h] ? s->allocated[h] : 8;
+    while (cap < size) cap *= 2;
+
+    double *buf = realloc(s->levels[h], cap * sizeof(double));
+    if (!buf) return -1;
+    s->levels[h] = buf;
+    s->allocated[h] = cap;
+    return 0;
+}
+
+static int kll_add_level(KLLSketch *s) {
+    if (s->num_levels >= KLL_MAX_LEVELS) return -1;
+    s->num_levels++;
+    kll_update_capacities(s);
+    return 0;
+}
+
+/* Sort level h and promote every other item (random offset) to h + 1 */
+static int kll_compact(KLLSketch *s, uint32_t h) {
+    if (h + 1 >= s->num_levels && kll_add_level(s) != 0) return -1;
+
+    double *items = s->levels[h];
+    uint32_t size = s->sizes[h];
+    uint32_t paired = size & ~1u;
+
+    qsort(items, size, sizeof(double), compare_double);
+
+    if (kll_reserve(s, h + 1, s->sizes[h + 1] + paired / 2) != 0) return -1;
+
+    /* An odd item out stays on this level; which end it comes from is
+       random so the promoted half is not biased up or down */
+    uint32_t start = 0;
+    double leftover = 0.0;
+    if (size & 1u) {
+        if (kll_coin(s)) {
+            start = 1;
+            leftover = items[0];
+        } else {
+            leftover = items[size - 1];
+        }
+    }
+
+    double *up = s->levels[h + 1];
+    uint32_t offset = (uint32_t)kll_coin(s);
+    for (uint32_t i = start + offset; i < start + paired; i += 2) {
+        up[s->sizes[h + 1]++] = items[i];
+    }
+
+    if (size & 1u) items[0] = leftover;
+    s->sizes[h] = size & 1u;
+    return 0;
+}
+
+static uint64_t kll_total(const KLLSketch *s, const uint32_t *per_level) {
+    uint64_t total = 0;
+    for (uint32_t h = 0; h < s->num_levels; h++) total += per_level[h];
+    return total;
+}
+
+/* Lazy compaction: only once the sketch as a whole is over budget, and
+   then the lowest level that is full, so levels keep as many items as
+   the budget allows */
+static int kll_settle(KLLSketch *s) {
+    while (kll_total(s, s->sizes) > kll_total(s, s->capacities)) {
+        uint32_t h = 0;
+        while (h < s->num_levels && s->sizes[h] < s->capacities[h]) h++;
+        if (h == s->num_levels) break;
+        if (kll_compact(s, h) != 0) return -1;
+    }
+    return 0;
+}
+
+int kll_init(KLLSketch *s, uint32_t k) {
+    memset(s, 0, sizeof(*s));
+    s->k = k ? k : KLL_DEFAULT_K;
+    s->rng = 0x9E3779B97F4A7C15ULL;
+    s->num_levels = 1;
+    kll_update_capacities(s);
+    return 0;
+}
+
+void kll_free(KLLSketch *s) {
+    for (uint32_t h = 0; h < KLL_MAX_LEVELS; h++) {
+        free(s->levels[h]);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+int kll_add(KLLSketch *s, double x) {
+    if (kll_reserve(s, 0, s->sizes[0] + 1) != 0) return -1;
+
+    if (s->n == 0 || x < s->min) s->min = x;
+    if (s->n == 0 || x > s->max) s->max = x;
+    s->n++;
+
+    s->levels[0][s->sizes[0]++] = x;
+    return kll_settle(s);
+}
+
+int kll_merge(KLLSketch *dst, const KLLSketch *src) {
+    if (src->n == 0) return 0;
+
+    while (dst->num_levels < src->num_levels) {
+        if (kll_add_level(dst) != 0) return -1;
+    }
+
+    for (uint32_t h = 0; h < src->num_levels; h++) {
+        if (src->sizes[h] == 0) continue;
+        if (kll_reserve(dst, h, dst->sizes[h] + src->sizes[h]) != 0) return -1;
+        memcpy(dst->levels[h] + dst->sizes[h], src->levels[h],
+               src->sizes[h] * sizeof(double));
+        dst->sizes[h] += src->sizes[h];
+    }
+
+    if (dst->n == 0 || src->min < dst->min) dst->min = src->min;
+    if (dst->n == 0 || src->max > dst->max) dst->max = src->max;
+    dst->n += src->n;
+
+    return kll_settle(dst);
+}
+
+typedef struct {
+    double value;
+    uint64_t weight;
+} KLLItem;
+
+static int compare_item(const void *a, const void *b) {
+    return compare_double(&((const KLLItem *)a)->value, &((const KLLItem *)b)->value);
+}
+
+double kll_quantile(const KLLSketch *s, double q) {
+    if (s->n == 0) return 0.0;
+    if (q <= 0.0) return s->min;
+    if (q >= 1.0) return s->max;
+
+    size_t total = 0;
+    for (uint32_t h = 0; h < s->num_levels; h++) total += s->sizes[h];
+
+    KLLItem *items = malloc(total * sizeof(KLLItem));
+    if (!items) return 0.0;
+
+    size_t idx = 0;
+    uint64_t weight_sum = 0;
+    for (uint32_t h = 0; h < s->num_levels; h++) {
+        for (uint32_t i = 0; i < s->sizes[h]; i++) {
+            items[idx].value = s->levels[h][i];
+            items[idx].weight = (uint64_t)1 << h;
+            weight_sum += items[idx].weight;
+            idx++;
+        }
+    }
+    qsort(items, total, sizeof(KLLItem), compare_item);
+
+    double target = q * (double)weight_sum;
+    uint64_t cumulative = 0;
+    double result = s->max;
+    for (size_t i = 0; i < total; i++) {
+        cumulative += items[i].weight;
+        if ((double)cumulative >= target) {
+            result = items[i].value;
+            break;
+        }
+    }
+
+    free(items);
+    return result;
+}
@@ -0,0 +1,85 @@
+#ifndef QUANTILE_H
+#define QUANTILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* --------------------------------- */
+/* Welford Running Variance          */
+/* --------------------------------- */
+
+/* One-pass, numerically stable mean/variance accumulator */
+typedef struct {
+    size_t n;
+    double mean;
+    double m2;
+} WelfordState;
+
+void welford_init(WelfordState *w);
+void welford_add(WelfordState *w, double x);
+
+/* Combine two partial accumulators (Chan et al.) into 'dst' */
+void welford_merge(WelfordState *dst, const WelfordState *src);
+
+/* Sample variance / standard deviation; 0 for fewer than two values */
+double welford_variance(const WelfordState *w);
+double welford_stddev(const WelfordState *w);
+
+/* --------------------------------- */
+/* Exact Selection (introselect)     */
+/* --------------------------------- */
+
+/*
+ * Reorder 'v' so that v[k] holds the k-th smallest value, everything
+ * before it is <= v[k] and everything after it is >= v[k].
+ * Quickselect with median-of-three pivots; if partitioning degrades it
+ * switches to median-of-medians pivots, so the worst case stays linear.
+ */
+int64_t select_nth_i64(int64_t *v, size_t n, size_t k);
+double select_nth_f64(double *v, size_t n, size_t k);
+
+/*
+ * Exact p-th percentile (0..100) with linear interpolation between the
+ * two closest ranks. 'v' is used as scratch space and gets reordered.
+ */
+double percentile_i64(int64_t *v, size_t n, double p);
+double percentile_f64(double *v, size_t n, double p);
+
+/* --------------------------------- */
+/* KLL Quantile Sketch               */
+/* --------------------------------- */
+
+#define KLL_DEFAULT_K 200
+#define KLL_MAX_LEVELS 48
+
+/*
+ * Mergeable streaming quantile sketch (Karnin, Lang, Liberty 2016).
+ * Level h holds items of weight 2^h; a full level is sorted and every
+ * other item is promoted. Memory stays O(k log(n/k)) regardless of how
+ * many values are added, with rank error around 1.7/k.
+ */
+typedef struct {
+    uint32_t k;
+    uint32_t num_levels;
+    uint64_t n;
+    double min;
+    double max;
+    uint64_t rng;
+    double *levels[KLL_MAX_LEVELS];
+    uint32_t sizes[KLL_MAX_LEVELS];
+    uint32_t capacities[KLL_MAX_LEVELS];  /* compaction thresholds */
+    uint32_t allocated[KLL_MAX_LEVELS];   /* buffer sizes */
+} KLLSketch;
+
+/* 'k' trades memory for accuracy; 0 selects KLL_DEFAULT_K */
+int kll_init(KLLSketch *s, uint32_t k);
+void kll_free(KLLSketch *s);
+int kll_add(KLLSketch *s, double x);
+
+/* Fold 'src' into 'dst'; both must have been built with the same k */
+int kll_merge(KLLSketch *dst, const KLLSketch *src);
+
+/* Approximate q-quantile, q in [0, 1] */
+double kll_quantile(const KLLSketch *s, double q);
+
+#endif
@@ -0,0 +1,228 @@
+/* sort.c - LSD radix sort and heap top-k over 64-bit keys */
+
+#include "sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SORT_RADIX_BITS 8
+#define SORT_RADIX      (1u << SORT_RADIX_BITS)
+#define SORT_PASSES     (64 / SORT_RADIX_BITS)
+#define SORT_SMALL      64
+
+/*
+ * Keys are mapped to unsigned integers whose natural order is the
+ * requested order, so every later step compares plain uint64_t.
+ */
+static inline uint64_t key_from_i64(int64_t v, int descending) {
+    uint64_t u = (uint64_t)v ^ 0x8000000000000000ull;
+    return descending ? ~u : u;
+}
+
+/* ========== Full Sort ========== */
+
+static void insertion_sort(uint64_t *keys, uint32_t *rows, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        uint64_t k = keys[i];
+        uint32_t r = rows[i];
+        size_t j = i;
+        while (j > 0 && keys[j - 1] > k) {
+            keys[j] = keys[j - 1];
+            rows[j] = rows[j - 1];
+            j--;
+        }
+        keys[j] = k;
+        rows[j] = r;
+    }
+}
+
+/*
+ * Stable LSD radix sort, one byte per pass. All eight histograms are
+ * built in a single read, and passes whose byte is the same for every
+ * key (common for small or clustered values) are skipped.
+ */
+static int radix_sort(uint64_t *keys, uint32_t *rows, size_t n) {
+    if (n < SORT_SMALL) {
+        insertion_sort(keys, rows, n);
+        return 0;
+    }
+
+    size_t (*hist)[SORT_RADIX] = calloc(SORT_PASSES, sizeof(*hist));
+    uint64_t *key_tmp = malloc(n * sizeof(uint64_t));
+    uint32_t *row_tmp = malloc(n * sizeof(uint32_t));
+    if (!hist || !key_tmp || !row_tmp) {
+        free(hist);
+        free(key_tmp);
+        free(row_tmp);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        for (int p = 0; p < SORT_PASSES; p++) {
+            hist[p][(k >> (p * SORT_RADIX_BITS)) & (SORT_RADIX - 1)]++;
+        }
+    }
+
+    uint64_t *src_keys = keys, *dst_keys = key_tmp;
+    uint32_t *src_rows = rows, *dst_rows = row_tmp;
+
+    for (int p = 0; p < SORT_PASSES; p++) {
+        unsigned shift = (unsigned)(p * SORT_RADIX_BITS);
+        if (hist[p][(src_keys[0] >> shift) & (SORT_RADIX - 1)] == n) continue;
+
+        size_t offset = 0;
+        for (unsigned b = 0; b < SORT_RADIX; b++) {
+            size_t c = hist[p][b];
+            hist[p][b] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            uint64_t k = src_keys[i];
+            size_t pos = hist[p][(k >> shift) & (SORT_RADIX - 1)]++;
+            dst_keys[pos] = k;
+            dst_rows[pos] = src_rows[i];
+        }
+
+        uint64_t *tk = src_keys; src_keys = dst_keys; dst_keys = tk;
+        uint32_t *tr = src_rows; src_rows = dst_rows; dst_rows = tr;
+    }
+
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, n * sizeof(uint64_t));
+        memcpy(rows, src_rows, n * sizeof(uint32_t));
+    }
+
+    free(hist);
+    free(key_tmp);
+    free(row_tmp);
+    return 0;
+}
+
+/* ========== Top-k ========== */
+
+/*
+ * Max-heap ordered by (key, input position): the root is the worst row
+ * kept so far. Positions only grow while scanning, so a candidate can
+ * replace the root only with a strictly smaller key, which keeps ties
+ * in input order.
+ */
+typedef struct {
+    uint64_t key;
+    size_t pos;
+} HeapItem;
+
+static inline int heap_less(const HeapItem *a, const HeapItem *b) {
+    return a->key < b->key || (a->key == b->key && a->pos < b->pos);
+}
+
+static void heap_sift_down(HeapItem *heap, size_t n, size_t i) {
+    for (;;) {
+        size_t largest = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && heap_less(&heap[largest], &heap[l])) largest = l;
+        if (r < n && heap_less(&heap[largest], &heap[r])) largest = r;
+        if (largest == i) return;
+        HeapItem t = heap[i]; heap[i] = heap[largest]; heap[largest] = t;
+        i = largest;
+    }
+}
+
+/* Select the k smallest of keys[0..n) and write their rows in order */
+static int heap_select(const uint64_t *keys, uint32_t *rows, size_t n, size_t k) {
+    HeapItem *heap = malloc(k * sizeof(HeapItem));
+    if (!heap) return -1;
+
+    for (size_t i = 0; i < k; i++) {
+        heap[i].key = keys[i];
+        heap[i].pos = i;
+    }
+    for (size_t i = k / 2; i-- > 0;) heap_sift_down(heap, k, i);
+
+    for (size_t i = k; i < n; i++) {
+        if (keys[i] < heap[0].key) {
+            heap[0].key = keys[i];
+            heap[0].pos = i;
+            heap_sift_down(heap, k, 0);
+        }
+    }
+
+    /* Heapsort the survivors in place: ascending (key, pos) */
+    for (size_t end = k; end > 1; end--) {
+        HeapItem t = heap[0]; heap[0] = heap[end - 1]; heap[end - 1] = t;
+        heap_sift_down(heap, end - 1, 0);
+    }
+
+    /* Positions refer to the original rows; gather before overwriting */
+    uint32_t *picked = malloc(k * sizeof(uint32_t));
+    if (!picked) {
+        free(heap);
+        return -1;
+    }
+    for (size_t i = 0; i < k; i++) picked[i] = rows[heap[i].pos];
+    memcpy(rows, picked, k * sizeof(uint32_t));
+
+    free(picked);
+    free(heap);
+    return 0;
+}
+
+/* ========== Entry Points ========== */
+
+/*
+ * Order 'rows' by their keys: keys[i] belongs to rows[i]. With
+ * limit == 0 (or limit >= n) all n rows are sorted with a stable LSD
+ * radix sort. Otherwise only the best 'limit' rows are selected with a
+ * bounded heap and written, in order, to rows[0 .. limit-1]. Ties keep
+ * their input order. Returns 0 on success, -1 when out of memory.
+ */
+static int sort_rows_keys(uint64_t *keys, uint32_t *rows, size_t n, size_t limit) {
+    if (limit == 0 || limit >= n) return radix_sort(keys, rows, n);
+    return heap_select(keys, rows, n, limit);
+}
+
+DataSet *sort_dataset(DataSet *src, int descending, size_t limit, const char *title) {
+    if (!src) return NULL;
+
+    DataSet *physical = dataset_physical(src);
+    if (physical->count > UINT32_MAX) {
+        fprintf(stderr, "Sort error: '%s' has too many rows to sort.\n", src->title);
+        return NULL;
+    }
+
+    size_t n = src->count;
+    uint32_t *sel = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint64_t *keys = malloc((n ? n : 1) * sizeof(uint64_t));
+    if (!sel || !keys) {
+        free(sel);
+        free(keys);
+        fprintf(stderr, "Sort error: out of memory sorting '%s'.\n", src->title);
+        return NULL;
+    }
+
+    int64_t buf[DATASET_BLOCK_ROWS];
+    for (size_t start = 0; start < n; start += DATASET_BLOCK_ROWS) {
+        size_t m = n - start < DATASET_BLOCK_ROWS ? n - start : DATASET_BLOCK_ROWS;
+        const int64_t *values = dataset_values_block(src, start, m, buf);
+        for (size_t j = 0; j < m; j++) {
+            sel[start + j] = (uint32_t)dataset_row(src, start + j);
+            keys[start + j] = key_from_i64(values[j], descending);
+        }
+    }
+
+    int rc = sort_rows_keys(keys, sel, n, limit);
+    free(keys);
+    if (rc != 0) {
+        free(sel);
+        fprintf(stderr, "Sort error: out of memory sorting '%s'.\n", src->title);
+        return NULL;
+    }
+
+    size_t out = (limit && limit < n) ? limit : n;
+    if (out < n) {
+        uint32_t *shrunk = realloc(sel, (out ? out : 1) * sizeof(uint32_t));
+        if (shrunk) sel = shrunk;
+    }
+
+    return dataset_view_new(src, sel, out, title);
+}
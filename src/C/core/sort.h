@@ -0,0 +1,14 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+
+/*
+ * Return a view of 'src' ordered by value, titled 'title', keeping at
+ * most 'limit' rows (0 keeps all). No column data is copied.
+ */
+DataSet *sort_dataset(DataSet *src, int descending, size_t limit, const char *title);
+
+#endif
@@ -0,0 +1,292 @@
+#include "dp_cache.h"
+#include "core/hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "LCCACHE1"
+#define CACHE_VERSION 2
+#define CACHE_BYTE_ORDER 0x01020304u
+#define CACHE_ALIGN 64
+#define CACHE_CHECKSUMS 1u
+#define CACHE_MAX_COLUMNS 4096
+
+// 64 bytes at the start of every cache file
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;    // CACHE_BYTE_ORDER as written by this host
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t row_count;
+    uint32_t column_count;
+    uint32_t flags;
+    uint8_t reserved[8];
+} CacheHeader;
+
+// Column block waiting to be written
+typedef struct {
+    const char *name;
+    DP_CacheType type;
+    const void *data;
+    size_t length;
+} CacheBlock;
+
+// Mapped cache file that passed validation
+typedef struct {
+    void *map;
+    size_t len;
+    const CacheHeader *header;
+    const DP_CacheColumn *dir;
+} CacheFile;
+
+// ---------- Locations ----------
+
+static int cache_enabled(void) {
+    const char *env = getenv("LCORE_CACHE");
+    return !env || (strcmp(env, "0") != 0 && strcmp(env, "off") != 0);
+}
+
+// mkdir -p
+static int make_dirs(char *path) {
+    for (char *p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        char saved = *p;
+        *p = '\0';
+        int rc = mkdir(path, 0755);
+        *p = saved;
+        if (rc != 0 && errno != EEXIST) return -1;
+        if (saved == '\0') return 0;
+    }
+}
+
+int dp_cache_dir(char *out, size_t cap) {
+    if (!cache_enabled()) return -1;
+
+    const char *dir = getenv("LCORE_CACHE_DIR");
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int n;
+    if (dir && *dir) n = snprintf(out, cap, "%s", dir);
+    else if (xdg && *xdg) n = snprintf(out, cap, "%s/lcore", xdg);
+    else if (home && *home) n = snprintf(out, cap, "%s/.cache/lcore", home);
+    else return -1;
+
+    if (n <= 0 || (size_t)n >= cap) return -1;
+    return make_dirs(out);
+}
+
+// Identity of a cache entry: the source's absolute path and the variant
+static char *cache_key(const char *source, const char *variant) {
+    char abs[PATH_MAX];
+    if (!realpath(source, abs)) return NULL;
+
+    size_t len = strlen(abs) + strlen(variant) + 2;
+    char *key = malloc(len);
+    if (key) snprintf(key, len, "%s\n%s", abs, variant);
+    return key;
+}
+
+static int cache_file_path(const char *key, char *out, size_t cap) {
+    char dir[PATH_MAX];
+    if (dp_cache_dir(dir, sizeof(dir)) != 0) return -1;
+    int n = snprintf(out, cap, "%s/%016llx.lcc", dir, (unsigned long long)hash_string(key));
+    return n > 0 && (size_t)n < cap ? 0 : -1;
+}
+
+// ---------- Writing ----------
+
+static size_t align_up(size_t n) {
+    return (n + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1);
+}
+
+static int write_padding(FILE *f, size_t from, size_t to) {
+    static const char zeros[CACHE_ALIGN];
+    return to > from && fwrite(zeros, 1, to - from, f) != to - from ? -1 : 0;
+}
+
+// Write header, directory and blocks to a temporary file, then rename
+// it over 'path' so readers never see a partial entry
+static int cache_write(const char *path, const struct stat *src, size_t rows,
+                       const CacheBlock *blocks, size_t nblocks) {
+    CacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, 8);
+    h.version = CACHE_VERSION;
+    h.byte_order = CACHE_BYTE_ORDER;
+    h.source_size = (uint64_t)src->st_size;
+    h.source_mtime_sec = (int64_t)src->st_mtim.tv_sec;
+    h.source_mtime_nsec = (int64_t)src->st_mtim.tv_nsec;
+    h.row_count = rows;
+    h.column_count = (uint32_t)nblocks;
+    h.flags = CACHE_CHECKSUMS;
+
+    DP_CacheColumn *dir = calloc(nblocks ? nblocks : 1, sizeof(DP_CacheColumn));
+    if (!dir) return -1;
+    size_t offset = align_up(sizeof(h) + nblocks * sizeof(DP_CacheColumn));
+    for (size_t i = 0; i < nblocks; i++) {
+        strncpy(dir[i].name, blocks[i].name, DP_CACHE_NAME_MAX - 1);
+        dir[i].type = blocks[i].type;
+        dir[i].offset = offset;
+        dir[i].length = blocks[i].length;
+        dir[i].checksum = hash_words(blocks[i].data, blocks[i].length);
+        offset = align_up(offset + blocks[i].length);
+    }
+
+    char tmp[PATH_MAX];
+    int n = snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+    FILE *f = n > 0 && (size_t)n < sizeof(tmp) ? fopen(tmp, "wb") : NULL;
+    if (!f) {
+        free(dir);
+        return -1;
+    }
+
+    size_t pos = sizeof(h) + nblocks * sizeof(DP_CacheColumn);
+    int rc = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(dir, sizeof(DP_CacheColumn), nblocks, f) == nblocks ? 0 : -1;
+    for (size_t i = 0; rc == 0 && i < nblocks; i++) {
+        rc = write_padding(f, pos, dir[i].offset);
+        if (rc == 0 && blocks[i].length && fwrite(blocks[i].data, 1, blocks[i].length, f) != blocks[i].length) rc = -1;
+        pos = dir[i].offset + blocks[i].length;
+    }
+    if (fclose(f) != 0) rc = -1;
+    if (rc == 0 && rename(tmp, path) != 0) rc = -1;
+    if (rc != 0) unlink(tmp);
+
+    free(dir);
+    return rc;
+}
+
+// ---------- Reading ----------
+
+static int cache_verify_enabled(void) {
+    const char *env = getenv("LCORE_CACHE_VERIFY");
+    return env && strcmp(env, "1") == 0;
+}
+
+static const DP_CacheColumn *cache_find(const CacheFile *cf, const char *name) {
+    for (uint32_t i = 0; i < cf->header->column_count; i++) {
+        if (strncmp(cf->dir[i].name, name, DP_CACHE_NAME_MAX) == 0) return &cf->dir[i];
+    }
+    return NULL;
+}
+
+// Block 'name' of the given type; NULL if absent or of the wrong type
+static const void *cache_block(const CacheFile *cf, const char *name, DP_CacheType type, size_t *length) {
+    const DP_CacheColumn *col = cache_find(cf, name);
+    if (!col || col->type != (uint32_t)type) return NULL;
+    *length = (size_t)col->length;
+    return (const char *)cf->map + col->offset;
+}
+
+static void cache_close(CacheFile *cf) {
+    if (cf->map) munmap(cf->map, cf->len);
+    cf->map = NULL;
+}
+
+// Map the entry for 'key' and check that it is intact and still
+// describes the source as it is now
+static int cache_open(CacheFile *cf, const char *key, const struct stat *src) {
+    memset(cf, 0, sizeof(*cf));
+    char path[PATH_MAX];
+    if (cache_file_path(key, path, sizeof(path)) != 0) return -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    cf->map = map;
+    cf->len = (size_t)st.st_size;
+    cf->header = map;
+    cf->dir = (const DP_CacheColumn *)((const char *)map + sizeof(CacheHeader));
+
+    const CacheHeader *h = cf->header;
+    int ok = memcmp(h->magic, CACHE_MAGIC, 8) == 0 && h->version == CACHE_VERSION &&
+             h->byte_order == CACHE_BYTE_ORDER && h->column_count <= CACHE_MAX_COLUMNS &&
+             sizeof(CacheHeader) + h->column_count * sizeof(DP_CacheColumn) <= cf->len &&
+             h->source_size == (uint64_t)src->st_size &&
+             h->source_mtime_sec == (int64_t)src->st_mtim.tv_sec &&
+             h->source_mtime_nsec == (int64_t)src->st_mtim.tv_nsec;
+
+    int verify = ok && (h->flags & CACHE_CHECKSUMS) && cache_verify_enabled();
+    for (uint32_t i = 0; ok && i < h->column_count; i++) {
+        const DP_CacheColumn *col = &cf->dir[i];
+        ok = col->offset % CACHE_ALIGN == 0 && col->offset <= cf->len && col->length <= cf->len - col->offset;
+        if (ok && verify) ok = hash_words((const char *)map + col->offset, (size_t)col->length) == col->checksum;
+    }
+
+    // The file name is only a hash; the stored key settles collisions
+    size_t len;
+    const char *stored = ok ? cache_block(cf, ".source", DP_CACHE_BYTES, &len) : NULL;
+    if (!stored || len != strlen(key) || memcmp(stored, key, len) != 0) {
+        cache_close(cf);
+        return -1;
+    }
+    return 0;
+}
+
+// ---------- DP_DataSet ----------
+
+DP_DataSet *dp_cache_load_values(const char *source, const char *variant) {
+    struct stat src;
+    if (!cache_enabled() || stat(source, &src) != 0) return NULL;
+    char *key = cache_key(source, variant);
+    if (!key) return NULL;
+
+    CacheFile cf;
+    int rc = cache_open(&cf, key, &src);
+    free(key);
+    if (rc != 0) return NULL;
+
+    size_t len;
+    const double *values = cache_block(&cf, "value", DP_CACHE_F64, &len);
+    if (!values || len != cf.header->row_count * sizeof(double)) {
+        cache_close(&cf);
+        return NULL;
+    }
+
+    // Out of memory counts as a miss
+    DP_DataSet *ds = dp_dataset_new(source);
+    if (!ds) {
+        cache_close(&cf);
+        return NULL;
+    }
+    free(ds->values);
+    ds->values = (double *)values;
+    ds->count = (size_t)cf.header->row_count;
+    ds->capacity = ds->count;
+    ds->mapping = cf.map;
+    ds->mapping_len = cf.len;
+    return ds;
+}
+
+int dp_cache_store_values(const char *source, const char *variant, const DP_DataSet *ds) {
+    struct stat src;
+    if (!ds || !cache_enabled() || stat(source, &src) != 0) return -1;
+    char *key = cache_key(source, variant);
+    char path[PATH_MAX];
+    int rc = key ? cache_file_path(key, path, sizeof(path)) : -1;
+
+    if (rc == 0) {
+        CacheBlock blocks[] = {
+            { ".source", DP_CACHE_BYTES, key, strlen(key) },
+            { "value", DP_CACHE_F64, ds->values, ds->count * sizeof(double) },
+        };
+        rc = cache_write(path, &src, ds->count, blocks, 2);
+    }
+    free(key);
+    return rc;
+}
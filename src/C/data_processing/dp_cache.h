@@ -0,0 +1,47 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dp_dataset.h"
+
+// Binary columnar cache for loaded datasets.
+//
+// A cache file is a 64-byte header (magic, version, byte order, the
+// source's size and mtime, row and column counts) followed by a column
+// directory and 64-byte aligned column blocks, each with a 64-bit
+// checksum. Reloading maps the file and points the dataset's columns
+// straight into the mapping; nothing is parsed or copied.
+//
+// Files live in $LCORE_CACHE_DIR, else $XDG_CACHE_HOME/lcore, else
+// ~/.cache/lcore, named after the source's absolute path and a
+// 'variant' string that describes how the dataset was derived from it
+// (loader and options). An entry is used only while the source's size
+// and mtime still match. LCORE_CACHE=0 turns the cache off and
+// LCORE_CACHE_VERIFY=1 checks block checksums on every load.
+
+typedef enum {
+    DP_CACHE_F64 = 1,
+    DP_CACHE_I64 = 2,
+    DP_CACHE_U64 = 3,
+    DP_CACHE_BYTES = 4
+} DP_CacheType;
+
+#define DP_CACHE_NAME_MAX 64
+
+// Directory entry of one column block
+typedef struct {
+    char name[DP_CACHE_NAME_MAX];
+    uint32_t type;          // DP_CacheType
+    uint32_t flags;
+    uint64_t offset;        // From the start of the file, 64-byte aligned
+    uint64_t length;        // Bytes
+    uint64_t checksum;
+} DP_CacheColumn;
+
+// Directory of the cache files: 0 and the path in 'out', or -1 when the
+// cache is disabled or the directory cannot be created
+int dp_cache_dir(char *out, size_t cap);
+
+// NULL on a miss (absent, stale or damaged entry)
+DP_DataSet *dp_cache_load_values(const char *source, const char *variant);
+int dp_cache_store_values(const char *source, const char *variant, const DP_DataSet *ds);
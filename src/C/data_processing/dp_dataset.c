@@ -1,28 +1,61 @@
 #include "dp_dataset.h"
+#include "core/agg_simd.h"
+#include "dp_table.h"
+#include "dp_json.h"
+#include "dp_sqlite.h"
+#include "dp_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sqlite3.h>
 #include <ctype.h>
-#include <json-c/json.h>
+#include <sys/mman.h>
 
 #define INITIAL_CAPACITY 16
 
 DP_DataSet *dp_dataset_new(const char *name) {
     DP_DataSet *ds = malloc(sizeof(DP_DataSet));
+    if (!ds) return NULL;
     ds->name = strdup(name);
     ds->count = 0;
     ds->capacity = INITIAL_CAPACITY;
     ds->values = malloc(sizeof(double) * ds->capacity);
+    ds->sketch = NULL;
+    ds->mapping = NULL;
+    ds->mapping_len = 0;
+    if (!ds->name || !ds->values) {
+        free(ds->name);
+        free(ds->values);
+        free(ds);
+        return NULL;
+    }
     return ds;
 }
 
-void dp_dataset_add(DP_DataSet *ds, double value) {
+// Move values that live in a cache file mapping onto the heap
+static int dataset_unmap(DP_DataSet *ds) {
+    size_t cap = ds->count > INITIAL_CAPACITY ? ds->count : INITIAL_CAPACITY;
+    double *values = malloc(sizeof(double) * cap);
+    if (!values) return -1;
+    memcpy(values, ds->values, sizeof(double) * ds->count);
+    munmap(ds->mapping, ds->mapping_len);
+    ds->mapping = NULL;
+    ds->mapping_len = 0;
+    ds->values = values;
+    ds->capacity = cap;
+    return 0;
+}
+
+int dp_dataset_add(DP_DataSet *ds, double value) {
+    if (ds->mapping && dataset_unmap(ds) != 0) return -1;
     if (ds->count >= ds->capacity) {
+        double *values = realloc(ds->values, sizeof(double) * ds->capacity * 2);
+        if (!values) return -1;
+        ds->values = values;
         ds->capacity *= 2;
-        ds->values = realloc(ds->values, sizeof(double) * ds->capacity);
     }
     ds->values[ds->count++] = value;
+    if (ds->sketch) kll_add(ds->sketch, value);
+    return 0;
 }
 
 size_t dp_dataset_count(DP_DataSet *ds) {
@@ -30,84 +63,178 @@ size_t dp_dataset_count(DP_DataSet *ds) {
 }
 
 void dp_dataset_free(DP_DataSet *ds) {
-    free(ds->values);
+    if (ds->sketch) {
+        kll_free(ds->sketch);
+        free(ds->sketch);
+    }
+    if (ds->mapping) munmap(ds->mapping, ds->mapping_len);
+    else free(ds->values);
     free(ds->name);
     free(ds);
 }
 
-DP_DataSet *dp_dataset_load_csv(const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return NULL;
+int dp_dataset_stats(const DP_DataSet *ds, DP_Stats *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!ds || ds->count == 0) return 0;
 
-    DP_DataSet *ds = dp_dataset_new(filename);
-    char line[256];
+    agg_stats_f64(ds->values, ds->count, &out->sum, &out->min, &out->max);
+    out->count = ds->count;
+    out->mean = out->sum / (double)ds->count;
+    return 0;
+}
 
-    // Skip header
-    fgets(line, sizeof(line), f);
+double dp_dataset_stddev(const DP_DataSet *ds) {
+    if (!ds || ds->count < 2) return 0.0;
 
-    while (fgets(line, sizeof(line), f)) {
-        double value = atof(line);
-        dp_dataset_add(ds, value);
+    WelfordState w;
+    welford_init(&w);
+    for (size_t i = 0; i < ds->count; i++) {
+        welford_add(&w, ds->values[i]);
     }
+    return welford_stddev(&w);
+}
 
-    fclose(f);
-    return ds;
+double dp_dataset_percentile(const DP_DataSet *ds, double p) {
+    if (!ds || ds->count == 0) return 0.0;
+
+    double *scratch = malloc(sizeof(double) * ds->count);
+    if (!scratch) return 0.0;
+    memcpy(scratch, ds->values, sizeof(double) * ds->count);
+
+    double result = percentile_f64(scratch, ds->count, p);
+    free(scratch);
+    return result;
 }
 
-DP_DataSet *dp_dataset_load_json(const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return NULL;
+double dp_dataset_median(const DP_DataSet *ds) {
+    return dp_dataset_percentile(ds, 50.0);
+}
 
-    fseek(f, 0, SEEK_END);
-    long len = ftell(f);
-    fseek(f, 0, SEEK_SET);
+int dp_dataset_track_quantiles(DP_DataSet *ds, uint32_t k) {
+    if (!ds) return -1;
+    if (ds->sketch) return 0;
 
-    char *data = malloc(len + 1);
-    fread(data, 1, len, f);
-    data[len] = '\0';
-    fclose(f);
+    ds->sketch = malloc(sizeof(KLLSketch));
+    if (!ds->sketch) return -1;
+    return kll_init(ds->sketch, k);
+}
 
-    struct json_object *root = json_tokener_parse(data);
-    free(data);
+double dp_dataset_approx_percentile(const DP_DataSet *ds, double p) {
+    if (!ds || !ds->sketch) return dp_dataset_percentile(ds, p);
+    return kll_quantile(ds->sketch, p / 100.0);
+}
 
-    struct json_object *values;
-    if (!json_object_object_get_ex(root, "values", &values)) {
-        json_object_put(root);
-        return NULL;
+DP_DataSet *dp_dataset_load_csv(const char *filename) {
+    return dp_dataset_load_csv_opts(filename, NULL);
+}
+
+// Cache variant describing a loader and its options; -1 when it does
+// not fit, in which case the load is not cached
+static int cache_variant(char *out, size_t cap, const char *loader, const DP_LoadOptions *opts) {
+    size_t used = 0;
+    int n = snprintf(out, cap, "%s", loader);
+    for (size_t i = 0; opts && n >= 0 && i < opts->column_count; i++) {
+        used += (size_t)n;
+        n = used < cap ? snprintf(out + used, cap - used, "|c=%s", opts->columns[i]) : -1;
+    }
+    for (size_t i = 0; opts && n >= 0 && i < opts->predicate_count; i++) {
+        const DP_RangePredicate *p = &opts->predicates[i];
+        used += (size_t)n;
+        n = used < cap ? snprintf(out + used, cap - used, "|p=%s:%.17g:%.17g", p->column, p->min, p->max) : -1;
     }
+    return n >= 0 && used + (size_t)n < cap ? 0 : -1;
+}
 
-    DP_DataSet *ds = dp_dataset_new(filename);
-    for (size_t i = 0; i < json_object_array_length(values); i++) {
-        double val = json_object_get_double(json_object_array_get_idx(values, i));
-        dp_dataset_add(ds, val);
+// A cell of the value column; text that is not a number reads as 0
+static double column_value(const DP_Column *col, size_t row) {
+    if (col->type != DATA_TYPE_STRING) return dp_column_number(col, row);
+
+    const char *text = dp_column_string(col, row);
+    double value;
+    return dp_parse_float(text, strlen(text), &value) == 0 ? value : 0.0;
+}
+
+// The table's value column as a DataSet, converted in one pass. INT and
+// FLOAT storage is 8 bytes a row like the DataSet's, so it is taken over
+// (INT converted in place) instead of copied.
+static DP_DataSet *dataset_from_column(const char *name, DP_Table *t) {
+    DP_DataSet *ds = dp_dataset_new(name);
+    if (!ds) return NULL;
+
+    DP_Column *col = t->column_count ? &t->columns[0] : NULL;
+    size_t rows = col ? t->row_count : 0;
+    if (rows && (col->type == DATA_TYPE_INT || col->type == DATA_TYPE_FLOAT)) {
+        double *values = col->data.floats;
+        if (col->type == DATA_TYPE_INT) {
+            for (size_t i = 0; i < rows; i++) values[i] = (double)col->data.ints[i];
+        }
+        col->data.floats = NULL;
+        free(ds->values);
+        ds->values = values;
+        ds->count = rows;
+        ds->capacity = t->capacity;
+        return ds;
     }
 
-    json_object_put(root);
+    if (rows > ds->capacity) {
+        double *values = realloc(ds->values, sizeof(double) * rows);
+        if (!values) {
+            dp_dataset_free(ds);
+            return NULL;
+        }
+        ds->values = values;
+        ds->capacity = rows;
+    }
+    for (size_t i = 0; i < rows; i++) ds->values[i] = column_value(col, i);
+    ds->count = rows;
     return ds;
 }
 
-DP_DataSet *dp_dataset_load_sqlite(const char *db_path, const char *table_name) {
-    sqlite3 *db;
-    if (sqlite3_open(db_path, &db)) return NULL;
+DP_DataSet *dp_dataset_load_csv_opts(const char *filename, const DP_LoadOptions *opts) {
+    char variant[512];
+    int cacheable = cache_variant(variant, sizeof(variant), "csv", opts) == 0;
+    if (cacheable) {
+        DP_DataSet *cached = dp_cache_load_values(filename, variant);
+        if (cached) return cached;
+    }
 
-    char query[256];
-    snprintf(query, sizeof(query), "SELECT value FROM %s;", table_name);
+    // Only the value column is materialized
+    DP_Table *t = dp_table_load_csv_value(filename, opts);
+    if (!t) return NULL;
 
-    DP_DataSet *ds = dp_dataset_new(table_name);
+    DP_DataSet *ds = dataset_from_column(filename, t);
+    dp_table_free(t);
+    if (ds && cacheable) dp_cache_store_values(filename, variant, ds);
+    return ds;
+}
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
-        sqlite3_close(db);
-        dp_dataset_free(ds);
-        return NULL;
-    }
+DP_DataSet *dp_dataset_load_json(const char *filename) {
+    return dp_dataset_load_json_opts(filename, NULL);
+}
+
+static int dataset_add_value(void *ctx, double value) {
+    return dp_dataset_add(ctx, value);
+}
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        double val = sqlite3_column_double(stmt, 0);
-        dp_dataset_add(ds, val);
+DP_DataSet *dp_dataset_load_json_opts(const char *filename, const DP_LoadOptions *opts) {
+    char variant[512];
+    int cacheable = cache_variant(variant, sizeof(variant), "json", opts) == 0;
+    if (cacheable) {
+        DP_DataSet *cached = dp_cache_load_values(filename, variant);
+        if (cached) return cached;
     }
 
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+    DP_DataSet *ds = dp_dataset_new(filename);
+    if (!ds) return NULL;
+    if (dp_json_stream_values(filename, opts, dataset_add_value, ds) != 0) {
+        dp_dataset_free(ds);
+        return NULL;
+    }
+    if (cacheable) dp_cache_store_values(filename, variant, ds);
     return ds;
 }
+
+DP_DataSet *dp_dataset_load_sqlite(const char *db_path, const char *table_name) {
+    return dp_sqlite_query(db_path, table_name, NULL, NULL);
+}
@@ -1,20 +1,53 @@
 #pragma once
 #include <stddef.h>
 
+#include "core/quantile.h"
+#include "dp_table.h"
+
 typedef struct {
     char *name;
     double *values;
     size_t count;
     size_t capacity;
+    KLLSketch *sketch;  // Optional; fed by dp_dataset_add once tracking is on
+    void *mapping;      // Cache file mapping 'values' points into, or NULL
+    size_t mapping_len; // (copied to the heap on the first dp_dataset_add)
 } DP_DataSet;
 
+// Result of a fused single-pass aggregation over the value column
+typedef struct {
+    double sum;
+    double min;
+    double max;
+    size_t count;
+    double mean;
+} DP_Stats;
+
 // Core functions
 DP_DataSet *dp_dataset_new(const char *name);
-void dp_dataset_add(DP_DataSet *ds, double value);
+int dp_dataset_add(DP_DataSet *ds, double value);
 size_t dp_dataset_count(DP_DataSet *ds);
 void dp_dataset_free(DP_DataSet *ds);
 
+// Aggregation
+int dp_dataset_stats(const DP_DataSet *ds, DP_Stats *out);
+double dp_dataset_stddev(const DP_DataSet *ds);
+double dp_dataset_median(const DP_DataSet *ds);
+double dp_dataset_percentile(const DP_DataSet *ds, double p);
+
+// Streaming quantiles: maintain a KLL sketch (k = 0 for the default)
+// over every value added from now on, for input that is not kept
+int dp_dataset_track_quantiles(DP_DataSet *ds, uint32_t k);
+double dp_dataset_approx_percentile(const DP_DataSet *ds, double p);
+
 // Data source loaders
 DP_DataSet *dp_dataset_load_csv(const char *filename);
 DP_DataSet *dp_dataset_load_json(const char *filename);
 DP_DataSet *dp_dataset_load_sqlite(const char *db_path, const char *table_name);
+
+// Loaders with projection / predicate pushdown. The value column is
+// opts->columns[0] when given (later entries are ignored); otherwise the
+// CSV field picked by dp_csv_value_field or the JSON "values" array. JSON is streamed;
+// see dp_json.h for key paths, predicates and NDJSON.
+DP_DataSet *dp_dataset_load_csv_opts(const char *filename, const DP_LoadOptions *opts);
+DP_DataSet *dp_dataset_load_json_opts(const char *filename, const DP_LoadOptions *opts);
@@ -0,0 +1,301 @@
+#include "dp_decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef DP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Compressed bytes read from the file at a time
+#define DECODE_INPUT_SIZE (256 * 1024)
+
+// The ring: the decoding thread fills slot (produced % SLOTS) while the
+// loader reads slot (consumed % SLOTS); produced - consumed never
+// exceeds DP_DECODE_SLOTS, and the slot the loader holds is not reused
+// until it asks for the next one.
+struct DP_Decoder {
+    char *path;
+    int fd;
+    DP_Compression kind;
+    unsigned char *input;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;      // A block was published or decoding ended
+    pthread_cond_t drained;     // The loader released a block or asked to stop
+    char *slots[DP_DECODE_SLOTS];
+    size_t lens[DP_DECODE_SLOTS];
+    size_t produced;
+    size_t consumed;
+    int holding;                // The loader holds slot consumed % SLOTS
+    int finished;
+    int failed;
+    int stop;
+};
+
+// ---------- Detection ----------
+
+DP_Compression dp_compression_of(const char *path) {
+    if (!path || strcmp(path, "-") == 0) return DP_COMPRESSION_NONE;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return DP_COMPRESSION_NONE;
+
+    unsigned char magic[4];
+    ssize_t got = read(fd, magic, sizeof(magic));
+    close(fd);
+    if (got >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return DP_COMPRESSION_GZIP;
+    if (got == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return DP_COMPRESSION_ZSTD;
+    }
+    return DP_COMPRESSION_NONE;
+}
+
+static int ends_with(const char *s, size_t len, const char *suffix) {
+    size_t n = strlen(suffix);
+    return len >= n && memcmp(s + len - n, suffix, n) == 0;
+}
+
+int dp_path_has_extension(const char *path, const char *ext) {
+    if (!path || !ext) return 0;
+    size_t len = strlen(path);
+    if (ends_with(path, len, ".gz")) len -= 3;
+    else if (ends_with(path, len, ".zst")) len -= 4;
+    return ends_with(path, len, ext);
+}
+
+// ---------- Producer side ----------
+
+// Hand the current block (if any bytes) to the loader and wait for a
+// free slot; NULL once the loader has asked to stop
+static char *decoder_publish(DP_Decoder *d, size_t len) {
+    pthread_mutex_lock(&d->lock);
+    if (len > 0) {
+        d->lens[d->produced % DP_DECODE_SLOTS] = len;
+        d->produced++;
+        pthread_cond_signal(&d->filled);
+    }
+    while (!d->stop && d->produced - d->consumed >= DP_DECODE_SLOTS) {
+        pthread_cond_wait(&d->drained, &d->lock);
+    }
+    char *slot = d->stop ? NULL : d->slots[d->produced % DP_DECODE_SLOTS];
+    pthread_mutex_unlock(&d->lock);
+    return slot;
+}
+
+// Next run of compressed bytes; 0 at the end of the file
+static ssize_t decoder_read(DP_Decoder *d) {
+    for (;;) {
+        ssize_t got = read(d->fd, d->input, DECODE_INPUT_SIZE);
+        if (got >= 0 || errno != EINTR) return got;
+    }
+}
+
+// Concatenated gzip members (as written by pigz or 'cat a.gz b.gz') are
+// decoded one after the other
+static int decode_gzip(DP_Decoder *d) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) return -1;
+
+    char *out = decoder_publish(d, 0);
+    size_t used = 0;
+    int eof = 0, ended = 0, rc = 0;
+    while (out) {
+        if (zs.avail_in == 0 && !eof) {
+            ssize_t got = decoder_read(d);
+            if (got < 0) {
+                rc = -1;
+                break;
+            }
+            eof = got == 0;
+            zs.next_in = d->input;
+            zs.avail_in = (uInt)got;
+        }
+
+        zs.next_out = (Bytef *)out + used;
+        zs.avail_out = (uInt)(DP_DECODE_BLOCK_SIZE - used);
+        int z = inflate(&zs, Z_NO_FLUSH);
+        used = DP_DECODE_BLOCK_SIZE - zs.avail_out;
+
+        if (z == Z_STREAM_END) {
+            ended = 1;
+            if (eof && zs.avail_in == 0) break;
+            inflateReset(&zs);
+        } else if (z == Z_OK) {
+            ended = 0;
+        } else if (z == Z_BUF_ERROR && eof && zs.avail_in == 0) {
+            break;      // Input used up; complete only if a member just ended
+        } else if (z != Z_BUF_ERROR) {
+            rc = -1;
+            break;
+        }
+
+        if (used == DP_DECODE_BLOCK_SIZE) {
+            out = decoder_publish(d, used);
+            used = 0;
+        }
+    }
+    inflateEnd(&zs);
+
+    if (rc == 0 && out && used > 0) decoder_publish(d, used);
+    return rc == 0 && (ended || !out) ? 0 : -1;
+}
+
+#ifdef DP_HAVE_ZSTD
+static int decode_zstd(DP_Decoder *d) {
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (!dctx) return -1;
+
+    char *out = decoder_publish(d, 0);
+    ZSTD_inBuffer in = { d->input, 0, 0 };
+    size_t used = 0, pending = 1;
+    int eof = 0, rc = 0;
+    while (out) {
+        if (in.pos == in.size && !eof) {
+            ssize_t got = decoder_read(d);
+            if (got < 0) {
+                rc = -1;
+                break;
+            }
+            eof = got == 0;
+            in.size = (size_t)got;
+            in.pos = 0;
+        }
+
+        // 0 once a frame is complete and flushed; a call that makes no
+        // progress only hints at the next frame's header
+        size_t read_before = in.pos;
+        ZSTD_outBuffer ob = { out, DP_DECODE_BLOCK_SIZE, used };
+        size_t hint = ZSTD_decompressStream(dctx, &ob, &in);
+        if (ZSTD_isError(hint)) {
+            rc = -1;
+            break;
+        }
+        if (in.pos != read_before || ob.pos != used) pending = hint;
+        used = ob.pos;
+
+        if (used == DP_DECODE_BLOCK_SIZE) {
+            out = decoder_publish(d, used);
+            used = 0;
+        } else if (eof && in.pos == in.size) {
+            break;      // Everything read and flushed
+        }
+    }
+    ZSTD_freeDCtx(dctx);
+
+    if (rc == 0 && out && used > 0) decoder_publish(d, used);
+    return rc == 0 && (pending == 0 || !out) ? 0 : -1;
+}
+#endif
+
+static void *decoder_main(void *arg) {
+    DP_Decoder *d = arg;
+    int rc = -1;
+    if (d->kind == DP_COMPRESSION_GZIP) rc = decode_gzip(d);
+#ifdef DP_HAVE_ZSTD
+    if (d->kind == DP_COMPRESSION_ZSTD) rc = decode_zstd(d);
+#endif
+
+    pthread_mutex_lock(&d->lock);
+    if (rc != 0 && !d->stop) {
+        fprintf(stderr, "Decompress error: '%s' is corrupt or truncated.\n", d->path);
+        d->failed = 1;
+    }
+    d->finished = 1;
+    pthread_cond_signal(&d->filled);
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+// ---------- Consumer side ----------
+
+static void decoder_free(DP_Decoder *d) {
+    for (size_t i = 0; i < DP_DECODE_SLOTS; i++) free(d->slots[i]);
+    if (d->fd >= 0) close(d->fd);
+    free(d->input);
+    free(d->path);
+    free(d);
+}
+
+DP_Decoder *dp_decoder_open(const char *path) {
+    DP_Compression kind = dp_compression_of(path);
+    if (kind == DP_COMPRESSION_NONE) return NULL;
+#ifndef DP_HAVE_ZSTD
+    if (kind == DP_COMPRESSION_ZSTD) {
+        fprintf(stderr, "Decompress error: '%s' is zstd, and this build has no zstd support.\n", path);
+        return NULL;
+    }
+#endif
+
+    DP_Decoder *d = calloc(1, sizeof(DP_Decoder));
+    if (!d) return NULL;
+    d->kind = kind;
+    d->fd = open(path, O_RDONLY);
+    d->path = strdup(path);
+    d->input = malloc(DECODE_INPUT_SIZE);
+    int ok = d->fd >= 0 && d->path && d->input;
+    for (size_t i = 0; ok && i < DP_DECODE_SLOTS; i++) {
+        d->slots[i] = malloc(DP_DECODE_BLOCK_SIZE);
+        ok = d->slots[i] != NULL;
+    }
+    if (!ok) {
+        decoder_free(d);
+        return NULL;
+    }
+
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->filled, NULL);
+    pthread_cond_init(&d->drained, NULL);
+    if (pthread_create(&d->thread, NULL, decoder_main, d) != 0) {
+        pthread_mutex_destroy(&d->lock);
+        pthread_cond_destroy(&d->filled);
+        pthread_cond_destroy(&d->drained);
+        decoder_free(d);
+        return NULL;
+    }
+    return d;
+}
+
+ssize_t dp_decoder_next(DP_Decoder *d, const char **data) {
+    if (!d || !data) return -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->holding) {
+        d->consumed++;
+        d->holding = 0;
+        pthread_cond_signal(&d->drained);
+    }
+    while (d->consumed == d->produced && !d->finished) {
+        pthread_cond_wait(&d->filled, &d->lock);
+    }
+
+    ssize_t len;
+    if (d->consumed < d->produced) {
+        size_t slot = d->consumed % DP_DECODE_SLOTS;
+        *data = d->slots[slot];
+        len = (ssize_t)d->lens[slot];
+        d->holding = 1;
+    } else {
+        len = d->failed ? -1 : 0;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return len;
+}
+
+void dp_decoder_close(DP_Decoder *d) {
+    if (!d) return;
+    pthread_mutex_lock(&d->lock);
+    d->stop = 1;
+    pthread_cond_signal(&d->drained);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->thread, NULL);
+
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->filled);
+    pthread_cond_destroy(&d->drained);
+    decoder_free(d);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <sys/types.h>
+
+// Transparent decompression for the file loaders. A compressed file is
+// decoded on a thread of its own into a bounded ring of blocks that the
+// loader consumes as they fill, so parsing overlaps decompression and
+// nothing is written to disk. gzip (zlib) is always available; zstd
+// needs a build with DP_HAVE_ZSTD (make ZSTD=1).
+
+typedef enum {
+    DP_COMPRESSION_NONE,
+    DP_COMPRESSION_GZIP,
+    DP_COMPRESSION_ZSTD
+} DP_Compression;
+
+// Decoded bytes per block, and blocks in the ring: at most
+// DP_DECODE_SLOTS blocks are ever decoded ahead of the loader
+#define DP_DECODE_BLOCK_SIZE (1 << 20)
+#define DP_DECODE_SLOTS 4
+
+// From the file's magic bytes; NONE for plain or unreadable files and
+// for stdin ("-")
+DP_Compression dp_compression_of(const char *path);
+
+// True when 'path' ends in 'ext' (such as ".ndjson"), either on its own
+// or followed by a ".gz" / ".zst" suffix
+int dp_path_has_extension(const char *path, const char *ext);
+
+typedef struct DP_Decoder DP_Decoder;
+
+// Start decoding 'path' in the background; NULL if it cannot be opened,
+// is not compressed, or needs a codec this build lacks
+DP_Decoder *dp_decoder_open(const char *path);
+
+// Next block of decoded bytes: points *data at it and returns its
+// length, valid until the next call. Returns 0 at the end of the data,
+// or -1 if the file is corrupt, truncated or unreadable.
+ssize_t dp_decoder_next(DP_Decoder *d, const char **data);
+
+// Stop the decoding thread (mid-file is fine) and free everything
+void dp_decoder_close(DP_Decoder *d);
@@ -0,0 +1,508 @@
+#include "dp_json.h"
+#include "dp_decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_BUFFER_SIZE (64 * 1024)
+#define JSON_KEY_MAX 256
+#define JSON_NUMBER_MAX 128
+
+// Forward-only cursor over a JSON file through a fixed read buffer, over
+// the blocks of a compressed file, or over text already in memory
+typedef struct {
+    FILE *f;                // NULL for in-memory text and compressed files
+    DP_Decoder *z;          // Compressed files
+    int failed;             // The decoder hit corrupt data
+    const char *data;       // buf, a decoded block, or the in-memory text
+    size_t len;
+    size_t pos;
+    int first;              // Next array element is the first one
+    int done;               // Array exhausted (or never found)
+    char buf[JSON_BUFFER_SIZE];
+} JsonStream;
+
+// "-" reads stdin; gzip / zstd files are decoded on the fly
+static JsonStream *json_open(const char *filename) {
+    DP_Decoder *z = NULL;
+    FILE *f = NULL;
+    if (strcmp(filename, "-") == 0) f = stdin;
+    else if (dp_compression_of(filename) != DP_COMPRESSION_NONE) z = dp_decoder_open(filename);
+    else f = fopen(filename, "rb");
+    if (!f && !z) return NULL;
+
+    JsonStream *s = malloc(sizeof(JsonStream));
+    if (!s) {
+        if (f && f != stdin) fclose(f);
+        dp_decoder_close(z);
+        return NULL;
+    }
+    s->f = f;
+    s->z = z;
+    s->failed = 0;
+    s->data = s->buf;
+    s->len = 0;
+    s->pos = 0;
+    s->first = 1;
+    s->done = 0;
+    return s;
+}
+
+static JsonStream *json_open_memory(const char *data, size_t len) {
+    JsonStream *s = malloc(sizeof(JsonStream));
+    if (!s) return NULL;
+    s->f = NULL;
+    s->z = NULL;
+    s->failed = 0;
+    s->data = data;
+    s->len = len;
+    s->pos = 0;
+    s->first = 1;
+    s->done = 0;
+    return s;
+}
+
+static void json_close(JsonStream *s) {
+    if (!s) return;
+    if (s->f && s->f != stdin) fclose(s->f);
+    dp_decoder_close(s->z);
+    free(s);
+}
+
+static int json_peek(JsonStream *s) {
+    if (s->pos == s->len) {
+        if (s->z) {
+            ssize_t got = dp_decoder_next(s->z, &s->data);
+            s->failed = got < 0;
+            s->len = got > 0 ? (size_t)got : 0;
+        } else if (s->f) {
+            s->len = fread(s->buf, 1, sizeof(s->buf), s->f);
+        } else {
+            return EOF;
+        }
+        s->pos = 0;
+        if (s->len == 0) return EOF;
+    }
+    return (unsigned char)s->data[s->pos];
+}
+
+static int json_get(JsonStream *s) {
+    int c = json_peek(s);
+    if (c != EOF) s->pos++;
+    return c;
+}
+
+// Next non-whitespace byte, left unconsumed
+static int json_peek_token(JsonStream *s) {
+    int c;
+    while ((c = json_peek(s)) == ' ' || c == '\t' || c == '\n' || c == '\r') s->pos++;
+    return c;
+}
+
+static int is_digit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+static int is_scalar_char(int c) {
+    return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '-' || c == '+' || c == '.';
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void put_byte(char *out, size_t cap, size_t *n, int c) {
+    if (out && *n + 1 < cap) out[*n] = (char)c;
+    (*n)++;
+}
+
+// Read the rest of a string whose opening quote was consumed. Up to
+// cap - 1 bytes of the decoded text go to 'out' (NULL just skips it);
+// returns the full decoded length, or -1 on malformed input
+static long json_read_string(JsonStream *s, char *out, size_t cap) {
+    size_t n = 0;
+    for (;;) {
+        int c = json_get(s);
+        if (c == EOF) return -1;
+        if (c == '"') break;
+        if (c != '\\') {
+            put_byte(out, cap, &n, c);
+            continue;
+        }
+
+        c = json_get(s);
+        switch (c) {
+            case '"': case '\\': case '/': put_byte(out, cap, &n, c); break;
+            case 'b': put_byte(out, cap, &n, '\b'); break;
+            case 'f': put_byte(out, cap, &n, '\f'); break;
+            case 'n': put_byte(out, cap, &n, '\n'); break;
+            case 'r': put_byte(out, cap, &n, '\r'); break;
+            case 't': put_byte(out, cap, &n, '\t'); break;
+            case 'u': {
+                unsigned cp = 0;
+                for (int i = 0; i < 4; i++) {
+                    int h = hex_value(json_get(s));
+                    if (h < 0) return -1;
+                    cp = cp << 4 | (unsigned)h;
+                }
+                // UTF-8; surrogate halves are encoded as they come
+                if (cp < 0x80) {
+                    put_byte(out, cap, &n, (int)cp);
+                } else if (cp < 0x800) {
+                    put_byte(out, cap, &n, 0xC0 | (int)(cp >> 6));
+                    put_byte(out, cap, &n, 0x80 | (int)(cp & 0x3F));
+                } else {
+                    put_byte(out, cap, &n, 0xE0 | (int)(cp >> 12));
+                    put_byte(out, cap, &n, 0x80 | (int)((cp >> 6) & 0x3F));
+                    put_byte(out, cap, &n, 0x80 | (int)(cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                return -1;
+        }
+    }
+    if (out && cap) out[n < cap ? n : cap - 1] = '\0';
+    return (long)n;
+}
+
+static int json_skip_value(JsonStream *s) {
+    int c = json_peek_token(s);
+    if (c == EOF) return -1;
+
+    if (c == '"') {
+        s->pos++;
+        return json_read_string(s, NULL, 0) < 0 ? -1 : 0;
+    }
+
+    if (c == '{' || c == '[') {
+        // Brackets only need balancing here; strings are skipped whole
+        // so brackets inside them do not count
+        long depth = 0;
+        do {
+            c = json_get(s);
+            if (c == EOF) return -1;
+            if (c == '"') {
+                if (json_read_string(s, NULL, 0) < 0) return -1;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                depth--;
+            }
+        } while (depth > 0);
+        return 0;
+    }
+
+    if (!is_scalar_char(c)) return -1;
+    while ((c = json_peek(s)) != EOF && is_scalar_char(c)) s->pos++;
+    return 0;
+}
+
+// Read one value as a number: JSON numbers as themselves, true/false as
+// 1/0, numeric strings parsed, anything else (skipped) as 0.
+// 'is_number' is set only for real JSON numbers.
+static int json_read_scalar(JsonStream *s, double *out, int *is_number) {
+    int c = json_peek_token(s);
+    *out = 0.0;
+    *is_number = 0;
+
+    if (c == '-' || is_digit(c)) {
+        char text[JSON_NUMBER_MAX];
+        size_t n = 0;
+        while ((c = json_peek(s)) != EOF && is_scalar_char(c)) {
+            if (n == sizeof(text)) return -1;
+            text[n++] = (char)c;
+            s->pos++;
+        }
+        if (dp_parse_float(text, n, out) != 0) return -1;
+        *is_number = 1;
+        return 0;
+    }
+
+    if (c == '"') {
+        char text[JSON_NUMBER_MAX];
+        s->pos++;
+        long n = json_read_string(s, text, sizeof(text));
+        if (n < 0) return -1;
+        if ((size_t)n >= sizeof(text) || dp_parse_float(text, (size_t)n, out) != 0) *out = 0.0;
+        return 0;
+    }
+
+    if (c == 't') *out = 1.0;
+    return json_skip_value(s);
+}
+
+// Inside an object positioned on '{', move to the value of 'key'
+static int json_find_key(JsonStream *s, const char *key, size_t key_len) {
+    if (json_peek_token(s) != '{') return -1;
+    s->pos++;
+
+    for (;;) {
+        if (json_peek_token(s) != '"') return -1;   // '}' too: not found
+        s->pos++;
+
+        char name[JSON_KEY_MAX];
+        long n = json_read_string(s, name, sizeof(name));
+        if (n < 0 || json_peek_token(s) != ':') return -1;
+        s->pos++;
+
+        if ((size_t)n == key_len && key_len < sizeof(name) && memcmp(name, key, key_len) == 0) return 0;
+        if (json_skip_value(s) != 0) return -1;
+
+        if (json_peek_token(s) != ',') return -1;
+        s->pos++;
+    }
+}
+
+// Walk from the top-level object to the value at a dot-separated key path
+static int json_find_path(JsonStream *s, const char *path) {
+    while (*path) {
+        const char *dot = strchr(path, '.');
+        size_t len = dot ? (size_t)(dot - path) : strlen(path);
+        if (json_find_key(s, path, len) != 0) return -1;
+        path += dot ? len + 1 : len;
+    }
+    return 0;
+}
+
+static int json_array_begin(JsonStream *s) {
+    if (json_peek_token(s) != '[') return -1;
+    s->pos++;
+    s->first = 1;
+    return 0;
+}
+
+// Step to the next array element: 1 if there is one, 0 after the
+// closing bracket, -1 on malformed input
+static int json_array_next(JsonStream *s) {
+    int c = json_peek_token(s);
+    if (c == ']') {
+        s->pos++;
+        s->done = 1;
+        return 0;
+    }
+    if (!s->first) {
+        if (c != ',') return -1;
+        s->pos++;
+    }
+    s->first = 0;
+    return 1;
+}
+
+static int is_ndjson(const char *filename) {
+    return dp_path_has_extension(filename, ".ndjson") || dp_path_has_extension(filename, ".jsonl");
+}
+
+// ---------- JSON arrays ----------
+
+// Open a stream positioned inside the array at 'path'. Predicate arrays
+// that do not exist come back exhausted, so every row fails them.
+static JsonStream *json_open_array(const char *filename, const char *path, int required) {
+    JsonStream *s = json_open(filename);
+    if (!s) return NULL;
+
+    int found;
+    if (!path && json_peek_token(s) == '[') found = 1;
+    else found = json_find_path(s, path ? path : "values") == 0;
+
+    if (found && json_array_begin(s) == 0) return s;
+    if (required) {
+        json_close(s);
+        return NULL;
+    }
+    s->done = 1;
+    return s;
+}
+
+// Step every predicate array to the current row; 1 if the row passes,
+// 0 if not, -1 on malformed input
+static int json_arrays_pass(JsonStream **preds, const DP_LoadOptions *opts) {
+    int pass = 1;
+    for (size_t p = 0; p < opts->predicate_count; p++) {
+        JsonStream *s = preds[p];
+        if (s->done) {
+            pass = 0;
+            continue;
+        }
+
+        int r = json_array_next(s);
+        if (r < 0) return -1;
+        if (r == 0) {
+            pass = 0;
+            continue;
+        }
+
+        double v;
+        int is_number;
+        if (json_read_scalar(s, &v, &is_number) != 0) return -1;
+        if (!is_number || v < opts->predicates[p].min || v > opts->predicates[p].max) pass = 0;
+    }
+    return pass;
+}
+
+static int json_stream_arrays(const char *filename, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx) {
+    const char *path = opts && opts->column_count ? opts->columns[0] : NULL;
+    size_t npreds = opts ? opts->predicate_count : 0;
+
+    // Predicate arrays are read through cursors of their own
+    if (npreds && strcmp(filename, "-") == 0) {
+        fprintf(stderr, "JSON error: predicates need a file, not stdin.\n");
+        return -1;
+    }
+
+    JsonStream *values = json_open_array(filename, path, 1);
+    if (!values) return -1;
+
+    // One cursor per predicate array, each walking its own part of the file
+    JsonStream **preds = calloc(npreds ? npreds : 1, sizeof(JsonStream *));
+    int rc = preds ? 0 : -1;
+    for (size_t p = 0; rc == 0 && p < npreds; p++) {
+        preds[p] = json_open_array(filename, opts->predicates[p].column, 0);
+        if (!preds[p]) rc = -1;
+    }
+
+    while (rc == 0) {
+        int r = json_array_next(values);
+        if (r <= 0) {
+            rc = r;
+            break;
+        }
+
+        double v;
+        int is_number;
+        if (json_read_scalar(values, &v, &is_number) != 0) {
+            rc = -1;
+            break;
+        }
+
+        int pass = npreds ? json_arrays_pass(preds, opts) : 1;
+        if (pass < 0) rc = -1;
+        else if (pass && fn(ctx, v) != 0) rc = -1;
+    }
+
+    for (size_t p = 0; preds && p < npreds; p++) json_close(preds[p]);
+    free(preds);
+    json_close(values);
+    return rc;
+}
+
+// ---------- NDJSON ----------
+
+// Read one object row, whose keys may come in any order: picks up the
+// value key and clears *pass when a predicate field fails or is missing
+static int json_read_row(JsonStream *s, const char *key, const DP_LoadOptions *opts,
+                         double *value, int *has_value, int *pass) {
+    size_t npreds = opts ? opts->predicate_count : 0;
+    unsigned char *seen = calloc(npreds ? npreds : 1, 1);
+    if (!seen) return -1;
+
+    s->pos++;   // '{'
+    int rc = 0;
+    int c = json_peek_token(s);
+    if (c == '}') s->pos++;
+
+    while (c != '}') {
+        char name[JSON_KEY_MAX];
+        long n = -1;
+        if (json_peek_token(s) == '"') {
+            s->pos++;
+            n = json_read_string(s, name, sizeof(name));
+        }
+        if (n < 0 || json_peek_token(s) != ':') {
+            rc = -1;
+            break;
+        }
+        s->pos++;
+
+        int is_value = (size_t)n < sizeof(name) && strcmp(name, key) == 0;
+        int is_predicate = 0;
+        for (size_t p = 0; p < npreds && (size_t)n < sizeof(name); p++) {
+            if (strcmp(name, opts->predicates[p].column) == 0) is_predicate = 1;
+        }
+        if (!is_value && !is_predicate) {
+            if (json_skip_value(s) != 0) {
+                rc = -1;
+                break;
+            }
+        } else {
+            double v;
+            int is_number;
+            if (json_read_scalar(s, &v, &is_number) != 0) {
+                rc = -1;
+                break;
+            }
+            if (is_value) {
+                *value = v;
+                *has_value = 1;
+            }
+            for (size_t p = 0; is_predicate && p < npreds; p++) {
+                if (strcmp(name, opts->predicates[p].column) != 0) continue;
+                seen[p] = 1;
+                if (!is_number || v < opts->predicates[p].min || v > opts->predicates[p].max) *pass = 0;
+            }
+        }
+
+        c = json_peek_token(s);
+        if (c != ',' && c != '}') {
+            rc = -1;
+            break;
+        }
+        s->pos++;
+    }
+
+    for (size_t p = 0; p < npreds; p++) {
+        if (!seen[p]) *pass = 0;
+    }
+    free(seen);
+    return rc;
+}
+
+static int json_read_lines(JsonStream *s, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx) {
+    const char *key = opts && opts->column_count ? opts->columns[0] : "value";
+    size_t npreds = opts ? opts->predicate_count : 0;
+
+    int rc = 0, c;
+    while (rc == 0 && (c = json_peek_token(s)) != EOF) {
+        double value = 0.0;
+        int has_value = 0, pass = 1;
+
+        if (c == '{') {
+            rc = json_read_row(s, key, opts, &value, &has_value, &pass);
+        } else {
+            int is_number;
+            rc = json_read_scalar(s, &value, &is_number);
+            has_value = is_number;
+            pass = npreds == 0;
+        }
+        if (rc == 0 && has_value && pass && fn(ctx, value) != 0) rc = -1;
+    }
+    return rc;
+}
+
+static int json_stream_lines(const char *filename, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx) {
+    JsonStream *s = json_open(filename);
+    if (!s) return -1;
+    int rc = json_read_lines(s, opts, fn, ctx);
+    if (s->failed) rc = -1;     // Lines after the damage were lost
+    json_close(s);
+    return rc;
+}
+
+int dp_json_parse_lines(const char *data, size_t len, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx) {
+    if (!data || !fn) return -1;
+    JsonStream *s = json_open_memory(data, len);
+    if (!s) return -1;
+    int rc = json_read_lines(s, opts, fn, ctx);
+    json_close(s);
+    return rc;
+}
+
+int dp_json_stream_values(const char *filename, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx) {
+    if (!filename || !fn) return -1;
+    if (is_ndjson(filename)) return json_stream_lines(filename, opts, fn, ctx);
+    return json_stream_arrays(filename, opts, fn, ctx);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+
+#include "dp_table.h"
+
+// Receives each value that survives the load options, in document
+// order; a non-zero return stops the read, which then fails
+typedef int (*DP_JsonValueFn)(void *ctx, double value);
+
+// Stream the numbers of a JSON or NDJSON file to 'fn' without building
+// a document tree; memory use does not depend on the file size.
+//
+// JSON: the value array is found by its dot-separated key path,
+// opts->columns[0] (default "values"); a top-level array is used
+// directly when no column is named. Predicates name other arrays,
+// read in step with the values by index.
+//
+// NDJSON (.ndjson / .jsonl): every top-level value is one row. Objects
+// supply the value from the key opts->columns[0] (default "value") and
+// predicate fields from their own keys; bare numbers are the value.
+//
+// Elements are read as numbers the way the DOM loader did: true/false
+// as 1/0, numeric strings parsed, anything else 0. Predicates only
+// accept real JSON numbers. Returns 0, or -1 if the file cannot be
+// read, is malformed, or has no value array. A filename of "-" reads a
+// JSON document (without predicates) from stdin; gzip and zstd files
+// (data.ndjson.gz) are decompressed as they are read.
+int dp_json_stream_values(const char *filename, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx);
+
+// NDJSON rows already in memory ('len' bytes of whole lines), read with
+// the same rules as an .ndjson file
+int dp_json_parse_lines(const char *data, size_t len, const DP_LoadOptions *opts, DP_JsonValueFn fn, void *ctx);
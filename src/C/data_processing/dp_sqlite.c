@@ -0,0 +1,461 @@
+#include "dp_sqlite.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+#include "core/parallel.h"
+
+#define SQL_CACHE_CONNECTIONS 16
+#define SQL_CACHE_STATEMENTS 16
+#define SQL_MIN_PARTITION_ROWS 65536
+
+// ---------- Connection and statement cache ----------
+
+typedef struct {
+    char *sql;
+    sqlite3_stmt *stmt;
+    unsigned long last_use;
+} SqlStatement;
+
+// One read-only connection. 'slot' tells apart the connections that
+// parallel readers hold on the same file at the same time.
+typedef struct {
+    char *path;
+    size_t slot;
+    sqlite3 *db;
+    SqlStatement stmts[SQL_CACHE_STATEMENTS];
+    unsigned long stmt_clock;   // Stamps the statements' last_use
+    unsigned long last_use;     // sql_clock when last acquired
+    int busy;
+    int transient;          // Not in the cache; closed on release
+} SqlConnection;
+
+static SqlConnection sql_cache[SQL_CACHE_CONNECTIONS];
+static unsigned long sql_clock;
+static pthread_mutex_t sql_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void sql_connection_close(SqlConnection *c) {
+    for (size_t i = 0; i < SQL_CACHE_STATEMENTS; i++) {
+        sqlite3_finalize(c->stmts[i].stmt);
+        free(c->stmts[i].sql);
+    }
+    sqlite3_close(c->db);
+    free(c->path);
+    memset(c, 0, sizeof(*c));
+}
+
+static int sql_connection_open(SqlConnection *c, const char *path, size_t slot) {
+    memset(c, 0, sizeof(*c));
+    c->path = strdup(path);
+    if (!c->path) return -1;
+    c->slot = slot;
+    if (sqlite3_open_v2(path, &c->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        fprintf(stderr, "SQLite error: cannot open '%s': %s\n", path, c->db ? sqlite3_errmsg(c->db) : "out of memory");
+        sql_connection_close(c);
+        return -1;
+    }
+    return 0;
+}
+
+// Take the cached connection for (path, slot), opening it on first use.
+// When every cache entry is taken a transient connection is returned.
+static SqlConnection *sql_acquire(const char *path, size_t slot) {
+    pthread_mutex_lock(&sql_cache_lock);
+    SqlConnection *hit = NULL, *victim = NULL;
+    for (size_t i = 0; i < SQL_CACHE_CONNECTIONS && !hit; i++) {
+        SqlConnection *c = &sql_cache[i];
+        if (c->busy) continue;
+        if (c->db && c->slot == slot && strcmp(c->path, path) == 0) hit = c;
+        else if (!victim || !c->db || (victim->db && c->last_use < victim->last_use)) victim = c;
+    }
+
+    SqlConnection *c = hit;
+    if (!c && victim) {
+        if (victim->db) sql_connection_close(victim);
+        if (sql_connection_open(victim, path, slot) == 0) c = victim;
+    }
+    if (c) {
+        c->busy = 1;
+        c->last_use = ++sql_clock;
+    }
+    pthread_mutex_unlock(&sql_cache_lock);
+    if (c || victim) return c;
+
+    c = malloc(sizeof(SqlConnection));
+    if (!c) return NULL;
+    if (sql_connection_open(c, path, slot) != 0) {
+        free(c);
+        return NULL;
+    }
+    c->transient = 1;
+    return c;
+}
+
+static void sql_release(SqlConnection *c) {
+    if (!c) return;
+    if (c->transient) {
+        sql_connection_close(c);
+        free(c);
+        return;
+    }
+    pthread_mutex_lock(&sql_cache_lock);
+    c->busy = 0;
+    pthread_mutex_unlock(&sql_cache_lock);
+}
+
+// Prepared statement for 'sql' on 'c', reset and unbound if it was
+// cached; the least recently used statement makes room for a new one.
+// NULL on failure, with the reason in sqlite3_errmsg(c->db).
+static sqlite3_stmt *sql_prepare(SqlConnection *c, const char *sql) {
+    SqlStatement *slot = &c->stmts[0];
+    for (size_t i = 0; i < SQL_CACHE_STATEMENTS; i++) {
+        SqlStatement *s = &c->stmts[i];
+        if (s->stmt && strcmp(s->sql, sql) == 0) {
+            sqlite3_reset(s->stmt);
+            sqlite3_clear_bindings(s->stmt);
+            s->last_use = ++c->stmt_clock;
+            return s->stmt;
+        }
+        if (!s->stmt ? slot->stmt != NULL : (slot->stmt && s->last_use < slot->last_use)) slot = s;
+    }
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v3(c->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL) != SQLITE_OK) return NULL;
+    char *copy = strdup(sql);
+    if (!copy) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+
+    sqlite3_finalize(slot->stmt);
+    free(slot->sql);
+    slot->sql = copy;
+    slot->stmt = stmt;
+    slot->last_use = ++c->stmt_clock;
+    return stmt;
+}
+
+void dp_sqlite_close_all(void) {
+    pthread_mutex_lock(&sql_cache_lock);
+    for (size_t i = 0; i < SQL_CACHE_CONNECTIONS; i++) {
+        if (sql_cache[i].db && !sql_cache[i].busy) sql_connection_close(&sql_cache[i]);
+    }
+    pthread_mutex_unlock(&sql_cache_lock);
+}
+
+// ---------- SQL text ----------
+
+typedef struct {
+    char *text;
+    size_t len;
+    size_t cap;
+    int failed;
+} SqlBuilder;
+
+static void sql_append(SqlBuilder *b, const char *s) {
+    size_t n = strlen(s);
+    if (b->failed) return;
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 128;
+        while (cap < b->len + n + 1) cap *= 2;
+        char *text = realloc(b->text, cap);
+        if (!text) {
+            b->failed = 1;
+            return;
+        }
+        b->text = text;
+        b->cap = cap;
+    }
+    memcpy(b->text + b->len, s, n + 1);
+    b->len += n;
+}
+
+// "name" with embedded quotes doubled, so any table or column name is safe
+static void sql_append_ident(SqlBuilder *b, const char *name) {
+    char one[2] = { 0, 0 };
+    sql_append(b, "\"");
+    for (const char *p = name; *p; p++) {
+        one[0] = *p;
+        sql_append(b, *p == '"' ? "\"\"" : one);
+    }
+    sql_append(b, "\"");
+}
+
+static const char *sql_value_column(const DP_SqlQuery *q) {
+    return q && q->column ? q->column : "value";
+}
+
+static int sql_grouped(const DP_SqlQuery *q) {
+    return q && q->aggregate != DP_SQL_ROWS && q->group_by;
+}
+
+// SELECT for 'q'; a partitioned scan adds a leading "rowid BETWEEN ?1
+// AND ?2" and reads in rowid order
+static char *sql_build(const char *table, const DP_SqlQuery *q, int partitioned) {
+    static const char *const agg_names[] = { "", "total", "avg", "min", "max", "count" };
+    SqlBuilder b = { 0 };
+    const char *value = sql_value_column(q);
+    DP_SqlAggregate agg = q ? q->aggregate : DP_SQL_ROWS;
+
+    sql_append(&b, "SELECT ");
+    if (sql_grouped(q)) {
+        sql_append_ident(&b, q->group_by);
+        sql_append(&b, ", ");
+    }
+    if (agg != DP_SQL_ROWS) {
+        sql_append(&b, agg_names[agg]);
+        sql_append(&b, "(");
+    }
+    sql_append_ident(&b, value);
+    if (agg != DP_SQL_ROWS) sql_append(&b, ")");
+    sql_append(&b, " FROM ");
+    sql_append_ident(&b, table);
+
+    const char *join = " WHERE ";
+    if (partitioned) {
+        sql_append(&b, " WHERE rowid BETWEEN ? AND ?");
+        join = " AND ";
+    }
+    for (size_t i = 0; q && i < q->predicate_count; i++) {
+        const DP_RangePredicate *p = &q->predicates[i];
+        sql_append(&b, join);
+        sql_append(&b, "typeof(");
+        sql_append_ident(&b, p->column);
+        sql_append(&b, ") IN ('integer', 'real')");
+        if (isfinite(p->min)) {
+            sql_append(&b, " AND ");
+            sql_append_ident(&b, p->column);
+            sql_append(&b, " >= ?");
+        }
+        if (isfinite(p->max)) {
+            sql_append(&b, " AND ");
+            sql_append_ident(&b, p->column);
+            sql_append(&b, " <= ?");
+        }
+        join = " AND ";
+    }
+
+    if (sql_grouped(q)) {
+        sql_append(&b, " GROUP BY ");
+        sql_append_ident(&b, q->group_by);
+        sql_append(&b, " ORDER BY ");
+        sql_append_ident(&b, q->group_by);
+    } else if (partitioned) {
+        sql_append(&b, " ORDER BY rowid");
+    }
+
+    if (b.failed) {
+        free(b.text);
+        return NULL;
+    }
+    return b.text;
+}
+
+// Bind the finite predicate bounds from parameter 'first' on, in the
+// order sql_build wrote them
+static int sql_bind_predicates(sqlite3_stmt *stmt, const DP_SqlQuery *q, int first) {
+    int index = first;
+    for (size_t i = 0; q && i < q->predicate_count; i++) {
+        const DP_RangePredicate *p = &q->predicates[i];
+        if (isfinite(p->min) && sqlite3_bind_double(stmt, index++, p->min) != SQLITE_OK) return -1;
+        if (isfinite(p->max) && sqlite3_bind_double(stmt, index++, p->max) != SQLITE_OK) return -1;
+    }
+    return 0;
+}
+
+// ---------- Serial reads ----------
+
+// Step 'stmt' to completion, adding column 'value_col' of each row; with
+// 'keys', column 0 is collected as the group key. Plain rows read NULL
+// as 0 like the old loader did, while a NULL aggregate (avg, min or max
+// over no values) produces no value at all.
+static int sql_collect(sqlite3_stmt *stmt, int value_col, int skip_null, DP_DataSet *ds, char ***keys) {
+    size_t cap = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (skip_null && sqlite3_column_type(stmt, value_col) == SQLITE_NULL) continue;
+        if (keys) {
+            if (ds->count == cap) {
+                cap = cap ? cap * 2 : 16;
+                char **grown = realloc(*keys, cap * sizeof(char *));
+                if (!grown) return -1;
+                *keys = grown;
+            }
+            const unsigned char *key = sqlite3_column_text(stmt, 0);
+            (*keys)[ds->count] = strdup(key ? (const char *)key : "");
+            if (!(*keys)[ds->count]) return -1;
+        }
+        if (dp_dataset_add(ds, sqlite3_column_double(stmt, value_col)) != 0) {
+            if (keys) free((*keys)[ds->count]);
+            return -1;
+        }
+    }
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+static int sql_query_serial(const char *path, const char *table, const DP_SqlQuery *q,
+                            DP_DataSet *ds, char ***group_keys) {
+    SqlConnection *c = sql_acquire(path, 0);
+    if (!c) return -1;
+
+    int grouped = sql_grouped(q);
+    char *sql = sql_build(table, q, 0);
+    sqlite3_stmt *stmt = sql ? sql_prepare(c, sql) : NULL;
+    int rc = -1;
+    if (stmt && sql_bind_predicates(stmt, q, 1) == 0) {
+        char **keys = NULL;
+        rc = sql_collect(stmt, grouped, q && q->aggregate != DP_SQL_ROWS, ds, grouped ? &keys : NULL);
+        sqlite3_reset(stmt);
+        if (rc == 0 && group_keys) *group_keys = keys;
+        else dp_sqlite_free_keys(keys, ds->count);
+    }
+    if (rc != 0) fprintf(stderr, "SQLite error: query on '%s' failed: %s\n", table, sqlite3_errmsg(c->db));
+
+    free(sql);
+    sql_release(c);
+    return rc;
+}
+
+// ---------- Partitioned reads ----------
+
+typedef struct {
+    sqlite3_int64 lo;
+    sqlite3_int64 hi;
+    double *values;
+    size_t count;
+    size_t capacity;
+    int failed;
+} SqlPartition;
+
+typedef struct {
+    const char *path;
+    const char *sql;
+    const DP_SqlQuery *q;
+    SqlPartition *parts;
+} SqlScanJob;
+
+static int sql_partition_push(SqlPartition *p, double v) {
+    if (p->count == p->capacity) {
+        size_t cap = p->capacity ? p->capacity * 2 : 1024;
+        double *values = realloc(p->values, cap * sizeof(double));
+        if (!values) return -1;
+        p->values = values;
+        p->capacity = cap;
+    }
+    p->values[p->count++] = v;
+    return 0;
+}
+
+static void sql_scan_task(void *ctx, size_t task) {
+    SqlScanJob *job = ctx;
+    SqlPartition *p = &job->parts[task];
+    p->failed = 1;
+
+    SqlConnection *c = sql_acquire(job->path, task);
+    if (!c) return;
+
+    sqlite3_stmt *stmt = sql_prepare(c, job->sql);
+    if (stmt && sqlite3_bind_int64(stmt, 1, p->lo) == SQLITE_OK &&
+        sqlite3_bind_int64(stmt, 2, p->hi) == SQLITE_OK &&
+        sql_bind_predicates(stmt, job->q, 3) == 0) {
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (sql_partition_push(p, sqlite3_column_double(stmt, 0)) != 0) break;
+        }
+        p->failed = rc != SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sql_release(c);
+}
+
+// Rowid bounds of 'table'; 1 for empty tables and those without rowids
+// (and views), -1 if the database cannot be opened
+static int sql_rowid_range(const char *path, const char *table, sqlite3_int64 *lo, sqlite3_int64 *hi) {
+    SqlConnection *c = sql_acquire(path, 0);
+    if (!c) return -1;
+
+    SqlBuilder b = { 0 };
+    sql_append(&b, "SELECT min(rowid), max(rowid) FROM ");
+    sql_append_ident(&b, table);
+
+    int rc = 1;
+    sqlite3_stmt *stmt = b.failed ? NULL : sql_prepare(c, b.text);
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        *lo = sqlite3_column_int64(stmt, 0);
+        *hi = sqlite3_column_int64(stmt, 1);
+        rc = 0;
+    }
+    if (stmt) sqlite3_reset(stmt);
+    free(b.text);
+    sql_release(c);
+    return rc;
+}
+
+// Read a plain row scan as parallel rowid ranges, worker k on connection
+// slot k; 1 if the table is small or has no rowids, so the caller should
+// read it serially
+static int sql_scan_partitioned(const char *path, const char *table, const DP_SqlQuery *q, DP_DataSet *ds) {
+    if (parallel_threads() <= 1) return 1;
+
+    sqlite3_int64 lo, hi;
+    int rc = sql_rowid_range(path, table, &lo, &hi);
+    if (rc != 0) return rc;
+
+    uint64_t span = (uint64_t)hi - (uint64_t)lo + 1;
+    size_t tasks = parallel_plan(span > SIZE_MAX ? SIZE_MAX : (size_t)span, SQL_MIN_PARTITION_ROWS);
+    if (tasks <= 1) return 1;
+
+    char *sql = sql_build(table, q, 1);
+    SqlPartition *parts = calloc(tasks, sizeof(SqlPartition));
+    rc = sql && parts ? 0 : -1;
+
+    if (rc == 0) {
+        uint64_t step = span / tasks;
+        for (size_t k = 0; k < tasks; k++) {
+            parts[k].lo = (sqlite3_int64)((uint64_t)lo + k * step);
+            parts[k].hi = k + 1 == tasks ? hi : (sqlite3_int64)((uint64_t)lo + (k + 1) * step - 1);
+        }
+
+        SqlScanJob job = { path, sql, q, parts };
+        parallel_run(tasks, sql_scan_task, &job);
+
+        for (size_t k = 0; k < tasks && rc == 0; k++) {
+            if (parts[k].failed) rc = -1;
+            for (size_t i = 0; rc == 0 && i < parts[k].count; i++) rc = dp_dataset_add(ds, parts[k].values[i]);
+        }
+        if (rc != 0) fprintf(stderr, "SQLite error: partitioned read of '%s' failed.\n", table);
+    }
+
+    for (size_t k = 0; parts && k < tasks; k++) free(parts[k].values);
+    free(parts);
+    free(sql);
+    return rc;
+}
+
+// ---------- Queries ----------
+
+DP_DataSet *dp_sqlite_query(const char *db_path, const char *table, const DP_SqlQuery *q, char ***group_keys) {
+    if (!db_path || !table) return NULL;
+    if (group_keys) *group_keys = NULL;
+
+    // Created before any connection, so no statement is held yet
+    DP_DataSet *ds = dp_dataset_new(table);
+    if (!ds) return NULL;
+    int rc = 1;
+    if (!q || q->aggregate == DP_SQL_ROWS) rc = sql_scan_partitioned(db_path, table, q, ds);
+    if (rc == 1) rc = sql_query_serial(db_path, table, q, ds, group_keys);
+
+    if (rc != 0) {
+        dp_dataset_free(ds);
+        return NULL;
+    }
+    return ds;
+}
+
+void dp_sqlite_free_keys(char **keys, size_t count) {
+    for (size_t i = 0; keys && i < count; i++) free(keys[i]);
+    free(keys);
+}
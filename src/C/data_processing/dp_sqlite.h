@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+
+#include "dp_dataset.h"
+
+// Aggregate evaluated by SQLite instead of pulling every row
+typedef enum {
+    DP_SQL_ROWS,        // No aggregate: one value per row
+    DP_SQL_SUM,
+    DP_SQL_AVG,
+    DP_SQL_MIN,
+    DP_SQL_MAX,
+    DP_SQL_COUNT
+} DP_SqlAggregate;
+
+// What to read from one table. Everything here is pushed into the SQL
+// text; range bounds are bound as parameters, so the statement for a
+// given query shape is prepared once and reused from the cache.
+typedef struct {
+    const char *column;                     // Value column, NULL = "value"
+    const DP_RangePredicate *predicates;    // Non-numeric values fail
+    size_t predicate_count;
+    DP_SqlAggregate aggregate;
+    const char *group_by;                   // With an aggregate: one value per group
+} DP_SqlQuery;
+
+// Run 'q' (NULL = every row of "value") against 'table'. With group_by,
+// values come out in key order and, if 'group_keys' is non-NULL, it
+// receives the key text of each value (free with dp_sqlite_free_keys).
+// Plain row scans of rowid tables are split into rowid ranges read in
+// parallel, each over its own read-only connection; the values keep
+// rowid order. Returns NULL on error.
+DP_DataSet *dp_sqlite_query(const char *db_path, const char *table, const DP_SqlQuery *q, char ***group_keys);
+void dp_sqlite_free_keys(char **keys, size_t count);
+
+// Connections are opened read-only and kept, with their prepared
+// statements, until this is called
+void dp_sqlite_close_all(void);
@@ -0,0 +1,277 @@
+#include "dp_stream.h"
+#include "dp_json.h"
+#include "dp_decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define STREAM_READ_SIZE (1 << 20)
+
+// ---------- Accumulators ----------
+
+int dp_stream_agg_init(DP_StreamAgg *agg, uint32_t quantile_k) {
+    memset(agg, 0, sizeof(*agg));
+    welford_init(&agg->welford);
+    if (quantile_k == 0) return 0;
+
+    agg->sketch = malloc(sizeof(KLLSketch));
+    if (!agg->sketch || kll_init(agg->sketch, quantile_k) != 0) {
+        free(agg->sketch);
+        agg->sketch = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int dp_stream_agg_histogram(DP_StreamAgg *agg, double min, double max, size_t bins) {
+    if (bins == 0 || !(min < max)) return -1;
+    size_t *counts = calloc(bins, sizeof(size_t));
+    if (!counts) return -1;
+    free(agg->bins);
+    agg->bins = counts;
+    agg->bin_count = bins;
+    agg->bin_min = min;
+    agg->bin_max = max;
+    agg->below = 0;
+    agg->above = 0;
+    return 0;
+}
+
+void dp_stream_agg_add(DP_StreamAgg *agg, double value) {
+    DP_Stats *s = &agg->stats;
+    if (s->count == 0 || value < s->min) s->min = value;
+    if (s->count == 0 || value > s->max) s->max = value;
+    s->sum += value;
+    s->count++;
+    s->mean = s->sum / (double)s->count;
+    welford_add(&agg->welford, value);
+    if (agg->sketch) kll_add(agg->sketch, value);
+
+    if (agg->bins) {
+        if (value < agg->bin_min) {
+            agg->below++;
+        } else if (value >= agg->bin_max) {
+            agg->above++;
+        } else {
+            size_t b = (size_t)((value - agg->bin_min) / (agg->bin_max - agg->bin_min) * (double)agg->bin_count);
+            agg->bins[b < agg->bin_count ? b : agg->bin_count - 1]++;
+        }
+    }
+}
+
+int dp_stream_agg_reset(DP_StreamAgg *agg) {
+    memset(&agg->stats, 0, sizeof(agg->stats));
+    welford_init(&agg->welford);
+    agg->below = 0;
+    agg->above = 0;
+    if (agg->bins) memset(agg->bins, 0, agg->bin_count * sizeof(size_t));
+    if (!agg->sketch) return 0;
+
+    uint32_t k = agg->sketch->k;
+    kll_free(agg->sketch);
+    return kll_init(agg->sketch, k);
+}
+
+double dp_stream_agg_stddev(const DP_StreamAgg *agg) {
+    return welford_stddev(&agg->welford);
+}
+
+double dp_stream_agg_percentile(const DP_StreamAgg *agg, double p) {
+    if (!agg->sketch || agg->stats.count == 0) return NAN;
+    return kll_quantile(agg->sketch, p / 100.0);
+}
+
+void dp_stream_agg_free(DP_StreamAgg *agg) {
+    if (agg->sketch) {
+        kll_free(agg->sketch);
+        free(agg->sketch);
+    }
+    free(agg->bins);
+    memset(agg, 0, sizeof(*agg));
+}
+
+// ---------- Record feed ----------
+
+void dp_feed_init(DP_RecordFeed *feed, int ndjson, const DP_LoadOptions *opts,
+                  const char *source, DP_ValueFn fn, void *ctx) {
+    memset(feed, 0, sizeof(*feed));
+    feed->ndjson = ndjson;
+    feed->opts = opts;
+    feed->source = source;
+    feed->fn = fn;
+    feed->ctx = ctx;
+    feed->value_field = opts && opts->column_count ? 0 : -1;
+}
+
+// The first row picks the value field; a missing field or one that is
+// not a number counts as 0, as in the CSV loader
+static int feed_csv_row(void *ctx, const char *const *fields, const size_t *lens, size_t nfields) {
+    DP_RecordFeed *feed = ctx;
+    if (feed->value_field < 0) feed->value_field = (long)dp_csv_value_field(fields, lens, nfields);
+
+    double value;
+    size_t f = (size_t)feed->value_field;
+    if (f >= nfields || dp_parse_float(fields[f], lens[f], &value) != 0) value = 0.0;
+    return feed->fn(feed->ctx, value);
+}
+
+// Hand the whole records at the front of 'pending' to the parser and
+// keep the unfinished rest
+static int feed_consume(DP_RecordFeed *feed) {
+    size_t start = 0;
+    if (!feed->ndjson && !feed->csv) {
+        size_t whole = dp_csv_complete(feed->pending, feed->pending_len);
+        if (whole == 0) return 0;
+        feed->csv = dp_csv_cursor_new(feed->pending, whole, feed->opts, feed->source, &start);
+        if (!feed->csv) return -1;
+    }
+
+    size_t end = start;
+    if (feed->ndjson) {
+        for (size_t i = feed->pending_len; i > start; i--) {
+            if (feed->pending[i - 1] == '\n') {
+                end = i;
+                break;
+            }
+        }
+    } else {
+        end += dp_csv_complete(feed->pending + start, feed->pending_len - start);
+    }
+
+    int rc = 0;
+    if (end > start) {
+        rc = feed->ndjson
+            ? dp_json_parse_lines(feed->pending + start, end - start, feed->opts, feed->fn, feed->ctx)
+            : dp_csv_cursor_feed(feed->csv, feed->pending + start, end - start, feed_csv_row, feed);
+        if (rc != 0) fprintf(stderr, "Stream error: failed to process rows in '%s'.\n", feed->source);
+    }
+
+    memmove(feed->pending, feed->pending + end, feed->pending_len - end);
+    feed->pending_len -= end;
+    return rc;
+}
+
+char *dp_feed_space(DP_RecordFeed *feed, size_t want) {
+    if (feed->pending_cap - feed->pending_len < want) {
+        size_t cap = feed->pending_len + want;
+        char *pending = realloc(feed->pending, cap);
+        if (!pending) return NULL;
+        feed->pending = pending;
+        feed->pending_cap = cap;
+    }
+    return feed->pending + feed->pending_len;
+}
+
+int dp_feed_commit(DP_RecordFeed *feed, size_t len) {
+    feed->pending_len += len;
+    return len ? feed_consume(feed) : 0;
+}
+
+int dp_feed_finish(DP_RecordFeed *feed) {
+    if (feed->pending_len == 0) return 0;
+    char *end = dp_feed_space(feed, 1);
+    if (!end) return -1;
+    *end = '\n';
+    int rc = dp_feed_commit(feed, 1);
+    feed->pending_len = 0;      // An unterminated quote is dropped
+    return rc;
+}
+
+void dp_feed_reset(DP_RecordFeed *feed) {
+    dp_csv_cursor_free(feed->csv);
+    feed->csv = NULL;
+    feed->value_field = feed->opts && feed->opts->column_count ? 0 : -1;
+    feed->pending_len = 0;
+}
+
+void dp_feed_free(DP_RecordFeed *feed) {
+    dp_csv_cursor_free(feed->csv);
+    free(feed->pending);
+    memset(feed, 0, sizeof(*feed));
+}
+
+// ---------- Files ----------
+
+static DP_Format format_from_path(const char *path) {
+    if (dp_path_has_extension(path, ".ndjson") || dp_path_has_extension(path, ".jsonl")) return DP_FORMAT_NDJSON;
+    if (dp_path_has_extension(path, ".json")) return DP_FORMAT_JSON;
+    return DP_FORMAT_CSV;
+}
+
+static int stream_add(void *ctx, double value) {
+    dp_stream_agg_add(ctx, value);
+    return 0;
+}
+
+// Decoded blocks go to the feed as the decoding thread produces them
+static int stream_decoded(const char *path, DP_RecordFeed *feed) {
+    DP_Decoder *z = dp_decoder_open(path);
+    if (!z) return -1;
+
+    const char *block;
+    ssize_t got;
+    int rc = 0;
+    while (rc == 0 && (got = dp_decoder_next(z, &block)) != 0) {
+        char *space = got > 0 ? dp_feed_space(feed, (size_t)got) : NULL;
+        if (!space) {
+            rc = -1;
+            break;
+        }
+        memcpy(space, block, (size_t)got);
+        rc = dp_feed_commit(feed, (size_t)got);
+    }
+    dp_decoder_close(z);
+    return rc == 0 ? dp_feed_finish(feed) : -1;
+}
+
+int dp_stream_file(const char *path, DP_Format format, const DP_LoadOptions *opts, DP_StreamAgg *agg) {
+    if (!path || !agg) return -1;
+    if (format == DP_FORMAT_AUTO) format = format_from_path(path);
+    if (format == DP_FORMAT_JSON) return dp_json_stream_values(path, opts, stream_add, agg);
+
+    if (dp_compression_of(path) != DP_COMPRESSION_NONE) {
+        DP_RecordFeed feed;
+        dp_feed_init(&feed, format == DP_FORMAT_NDJSON, opts, path, stream_add, agg);
+        int rc = stream_decoded(path, &feed);
+        dp_feed_free(&feed);
+        return rc;
+    }
+
+    int is_stdin = strcmp(path, "-") == 0;
+    int fd = is_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Stream error: cannot open '%s'.\n", path);
+        return -1;
+    }
+
+    DP_RecordFeed feed;
+    dp_feed_init(&feed, format == DP_FORMAT_NDJSON, opts, is_stdin ? "stdin" : path, stream_add, agg);
+
+    // Only one read buffer's worth of text is ever held
+    int rc = 0;
+    for (;;) {
+        char *space = dp_feed_space(&feed, STREAM_READ_SIZE);
+        ssize_t got = space ? read(fd, space, STREAM_READ_SIZE) : -1;
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            if (got < 0) {
+                fprintf(stderr, "Stream error: failed reading '%s'.\n", path);
+                rc = -1;
+            }
+            break;
+        }
+        if (dp_feed_commit(&feed, (size_t)got) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+    if (rc == 0) rc = dp_feed_finish(&feed);
+
+    dp_feed_free(&feed);
+    if (!is_stdin) close(fd);
+    return rc;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stddef.h>
+
+#include "core/quantile.h"
+#include "dp_dataset.h"
+
+// Constant-memory aggregation: loaders push values straight into these
+// accumulators and nothing per row is kept, so a file of any size (or
+// stdin) is summarized in flat memory.
+
+// Receives each value; a non-zero return stops the input with an error
+typedef int (*DP_ValueFn)(void *ctx, double value);
+
+// Running aggregates over every value added
+typedef struct {
+    DP_Stats stats;
+    WelfordState welford;
+    KLLSketch *sketch;      // Approximate quantiles, when enabled
+    size_t *bins;           // Equal-width histogram over [bin_min, bin_max)
+    size_t bin_count;
+    double bin_min;
+    double bin_max;
+    size_t below;           // Values outside the histogram range
+    size_t above;
+} DP_StreamAgg;
+
+// 'quantile_k' > 0 keeps a KLL sketch with that k (see quantile.h)
+int dp_stream_agg_init(DP_StreamAgg *agg, uint32_t quantile_k);
+int dp_stream_agg_histogram(DP_StreamAgg *agg, double min, double max, size_t bins);
+void dp_stream_agg_add(DP_StreamAgg *agg, double value);
+// Back to no values, keeping the sketch and histogram settings
+int dp_stream_agg_reset(DP_StreamAgg *agg);
+double dp_stream_agg_stddev(const DP_StreamAgg *agg);
+// Approximate p-th percentile (0..100); NAN without a sketch
+double dp_stream_agg_percentile(const DP_StreamAgg *agg, double p);
+void dp_stream_agg_free(DP_StreamAgg *agg);
+
+// Splits CSV or NDJSON text that arrives in pieces into whole records
+// and pushes the value of every row that survives 'opts' to 'fn'. The
+// value is chosen as by the loaders: opts->columns[0] when given,
+// otherwise (CSV) the field dp_csv_value_field picks from the first row.
+typedef struct {
+    int ndjson;
+    const DP_LoadOptions *opts;     // Borrowed; must outlive the feed
+    const char *source;             // Name used in messages
+    DP_CsvCursor *csv;              // Built once the header has arrived
+    long value_field;               // CSV field holding the value, -1 until known
+    char *pending;                  // Text not yet parsed (an unfinished record)
+    size_t pending_len;
+    size_t pending_cap;
+    DP_ValueFn fn;
+    void *ctx;
+} DP_RecordFeed;
+
+void dp_feed_init(DP_RecordFeed *feed, int ndjson, const DP_LoadOptions *opts,
+                  const char *source, DP_ValueFn fn, void *ctx);
+// Room for 'want' more bytes after the pending text, or NULL
+char *dp_feed_space(DP_RecordFeed *feed, size_t want);
+// Take 'len' bytes written into that space and parse the whole records
+int dp_feed_commit(DP_RecordFeed *feed, size_t len);
+// End of input: parse a last record that has no newline
+int dp_feed_finish(DP_RecordFeed *feed);
+// Forget the header and pending text (the input starts over)
+void dp_feed_reset(DP_RecordFeed *feed);
+void dp_feed_free(DP_RecordFeed *feed);
+
+typedef enum {
+    DP_FORMAT_AUTO,     // From the extension; stdin defaults to CSV
+    DP_FORMAT_CSV,
+    DP_FORMAT_JSON,
+    DP_FORMAT_NDJSON
+} DP_Format;
+
+// Stream every value of 'path' ("-" for stdin) into 'agg'. JSON
+// documents go through the streaming JSON reader; predicates on a JSON
+// document need a real file. gzip / zstd files are decompressed on the
+// fly (see dp_decompress.h). Returns 0, or -1 on error.
+int dp_stream_file(const char *path, DP_Format format, const DP_LoadOptions *opts, DP_StreamAgg *agg);
@@ -0,0 +1,1574 @@
+#define _GNU_SOURCE
+#include "dp_table.h"
+#include "dp_decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <locale.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "core/hash.h"
+#include "core/parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define TABLE_INITIAL_ROWS 64
+#define DICT_INITIAL_SLOTS 64
+#define DICT_INITIAL_ARENA 1024
+
+// ---------- Dictionary ----------
+
+static void dict_free(DP_Dictionary *d) {
+    if (!d) return;
+    free(d->arena);
+    free(d->offsets);
+    free(d->hashes);
+    free(d->slots);
+    free(d);
+}
+
+static int dict_grow_slots(DP_Dictionary *d) {
+    size_t cap = d->slot_capacity ? d->slot_capacity * 2 : DICT_INITIAL_SLOTS;
+    uint32_t *slots = calloc(cap, sizeof(uint32_t));
+    if (!slots) return -1;
+
+    for (size_t code = 0; code < d->count; code++) {
+        size_t s = d->hashes[code] & (cap - 1);
+        while (slots[s]) s = (s + 1) & (cap - 1);
+        slots[s] = (uint32_t)code + 1;
+    }
+
+    free(d->slots);
+    d->slots = slots;
+    d->slot_capacity = cap;
+    return 0;
+}
+
+// Code for the string s[0..len), adding it on first sight; UINT32_MAX on failure
+static uint32_t dict_intern(DP_Dictionary *d, const char *s, size_t len) {
+    if ((d->count + 1) * 10 > d->slot_capacity * 7 && dict_grow_slots(d) != 0) return UINT32_MAX;
+
+    uint64_t h = hash_bytes(s, len);
+    size_t mask = d->slot_capacity - 1;
+    size_t slot = h & mask;
+    while (d->slots[slot]) {
+        uint32_t code = d->slots[slot] - 1;
+        const char *existing = d->arena + d->offsets[code];
+        if (d->hashes[code] == h && strncmp(existing, s, len) == 0 && existing[len] == '\0') {
+            return code;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (d->count == UINT32_MAX - 1) return UINT32_MAX;
+
+    if (d->count == d->capacity) {
+        size_t cap = d->capacity ? d->capacity * 2 : DICT_INITIAL_SLOTS;
+        size_t *offsets = realloc(d->offsets, cap * sizeof(size_t));
+        if (!offsets) return UINT32_MAX;
+        d->offsets = offsets;
+        uint64_t *hashes = realloc(d->hashes, cap * sizeof(uint64_t));
+        if (!hashes) return UINT32_MAX;
+        d->hashes = hashes;
+        d->capacity = cap;
+    }
+
+    if (d->arena_used + len + 1 > d->arena_capacity) {
+        size_t cap = d->arena_capacity ? d->arena_capacity : DICT_INITIAL_ARENA;
+        while (cap < d->arena_used + len + 1) cap *= 2;
+        char *arena = realloc(d->arena, cap);
+        if (!arena) return UINT32_MAX;
+        d->arena = arena;
+        d->arena_capacity = cap;
+    }
+
+    memcpy(d->arena + d->arena_used, s, len);
+    d->arena[d->arena_used + len] = '\0';
+
+    uint32_t code = (uint32_t)d->count++;
+    d->offsets[code] = d->arena_used;
+    d->hashes[code] = h;
+    d->arena_used += len + 1;
+    d->slots[slot] = code + 1;
+    return code;
+}
+
+// ---------- Table ----------
+
+DP_Table *dp_table_new(const char *name) {
+    DP_Table *t = calloc(1, sizeof(DP_Table));
+    if (!t) return NULL;
+    t->name = strdup(name ? name : "");
+    if (!t->name) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+static size_t bit_words(size_t rows) {
+    return (rows + 63) / 64;
+}
+
+static int column_resize(DP_Column *col, size_t old_rows, size_t rows) {
+    void *p;
+    switch (col->type) {
+        case DATA_TYPE_INT:
+            p = realloc(col->data.ints, rows * sizeof(int64_t));
+            if (!p) return -1;
+            col->data.ints = p;
+            break;
+        case DATA_TYPE_FLOAT:
+            p = realloc(col->data.floats, rows * sizeof(double));
+            if (!p) return -1;
+            col->data.floats = p;
+            break;
+        case DATA_TYPE_DATE:
+            p = realloc(col->data.dates, rows * sizeof(int32_t));
+            if (!p) return -1;
+            col->data.dates = p;
+            break;
+        case DATA_TYPE_BOOL: {
+            size_t old_words = bit_words(old_rows), words = bit_words(rows);
+            p = realloc(col->data.bits, (words ? words : 1) * sizeof(uint64_t));
+            if (!p) return -1;
+            col->data.bits = p;
+            if (words > old_words) {
+                memset(col->data.bits + old_words, 0, (words - old_words) * sizeof(uint64_t));
+            }
+            break;
+        }
+        case DATA_TYPE_STRING:
+            p = realloc(col->data.codes, rows * sizeof(uint32_t));
+            if (!p) return -1;
+            col->data.codes = p;
+            break;
+    }
+    return 0;
+}
+
+int dp_table_reserve(DP_Table *t, size_t rows) {
+    if (!t) return -1;
+    if (rows <= t->capacity) return 0;
+
+    size_t cap = t->capacity ? t->capacity : TABLE_INITIAL_ROWS;
+    while (cap < rows) cap *= 2;
+
+    for (size_t c = 0; c < t->column_count; c++) {
+        if (column_resize(&t->columns[c], t->capacity, cap) != 0) return -1;
+    }
+    t->capacity = cap;
+    return 0;
+}
+
+int dp_table_add_column(DP_Table *t, const char *name, DataType type) {
+    if (!t || !name) return -1;
+
+    DP_Column *cols = realloc(t->columns, (t->column_count + 1) * sizeof(DP_Column));
+    if (!cols) return -1;
+    t->columns = cols;
+
+    DP_Column *col = &cols[t->column_count];
+    memset(col, 0, sizeof(*col));
+    col->type = type;
+    col->name = strdup(name);
+    if (!col->name) return -1;
+
+    if (type == DATA_TYPE_STRING) {
+        col->dict = calloc(1, sizeof(DP_Dictionary));
+        if (!col->dict) {
+            free(col->name);
+            return -1;
+        }
+    }
+
+    // Existing rows of a new column read as zero / false / ""
+    if (t->capacity && column_resize(col, 0, t->capacity) != 0) {
+        free(col->name);
+        dict_free(col->dict);
+        return -1;
+    }
+    if (t->row_count) {
+        switch (type) {
+            case DATA_TYPE_INT:    memset(col->data.ints, 0, t->row_count * sizeof(int64_t)); break;
+            case DATA_TYPE_FLOAT:  memset(col->data.floats, 0, t->row_count * sizeof(double)); break;
+            case DATA_TYPE_DATE:   memset(col->data.dates, 0, t->row_count * sizeof(int32_t)); break;
+            case DATA_TYPE_BOOL:   break;
+            case DATA_TYPE_STRING: {
+                uint32_t empty = dict_intern(col->dict, "", 0);
+                for (size_t r = 0; r < t->row_count; r++) col->data.codes[r] = empty;
+                break;
+            }
+        }
+    }
+
+    t->column_count++;
+    return (int)t->column_count - 1;
+}
+
+void dp_table_free(DP_Table *t) {
+    if (!t) return;
+    for (size_t c = 0; c < t->column_count; c++) {
+        DP_Column *col = &t->columns[c];
+        free(col->name);
+        free(col->data.ints);   // Every member aliases the same allocation
+        dict_free(col->dict);
+    }
+    free(t->columns);
+    free(t->name);
+    free(t);
+}
+
+DP_Column *dp_table_column(const DP_Table *t, const char *name) {
+    if (!t || !name) return NULL;
+    for (size_t c = 0; c < t->column_count; c++) {
+        if (strcmp(t->columns[c].name, name) == 0) return &t->columns[c];
+    }
+    return NULL;
+}
+
+// ---------- Parsing ----------
+
+static int is_digit(char c) {
+    return (unsigned char)(c - '0') <= 9;
+}
+
+int dp_parse_int(const char *text, size_t len, int64_t *out) {
+    size_t i = 0;
+    int negative = 0;
+    if (i < len && (text[i] == '-' || text[i] == '+')) negative = text[i++] == '-';
+    if (i == len) return -1;
+
+    uint64_t v = 0;
+    for (; i < len; i++) {
+        unsigned d = (unsigned char)text[i] - '0';
+        if (d > 9) return -1;
+        if (v > (UINT64_MAX - d) / 10) return -1;
+        v = v * 10 + d;
+    }
+
+    if (negative ? v > (uint64_t)INT64_MAX + 1 : v > (uint64_t)INT64_MAX) return -1;
+    *out = negative ? (int64_t)(0 - v) : (int64_t)v;
+    return 0;
+}
+
+// Exact binary representations of 10^0 .. 10^22
+static const double exact_pow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static locale_t c_locale;
+static pthread_once_t c_locale_once = PTHREAD_ONCE_INIT;
+
+static void c_locale_init(void) {
+    c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+// Correctly rounded fallback for values the fast path cannot take
+static int parse_float_slow(const char *text, size_t len, double *out) {
+    char buf[128];
+    if (len >= sizeof(buf)) return -1;
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+
+    pthread_once(&c_locale_once, c_locale_init);
+    if (!c_locale) return -1;
+
+    errno = 0;
+    double v = strtod_l(buf, NULL, c_locale);
+    if (errno == ERANGE && (v > 1.0 || v < -1.0)) return -1;
+    *out = v;
+    return 0;
+}
+
+// [sign] digits [. digits] [e [sign] digits], at least one mantissa digit.
+// Always uses '.' as the decimal point, whatever the process locale.
+// Up to 19 significant digits with a power-of-ten scale of at most 22
+// are converted exactly with one multiply or divide; anything else goes
+// through strtod_l in the C locale.
+int dp_parse_float(const char *text, size_t len, double *out) {
+    size_t i = 0;
+    int negative = 0;
+    if (i < len && (text[i] == '-' || text[i] == '+')) negative = text[i++] == '-';
+
+    uint64_t mantissa = 0;
+    int significant = 0, exponent = 0, digits = 0, exact = 1;
+    for (; i < len && is_digit(text[i]); i++, digits++) {
+        unsigned d = (unsigned)(text[i] - '0');
+        if (significant < 19) {
+            mantissa = mantissa * 10 + d;
+            if (mantissa) significant++;
+        } else {
+            exponent++;
+            if (d) exact = 0;
+        }
+    }
+    if (i < len && text[i] == '.') {
+        for (i++; i < len && is_digit(text[i]); i++, digits++) {
+            unsigned d = (unsigned)(text[i] - '0');
+            if (significant < 19) {
+                mantissa = mantissa * 10 + d;
+                if (mantissa) significant++;
+                exponent--;
+            } else if (d) {
+                exact = 0;
+            }
+        }
+    }
+    if (digits == 0) return -1;
+
+    if (i < len && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        int exp_negative = 0, exp_digits = 0, e = 0;
+        if (i < len && (text[i] == '-' || text[i] == '+')) exp_negative = text[i++] == '-';
+        for (; i < len && is_digit(text[i]); i++, exp_digits++) {
+            if (e < 100000) e = e * 10 + (text[i] - '0');
+        }
+        if (exp_digits == 0) return -1;
+        exponent += exp_negative ? -e : e;
+    }
+    if (i != len) return -1;
+
+    if (mantissa == 0 && exact) {
+        *out = negative ? -0.0 : 0.0;
+        return 0;
+    }
+    if (!exact || mantissa > (1ULL << 53) || exponent < -22 || exponent > 22) {
+        return parse_float_slow(text, len, out);
+    }
+
+    double v = (double)mantissa;
+    v = exponent < 0 ? v / exact_pow10[-exponent] : v * exact_pow10[exponent];
+    *out = negative ? -v : v;
+    return 0;
+}
+
+// Days from 1970-01-01 to y-m-d in the proleptic Gregorian calendar
+static int32_t days_from_civil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// YYYY-MM-DD
+int dp_parse_date(const char *text, size_t len, int32_t *out) {
+    if (len != 10 || text[4] != '-' || text[7] != '-') return -1;
+    for (size_t i = 0; i < 10; i++) {
+        if (i != 4 && i != 7 && !is_digit(text[i])) return -1;
+    }
+
+    int y = (text[0] - '0') * 1000 + (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+    unsigned m = (unsigned)((text[5] - '0') * 10 + (text[6] - '0'));
+    unsigned d = (unsigned)((text[8] - '0') * 10 + (text[9] - '0'));
+
+    static const unsigned char month_days[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (m < 1 || m > 12 || d < 1 || d > month_days[m - 1]) return -1;
+    int leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (m == 2 && d == 29 && !leap) return -1;
+
+    *out = days_from_civil(y, m, d);
+    return 0;
+}
+
+// ASCII case-insensitive match of 'text' against lowercase 'word'
+static int equals_word(const char *text, size_t len, const char *word, size_t word_len) {
+    if (len != word_len) return 0;
+    for (size_t i = 0; i < len; i++) {
+        if ((text[i] | 0x20) != word[i]) return 0;
+    }
+    return 1;
+}
+
+int dp_parse_bool(const char *text, size_t len, int *out) {
+    if (equals_word(text, len, "true", 4)) { *out = 1; return 0; }
+    if (equals_word(text, len, "false", 5)) { *out = 0; return 0; }
+    return -1;
+}
+
+int dp_infer_type(const char *text, size_t len) {
+    if (len == 0) return -1;
+
+    int64_t i;
+    double f;
+    int32_t d;
+    int b;
+    if (dp_parse_bool(text, len, &b) == 0) return DATA_TYPE_BOOL;
+    if (dp_parse_int(text, len, &i) == 0) return DATA_TYPE_INT;
+    if (dp_parse_float(text, len, &f) == 0) return DATA_TYPE_FLOAT;
+    if (dp_parse_date(text, len, &d) == 0) return DATA_TYPE_DATE;
+    return DATA_TYPE_STRING;
+}
+
+int dp_merge_type(int a, int b) {
+    if (a < 0) return b;
+    if (b < 0 || a == b) return a;
+    if ((a == DATA_TYPE_INT && b == DATA_TYPE_FLOAT) ||
+        (a == DATA_TYPE_FLOAT && b == DATA_TYPE_INT)) {
+        return DATA_TYPE_FLOAT;
+    }
+    return DATA_TYPE_STRING;
+}
+
+// ---------- Rows ----------
+
+// Parse 'text' into row 'row' of 'col'; strings are interned into 'dict'.
+// Bits are set atomically so workers filling neighbouring row ranges
+// may share a word of a BOOL column.
+static int column_set_text(DP_Column *col, DP_Dictionary *dict, size_t row, const char *text, size_t len) {
+    switch (col->type) {
+        case DATA_TYPE_INT: {
+            int64_t v = 0;
+            if (dp_parse_int(text, len, &v) != 0) v = 0;
+            col->data.ints[row] = v;
+            return 0;
+        }
+        case DATA_TYPE_FLOAT: {
+            double v = 0.0;
+            if (dp_parse_float(text, len, &v) != 0) v = 0.0;
+            col->data.floats[row] = v;
+            return 0;
+        }
+        case DATA_TYPE_DATE: {
+            int32_t v = 0;
+            if (dp_parse_date(text, len, &v) != 0) v = 0;
+            col->data.dates[row] = v;
+            return 0;
+        }
+        case DATA_TYPE_BOOL: {
+            int v = 0;
+            if (dp_parse_bool(text, len, &v) != 0) v = 0;
+            uint64_t bit = 1ULL << (row & 63);
+            if (v) __atomic_fetch_or(&col->data.bits[row >> 6], bit, __ATOMIC_RELAXED);
+            else __atomic_fetch_and(&col->data.bits[row >> 6], ~bit, __ATOMIC_RELAXED);
+            return 0;
+        }
+        case DATA_TYPE_STRING: {
+            uint32_t code = dict_intern(dict, text, len);
+            if (code == UINT32_MAX) return -1;
+            col->data.codes[row] = code;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Write one row of text fields into allocated row 'row'; 'dicts' (may
+// be NULL) overrides the dictionaries of STRING columns
+static int table_set_row(DP_Table *t, DP_Dictionary **dicts, size_t row,
+                         const char *const *fields, const size_t *lens, size_t nfields) {
+    for (size_t c = 0; c < t->column_count; c++) {
+        DP_Column *col = &t->columns[c];
+        const char *text = c < nfields ? fields[c] : "";
+        size_t len = c < nfields ? lens[c] : 0;
+        DP_Dictionary *dict = dicts && dicts[c] ? dicts[c] : col->dict;
+        if (column_set_text(col, dict, row, text, len) != 0) return -1;
+    }
+    return 0;
+}
+
+int dp_table_append_text(DP_Table *t, const char *const *fields, const size_t *lens, size_t nfields) {
+    if (!t) return -1;
+    if (dp_table_reserve(t, t->row_count + 1) != 0) return -1;
+    if (table_set_row(t, NULL, t->row_count, fields, lens, nfields) != 0) return -1;
+    t->row_count++;
+    return 0;
+}
+
+// ---------- Accessors ----------
+
+int64_t dp_column_int(const DP_Column *col, size_t row) {
+    return col->data.ints[row];
+}
+
+double dp_column_float(const DP_Column *col, size_t row) {
+    return col->data.floats[row];
+}
+
+int32_t dp_column_date(const DP_Column *col, size_t row) {
+    return col->data.dates[row];
+}
+
+int dp_column_bool(const DP_Column *col, size_t row) {
+    return (int)((col->data.bits[row >> 6] >> (row & 63)) & 1);
+}
+
+const char *dp_column_string(const DP_Column *col, size_t row) {
+    return col->dict->arena + col->dict->offsets[col->data.codes[row]];
+}
+
+double dp_column_number(const DP_Column *col, size_t row) {
+    switch (col->type) {
+        case DATA_TYPE_INT:   return (double)dp_column_int(col, row);
+        case DATA_TYPE_FLOAT: return dp_column_float(col, row);
+        case DATA_TYPE_DATE:  return (double)dp_column_date(col, row);
+        case DATA_TYPE_BOOL:  return (double)dp_column_bool(col, row);
+        default:              return 0.0;
+    }
+}
+
+// ---------- Introspection ----------
+
+size_t dp_table_memory(const DP_Table *t) {
+    if (!t) return 0;
+
+    size_t bytes = 0;
+    for (size_t c = 0; c < t->column_count; c++) {
+        const DP_Column *col = &t->columns[c];
+        switch (col->type) {
+            case DATA_TYPE_INT:    bytes += t->capacity * sizeof(int64_t); break;
+            case DATA_TYPE_FLOAT:  bytes += t->capacity * sizeof(double); break;
+            case DATA_TYPE_DATE:   bytes += t->capacity * sizeof(int32_t); break;
+            case DATA_TYPE_BOOL:   bytes += bit_words(t->capacity) * sizeof(uint64_t); break;
+            case DATA_TYPE_STRING:
+                bytes += t->capacity * sizeof(uint32_t);
+                bytes += col->dict->arena_capacity;
+                bytes += col->dict->capacity * (sizeof(size_t) + sizeof(uint64_t));
+                bytes += col->dict->slot_capacity * sizeof(uint32_t);
+                break;
+        }
+    }
+    return bytes;
+}
+
+const char *dp_type_name(DataType type) {
+    switch (type) {
+        case DATA_TYPE_INT:    return "int";
+        case DATA_TYPE_FLOAT:  return "float";
+        case DATA_TYPE_STRING: return "string";
+        case DATA_TYPE_DATE:   return "date";
+        case DATA_TYPE_BOOL:   return "bool";
+    }
+    return "?";
+}
+
+void dp_table_print_schema(const DP_Table *t) {
+    if (!t) return;
+    printf("%s: %zu rows, %zu bytes\n", t->name, t->row_count, dp_table_memory(t));
+    for (size_t c = 0; c < t->column_count; c++) {
+        const DP_Column *col = &t->columns[c];
+        printf("  %-20s %s", col->name, dp_type_name(col->type));
+        if (col->type == DATA_TYPE_STRING) printf(" (%zu distinct)", col->dict->count);
+        printf("\n");
+    }
+}
+
+// ---------- CSV ----------
+
+// Range predicate bound to a record field
+typedef struct {
+    size_t field;
+    double min;
+    double max;
+} CsvPredicate;
+
+// Projection and row filter applied while scanning
+typedef struct {
+    size_t *source;         // Record field feeding each table column
+    size_t ncols;
+    CsvPredicate *predicates;
+    size_t predicate_count;
+    size_t max_fields;      // Fields past this many are never split out
+} CsvPlan;
+
+// Cursor over an in-memory CSV document
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t pos;
+    char *scratch;          // Unescaped text of quoted fields
+    size_t scratch_cap;
+    size_t *starts;         // Field start in data, or in scratch if quoted
+    uint8_t *quoted;
+    const char **fields;
+    size_t *lens;
+    size_t field_cap;
+    const CsvPlan *plan;    // NULL keeps every field of every record
+    const char **row_fields;    // Current row, projected through the plan
+    size_t *row_lens;
+    const char **proj_fields;
+    size_t *proj_lens;
+} CsvReader;
+
+static void csv_reader_init(CsvReader *r, const char *data, size_t len, size_t pos, const CsvPlan *plan) {
+    memset(r, 0, sizeof(*r));
+    r->data = data;
+    r->len = len;
+    r->pos = pos;
+    r->plan = plan;
+}
+
+static void csv_reader_free(CsvReader *r) {
+    free(r->scratch);
+    free(r->starts);
+    free(r->quoted);
+    free(r->fields);
+    free(r->lens);
+    free(r->proj_fields);
+    free(r->proj_lens);
+}
+
+static int csv_push_field(CsvReader *r, size_t n, size_t start, size_t len, int quoted) {
+    if (n == r->field_cap) {
+        size_t cap = r->field_cap ? r->field_cap * 2 : 16;
+        size_t *starts = realloc(r->starts, cap * sizeof(size_t));
+        if (!starts) return -1;
+        r->starts = starts;
+        uint8_t *q = realloc(r->quoted, cap);
+        if (!q) return -1;
+        r->quoted = q;
+        const char **fields = realloc(r->fields, cap * sizeof(char *));
+        if (!fields) return -1;
+        r->fields = fields;
+        size_t *lens = realloc(r->lens, cap * sizeof(size_t));
+        if (!lens) return -1;
+        r->lens = lens;
+        r->field_cap = cap;
+    }
+    r->starts[n] = start;
+    r->lens[n] = len;
+    r->quoted[n] = (uint8_t)quoted;
+    return 0;
+}
+
+static int csv_scratch_append(CsvReader *r, size_t *used, const char *src, size_t n) {
+    if (*used + n > r->scratch_cap) {
+        size_t cap = r->scratch_cap ? r->scratch_cap : 256;
+        while (cap < *used + n) cap *= 2;
+        char *s = realloc(r->scratch, cap);
+        if (!s) return -1;
+        r->scratch = s;
+        r->scratch_cap = cap;
+    }
+    memcpy(r->scratch + *used, src, n);
+    *used += n;
+    return 0;
+}
+
+// Index of the first ',' or '\n' at or after 'pos', or 'len' if none.
+// SSE2 tests 16 bytes per step; the tail is scanned byte by byte so the
+// loop never reads past the end of the mapping.
+static size_t csv_scan_delimiter(const char *data, size_t pos, size_t len) {
+#if defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; pos + 16 <= len; pos += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + pos));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, newline));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask) return pos + (size_t)__builtin_ctz((unsigned)mask);
+    }
+#endif
+    while (pos < len && data[pos] != ',' && data[pos] != '\n') pos++;
+    return pos;
+}
+
+// Jump past the rest of the current record without splitting it, unless
+// it holds quotes (a quoted newline would end the jump early); 1 if done
+static int csv_skip_rest(CsvReader *r) {
+    const char *p = r->data + r->pos;
+    size_t left = r->len - r->pos;
+    const char *newline = memchr(p, '\n', left);
+    size_t span = newline ? (size_t)(newline - p) : left;
+    if (memchr(p, '"', span)) return 0;
+    r->pos += newline ? span + 1 : span;
+    return 1;
+}
+
+// Split the next record into r->fields / r->lens; returns the field
+// count, 0 at end of input, or -1 when out of memory. Quoted fields
+// follow RFC 4180: they may hold commas, newlines and "" escapes, and
+// their unescaped text lives in scratch space that stays valid until
+// the next call.
+static long csv_next_record(CsvReader *r) {
+    if (r->pos >= r->len) return 0;
+
+    size_t n = 0, used = 0;
+    for (;;) {
+        if (r->pos < r->len && r->data[r->pos] == '"') {
+            r->pos++;
+            size_t start = used;
+            while (r->pos < r->len) {
+                const char *quote = memchr(r->data + r->pos, '"', r->len - r->pos);
+                size_t end = quote ? (size_t)(quote - r->data) : r->len;
+                if (csv_scratch_append(r, &used, r->data + r->pos, end - r->pos) != 0) return -1;
+                r->pos = end + 1;
+                if (!quote) break;
+                if (r->pos < r->len && r->data[r->pos] == '"') {
+                    if (csv_scratch_append(r, &used, "\"", 1) != 0) return -1;
+                    r->pos++;
+                } else {
+                    break;
+                }
+            }
+            if (r->pos > r->len) r->pos = r->len;
+            // Stray text between the closing quote and the delimiter is dropped
+            r->pos = csv_scan_delimiter(r->data, r->pos, r->len);
+            if (csv_push_field(r, n++, start, used - start, 1) != 0) return -1;
+        } else {
+            size_t start = r->pos;
+            r->pos = csv_scan_delimiter(r->data, r->pos, r->len);
+            size_t len = r->pos - start;
+            if (len && r->data[start + len - 1] == '\r' &&
+                (r->pos >= r->len || r->data[r->pos] == '\n')) len--;
+            if (csv_push_field(r, n++, start, len, 0) != 0) return -1;
+        }
+
+        if (r->pos >= r->len) break;
+        if (r->data[r->pos++] == '\n') break;
+        if (r->plan && n == r->plan->max_fields && csv_skip_rest(r)) break;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        r->fields[i] = (r->quoted[i] ? r->scratch : r->data) + r->starts[i];
+    }
+    return (long)n;
+}
+
+static int is_blank_record(const CsvReader *r, long n) {
+    return n == 1 && r->lens[0] == 0;
+}
+
+// Only fields named by a predicate are parsed here; a field that is not
+// a number fails its predicate
+static int csv_row_passes(const CsvReader *r, const CsvPlan *plan, size_t n) {
+    for (size_t i = 0; i < plan->predicate_count; i++) {
+        const CsvPredicate *p = &plan->predicates[i];
+        double v;
+        if (p->field >= n || dp_parse_float(r->fields[p->field], r->lens[p->field], &v) != 0) return 0;
+        if (v < p->min || v > p->max) return 0;
+    }
+    return 1;
+}
+
+// Next non-blank record starting before 'end' that passes the plan's
+// predicates, projected into r->row_fields / r->row_lens; returns its
+// field count, 0 when there is none, or -1 when out of memory
+static long csv_next_row(CsvReader *r, size_t end) {
+    const CsvPlan *plan = r->plan;
+    while (r->pos < end) {
+        long n = csv_next_record(r);
+        if (n <= 0) return n;
+        if (is_blank_record(r, n)) continue;
+        if (!plan) {
+            r->row_fields = r->fields;
+            r->row_lens = r->lens;
+            return n;
+        }
+        if (!csv_row_passes(r, plan, (size_t)n)) continue;
+
+        if (!r->proj_fields) {
+            r->proj_fields = malloc(plan->ncols * sizeof(char *));
+            r->proj_lens = malloc(plan->ncols * sizeof(size_t));
+            if (!r->proj_fields || !r->proj_lens) return -1;
+        }
+        for (size_t c = 0; c < plan->ncols; c++) {
+            size_t f = plan->source[c];
+            r->proj_fields[c] = f < (size_t)n ? r->fields[f] : "";
+            r->proj_lens[c] = f < (size_t)n ? r->lens[f] : 0;
+        }
+        r->row_fields = r->proj_fields;
+        r->row_lens = r->proj_lens;
+        return (long)plan->ncols;
+    }
+    return 0;
+}
+
+// Read-only view of a whole file: mapped when possible, read into the
+// heap otherwise (pipes, files mmap refuses). For a compressed file it
+// holds only the blocks decoded to read the header and, for a value
+// load, its first row; the body goes through csv_load_windows.
+typedef struct {
+    const char *data;
+    size_t len;
+    int mapped;
+    size_t capacity;        // Heap bytes, while decoding
+    DP_Decoder *z;          // Compressed file still being decoded
+} CsvBuffer;
+
+static int csv_buffer_read(CsvBuffer *b, int fd) {
+    size_t cap = 1 << 16, len = 0;
+    char *data = malloc(cap);
+    while (data) {
+        if (len == cap) {
+            char *grown = realloc(data, cap * 2);
+            if (!grown) break;
+            data = grown;
+            cap *= 2;
+        }
+        ssize_t got = read(fd, data + len, cap - len);
+        if (got < 0) break;
+        if (got == 0) {
+            b->data = data;
+            b->len = len;
+            b->mapped = 0;
+            return 0;
+        }
+        len += (size_t)got;
+    }
+    free(data);
+    return -1;
+}
+
+// Next decoded block appended to the buffer: 1 when one was, 0 at the
+// end of the data, -1 on error
+static int csv_buffer_pull(CsvBuffer *b) {
+    const char *block;
+    ssize_t got = dp_decoder_next(b->z, &block);
+    if (got <= 0) return (int)got;
+
+    if (b->capacity - b->len < (size_t)got) {
+        size_t cap = b->capacity * 2;
+        while (cap - b->len < (size_t)got) cap *= 2;
+        char *grown = realloc((char *)b->data, cap);
+        if (!grown) return -1;
+        b->data = grown;
+        b->capacity = cap;
+    }
+    memcpy((char *)b->data + b->len, block, (size_t)got);
+    b->len += (size_t)got;
+    return 1;
+}
+
+// Start decoding a compressed file; only the header record is waited for
+static int csv_buffer_decode(CsvBuffer *b, const char *filename) {
+    b->z = dp_decoder_open(filename);
+    b->capacity = DP_DECODE_BLOCK_SIZE;
+    b->data = b->z ? malloc(b->capacity) : NULL;
+    if (!b->data) return -1;
+
+    int pulled;
+    while (dp_csv_complete(b->data, b->len) == 0 && (pulled = csv_buffer_pull(b)) != 0) {
+        if (pulled < 0) return -1;
+    }
+    return 0;
+}
+
+static int csv_buffer_open(CsvBuffer *b, const char *filename) {
+    memset(b, 0, sizeof(*b));
+    if (dp_compression_of(filename) != DP_COMPRESSION_NONE) {
+        if (csv_buffer_decode(b, filename) == 0) return 0;
+        dp_decoder_close(b->z);
+        free((void *)b->data);
+        return -1;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    int rc = -1;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            b->data = map;
+            b->len = (size_t)st.st_size;
+            b->mapped = 1;
+            rc = 0;
+        }
+    }
+    if (rc != 0) rc = csv_buffer_read(b, fd);
+    close(fd);
+    return rc;
+}
+
+static void csv_buffer_close(CsvBuffer *b) {
+    dp_decoder_close(b->z);
+    if (b->mapped) munmap((void *)b->data, b->len);
+    else free((void *)b->data);
+}
+
+// True when 'text' parses as 'type', so it cannot widen a column that
+// already has that type
+static int csv_fits_type(int type, const char *text, size_t len) {
+    int64_t i;
+    double f;
+    int32_t d;
+    int b;
+    switch (type) {
+        case DATA_TYPE_INT: return dp_parse_int(text, len, &i) == 0;
+        case DATA_TYPE_FLOAT: return dp_parse_float(text, len, &f) == 0;
+        case DATA_TYPE_DATE: return dp_parse_date(text, len, &d) == 0;
+        case DATA_TYPE_BOOL: return dp_parse_bool(text, len, &b) == 0;
+        default: return 0;
+    }
+}
+
+// Pass 1: infer every column's type from the records that start before
+// 'end' and count them; -1 when out of memory
+static int csv_infer_types(CsvReader *r, int *types, size_t ncols, size_t end, size_t *rows) {
+    long n;
+    *rows = 0;
+    while ((n = csv_next_row(r, end)) > 0) {
+        for (size_t c = 0; c < ncols && c < (size_t)n; c++) {
+            const char *text = r->row_fields[c];
+            size_t len = r->row_lens[c];
+            if (types[c] == DATA_TYPE_STRING || len == 0) continue;
+            if (csv_fits_type(types[c], text, len)) continue;
+            types[c] = dp_merge_type(types[c], dp_infer_type(text, len));
+        }
+        (*rows)++;
+    }
+    return n < 0 ? -1 : 0;
+}
+
+// Pass 2: parse the records that start before 'end' straight into the
+// typed columns, rows [row, row + rows). Fails if they are not the
+// 'rows' records pass 1 counted (the file changed in between).
+static int csv_fill_rows(CsvReader *r, DP_Table *t, DP_Dictionary **dicts, size_t row, size_t rows, size_t end) {
+    size_t stop = row + rows;
+    long n;
+    while ((n = csv_next_row(r, end)) > 0) {
+        if (row == stop || table_set_row(t, dicts, row++, r->row_fields, r->row_lens, (size_t)n) != 0) return -1;
+    }
+    return n < 0 || row != stop ? -1 : 0;
+}
+
+// Create one column per header field with its inferred type
+static DP_Table *csv_create_table(const char *filename, char **names, const int *types, size_t ncols) {
+    DP_Table *t = dp_table_new(filename);
+    for (size_t c = 0; t && c < ncols; c++) {
+        DataType type = types[c] < 0 ? DATA_TYPE_STRING : (DataType)types[c];
+        if (!names[c] || dp_table_add_column(t, names[c], type) < 0) {
+            dp_table_free(t);
+            t = NULL;
+        }
+    }
+    return t;
+}
+
+// ---------- Parallel CSV ----------
+
+// Input bytes per worker below which another worker is not worth it
+#define CSV_MIN_CHUNK_BYTES (1 << 20)
+
+// One worker's share of the body: the records starting in [begin, end)
+typedef struct {
+    size_t begin;
+    size_t end;
+    size_t stop;            // Where the reader finished; == end for a clean split
+    size_t quotes;          // '"' bytes in the chunk's nominal range
+    size_t rows;
+    size_t first_row;
+    int *types;
+    DP_Dictionary **dicts;  // Chunk-local dictionaries, STRING columns only
+    uint32_t **remap;       // Local code -> table code, per STRING column
+    int failed;
+} CsvChunk;
+
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t ncols;
+    const CsvPlan *plan;
+    CsvChunk *chunks;
+    size_t count;
+    DP_Table *t;
+} CsvJob;
+
+static void csv_chunks_free(CsvJob *job) {
+    for (size_t k = 0; k < job->count; k++) {
+        CsvChunk *ch = &job->chunks[k];
+        for (size_t c = 0; c < job->ncols; c++) {
+            if (ch->dicts) dict_free(ch->dicts[c]);
+            if (ch->remap) free(ch->remap[c]);
+        }
+        free(ch->types);
+        free(ch->dicts);
+        free(ch->remap);
+    }
+    free(job->chunks);
+    job->chunks = NULL;
+    job->count = 0;
+}
+
+static void csv_count_quotes_task(void *ctx, size_t task) {
+    CsvJob *job = ctx;
+    CsvChunk *ch = &job->chunks[task];
+    const char *p = job->data + ch->begin, *end = job->data + ch->end;
+    size_t quotes = 0;
+    while ((p = memchr(p, '"', (size_t)(end - p))) != NULL) {
+        quotes++;
+        p++;
+    }
+    ch->quotes = quotes;
+}
+
+// Cut the body [body, len) into 'count' chunks that start on record
+// boundaries. Chunks first get equal nominal ranges; the quote parity
+// of everything before a nominal start says whether it falls inside a
+// quoted field, and the start then moves just past the first newline
+// outside quotes.
+static int csv_split(CsvJob *job, size_t body, size_t count) {
+    job->chunks = calloc(count, sizeof(CsvChunk));
+    if (!job->chunks) return -1;
+    job->count = count;
+
+    size_t span = (job->len - body) / count;
+    for (size_t k = 0; k < count; k++) {
+        job->chunks[k].begin = body + k * span;
+        job->chunks[k].end = k + 1 == count ? job->len : body + (k + 1) * span;
+    }
+    parallel_run(count, csv_count_quotes_task, job);
+
+    size_t quotes = job->chunks[0].quotes;
+    for (size_t k = 1; k < count; k++) {
+        CsvChunk *ch = &job->chunks[k];
+        int in_quotes = quotes & 1;
+        quotes += ch->quotes;
+
+        size_t pos = ch->begin;
+        while (pos < job->len) {
+            char c = job->data[pos++];
+            if (c == '"') in_quotes = !in_quotes;
+            else if (c == '\n' && !in_quotes) break;
+        }
+        ch->begin = pos > job->chunks[k - 1].begin ? pos : job->chunks[k - 1].begin;
+        job->chunks[k - 1].end = ch->begin;
+    }
+    return 0;
+}
+
+static void csv_infer_task(void *ctx, size_t task) {
+    CsvJob *job = ctx;
+    CsvChunk *ch = &job->chunks[task];
+    ch->types = malloc((job->ncols ? job->ncols : 1) * sizeof(int));
+    if (!ch->types) {
+        ch->failed = 1;
+        return;
+    }
+    for (size_t c = 0; c < job->ncols; c++) ch->types[c] = -1;
+
+    CsvReader r;
+    csv_reader_init(&r, job->data, job->len, ch->begin, job->plan);
+    ch->failed = csv_infer_types(&r, ch->types, job->ncols, ch->end, &ch->rows) != 0;
+    ch->stop = r.pos;
+    csv_reader_free(&r);
+}
+
+static void csv_fill_task(void *ctx, size_t task) {
+    CsvJob *job = ctx;
+    CsvChunk *ch = &job->chunks[task];
+
+    CsvReader r;
+    csv_reader_init(&r, job->data, job->len, ch->begin, job->plan);
+    ch->failed = csv_fill_rows(&r, job->t, ch->dicts, ch->first_row, ch->rows, ch->end) != 0;
+    csv_reader_free(&r);
+}
+
+static void csv_remap_task(void *ctx, size_t task) {
+    CsvJob *job = ctx;
+    CsvChunk *ch = &job->chunks[task];
+    for (size_t c = 0; ch->remap && c < job->ncols; c++) {
+        const uint32_t *map = ch->remap[c];
+        if (!map) continue;
+        uint32_t *codes = job->t->columns[c].data.codes + ch->first_row;
+        for (size_t i = 0; i < ch->rows; i++) codes[i] = map[codes[i]];
+    }
+}
+
+// Give every chunk but the first private dictionaries for the STRING
+// columns; chunk 0 interns straight into the table's
+static int csv_chunk_dicts(CsvJob *job) {
+    for (size_t k = 1; k < job->count; k++) {
+        CsvChunk *ch = &job->chunks[k];
+        ch->dicts = calloc(job->ncols, sizeof(DP_Dictionary *));
+        ch->remap = calloc(job->ncols, sizeof(uint32_t *));
+        if (!ch->dicts || !ch->remap) return -1;
+        for (size_t c = 0; c < job->ncols; c++) {
+            if (job->t->columns[c].type != DATA_TYPE_STRING) continue;
+            ch->dicts[c] = calloc(1, sizeof(DP_Dictionary));
+            if (!ch->dicts[c]) return -1;
+        }
+    }
+    return 0;
+}
+
+// Intern the chunk dictionaries into the table's in chunk order, which
+// hands out codes in order of first appearance exactly as a serial load
+// does, and record each chunk's local -> table code map
+static int csv_merge_dicts(CsvJob *job) {
+    for (size_t k = 1; k < job->count; k++) {
+        CsvChunk *ch = &job->chunks[k];
+        for (size_t c = 0; c < job->ncols; c++) {
+            const DP_Dictionary *local = ch->dicts[c];
+            if (!local) continue;
+            ch->remap[c] = malloc((local->count ? local->count : 1) * sizeof(uint32_t));
+            if (!ch->remap[c]) return -1;
+            for (size_t code = 0; code < local->count; code++) {
+                size_t next = code + 1 < local->count ? local->offsets[code + 1] : local->arena_used;
+                size_t len = next - local->offsets[code] - 1;
+                uint32_t global = dict_intern(job->t->columns[c].dict, local->arena + local->offsets[code], len);
+                if (global == UINT32_MAX) return -1;
+                ch->remap[c][code] = global;
+            }
+        }
+    }
+    return 0;
+}
+
+static int csv_any_failed(const CsvJob *job) {
+    for (size_t k = 0; k < job->count; k++) {
+        if (job->chunks[k].failed) return 1;
+    }
+    return 0;
+}
+
+// Pass 1 over every chunk. Fails with 1 (rather than -1 for out of
+// memory), leaving 'types' alone, when some chunk's last record ran past
+// the chunk's end: the quote-parity split only guesses right for
+// well-formed quoting.
+static int csv_infer_chunks(CsvJob *job, int *types, size_t *rows) {
+    parallel_run(job->count, csv_infer_task, job);
+    if (csv_any_failed(job)) return -1;
+
+    for (size_t k = 0; k < job->count; k++) {
+        if (job->chunks[k].stop != job->chunks[k].end) return 1;
+    }
+    *rows = 0;
+    for (size_t k = 0; k < job->count; k++) {
+        CsvChunk *ch = &job->chunks[k];
+        ch->first_row = *rows;
+        *rows += ch->rows;
+        for (size_t c = 0; c < job->ncols; c++) types[c] = dp_merge_type(types[c], ch->types[c]);
+    }
+    return 0;
+}
+
+// Pass 2: every chunk parses into its own row range of the shared
+// columns, then chunk-local string codes are rewritten to table codes
+static int csv_fill_chunks(CsvJob *job) {
+    if (csv_chunk_dicts(job) != 0) return -1;
+
+    parallel_run(job->count, csv_fill_task, job);
+    if (csv_any_failed(job) || csv_merge_dicts(job) != 0) return -1;
+    parallel_run(job->count, csv_remap_task, job);
+    return 0;
+}
+
+// ---------- Compressed CSV ----------
+
+// A compressed body is never held whole. It is decoded twice, a window
+// of whole records at a time: pass 1 infers each window's chunks on the
+// workers, pass 2 decodes the file again and fills the same windows cut
+// at the same bytes. Only the unfinished record at a window's end is
+// carried into the next.
+typedef struct {
+    DP_Decoder *z;
+    char *data;
+    size_t len;
+    size_t capacity;
+    size_t cut;             // Length of the current window
+    size_t skip;            // Header bytes still to drop
+    int done;               // Decoder reached the end of the data
+} CsvWindow;
+
+// What pass 1 saw, per window: its length, its chunk count, then each
+// chunk's row count
+typedef struct {
+    size_t *items;
+    size_t count;
+    size_t capacity;
+} CsvWindowLog;
+
+static int csv_window_open(CsvWindow *w, const char *filename, size_t header) {
+    memset(w, 0, sizeof(*w));
+    w->z = dp_decoder_open(filename);
+    w->skip = header;
+    return w->z ? 0 : -1;
+}
+
+static void csv_window_close(CsvWindow *w) {
+    dp_decoder_close(w->z);
+    free(w->data);
+    memset(w, 0, sizeof(*w));
+}
+
+// Append decoded blocks until the window holds 'want' bytes or the data ends
+static int csv_window_fill(CsvWindow *w, size_t want) {
+    while (!w->done && w->len < want) {
+        const char *block;
+        ssize_t got = dp_decoder_next(w->z, &block);
+        if (got < 0) return -1;
+        if (got == 0) {
+            w->done = 1;
+            break;
+        }
+
+        size_t drop = w->skip < (size_t)got ? w->skip : (size_t)got;
+        size_t size = (size_t)got - drop;
+        w->skip -= drop;
+        if (size == 0) continue;
+        if (w->capacity - w->len < size) {
+            size_t cap = w->capacity ? w->capacity : DP_DECODE_BLOCK_SIZE;
+            while (cap - w->len < size) cap *= 2;
+            char *grown = realloc(w->data, cap);
+            if (!grown) return -1;
+            w->data = grown;
+            w->capacity = cap;
+        }
+        memcpy(w->data + w->len, block + drop, size);
+        w->len += size;
+    }
+    return 0;
+}
+
+// Move to the next window. With *len set it is that many bytes (pass 2);
+// otherwise about 'want' bytes up to the last complete record, the end
+// of the data closing the final one. *len is 0 once the data is used up.
+static int csv_window_next(CsvWindow *w, size_t want, size_t *len) {
+    if (w->cut) memmove(w->data, w->data + w->cut, w->len - w->cut);
+    w->len -= w->cut;
+    w->cut = 0;
+
+    if (*len) {
+        if (csv_window_fill(w, *len) != 0 || w->len < *len) return -1;
+        w->cut = *len;
+        return 0;
+    }
+    for (;;) {
+        if (csv_window_fill(w, want) != 0) return -1;
+        w->cut = w->done ? w->len : dp_csv_complete(w->data, w->len);
+        if (w->cut || w->done) break;
+        want = w->len + DP_DECODE_BLOCK_SIZE;   // One record longer than the window
+    }
+    *len = w->cut;
+    return 0;
+}
+
+static int csv_log_push(CsvWindowLog *log, size_t value) {
+    if (log->count == log->capacity) {
+        size_t cap = log->capacity ? log->capacity * 2 : 64;
+        size_t *grown = realloc(log->items, cap * sizeof(size_t));
+        if (!grown) return -1;
+        log->items = grown;
+        log->capacity = cap;
+    }
+    log->items[log->count++] = value;
+    return 0;
+}
+
+// Pass 1 over one window, split across the workers where it is big
+// enough; logs the window for pass 2
+static int csv_infer_window(CsvJob *job, int *types, size_t *rows, CsvWindowLog *log) {
+    size_t tasks = parallel_plan(job->len, CSV_MIN_CHUNK_BYTES);
+    int rc = csv_split(job, 0, tasks) == 0 ? csv_infer_chunks(job, types, rows) : -1;
+    if (rc == 1) {
+        csv_chunks_free(job);
+        rc = csv_split(job, 0, 1) == 0 ? csv_infer_chunks(job, types, rows) : -1;
+    }
+    if (rc == 0) rc = csv_log_push(log, job->len) == 0 && csv_log_push(log, job->count) == 0 ? 0 : -1;
+    for (size_t k = 0; rc == 0 && k < job->count; k++) rc = csv_log_push(log, job->chunks[k].rows);
+    csv_chunks_free(job);
+    return rc;
+}
+
+// Both passes over a compressed file whose header takes 'header' decoded bytes
+static DP_Table *csv_load_windows(const char *filename, size_t header, const CsvPlan *plan,
+                                  char **names, int *types, size_t ncols) {
+    size_t want = parallel_threads() * CSV_MIN_CHUNK_BYTES;
+    CsvWindowLog log = { 0 };
+    size_t rows = 0;
+    CsvWindow w;
+
+    int rc = csv_window_open(&w, filename, header);
+    while (rc == 0) {
+        size_t len = 0, found;
+        if ((rc = csv_window_next(&w, want, &len)) != 0 || len == 0) break;
+        CsvJob job = { w.data, len, ncols, plan, NULL, 0, NULL };
+        rc = csv_infer_window(&job, types, &found, &log);
+        rows += found;
+    }
+    csv_window_close(&w);
+
+    DP_Table *t = rc == 0 ? csv_create_table(filename, names, types, ncols) : NULL;
+    if (!t) {
+        free(log.items);
+        return NULL;
+    }
+
+    rc = csv_window_open(&w, filename, header);
+    if (rc == 0) rc = dp_table_reserve(t, rows);
+    size_t at = 0, row = 0;
+    while (rc == 0 && at < log.count) {
+        size_t len = log.items[at++], count = log.items[at++];
+        rc = csv_window_next(&w, want, &len);
+        CsvJob job = { w.data, len, ncols, plan, NULL, 0, t };
+        if (rc == 0) rc = csv_split(&job, 0, count);
+        for (size_t k = 0; rc == 0 && k < job.count; k++) {
+            job.chunks[k].rows = log.items[at++];
+            job.chunks[k].first_row = row;
+            row += job.chunks[k].rows;
+        }
+        if (rc == 0) rc = csv_fill_chunks(&job);
+        csv_chunks_free(&job);
+    }
+    csv_window_close(&w);
+    free(log.items);
+
+    if (rc != 0) {
+        fprintf(stderr, "CSV error: failed to load '%s'.\n", filename);
+        dp_table_free(t);
+        return NULL;
+    }
+    t->row_count = rows;
+    return t;
+}
+
+// Header index of 'name', or -1
+static long csv_header_index(const CsvReader *header, long nfields, const char *name) {
+    size_t len = strlen(name);
+    for (long i = 0; i < nfields; i++) {
+        if (header->lens[i] == len && memcmp(header->fields[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+// Resolve the options' column names against the header; NULL options
+// keep every column and row
+static int csv_build_plan(CsvPlan *plan, const CsvReader *header, long nfields,
+                          const DP_LoadOptions *opts, const char *filename) {
+    memset(plan, 0, sizeof(*plan));
+    size_t ncols = opts && opts->column_count ? opts->column_count : (size_t)nfields;
+    size_t npreds = opts ? opts->predicate_count : 0;
+    plan->source = malloc((ncols ? ncols : 1) * sizeof(size_t));
+    plan->predicates = malloc((npreds ? npreds : 1) * sizeof(CsvPredicate));
+    if (!plan->source || !plan->predicates) return -1;
+    plan->ncols = ncols;
+    plan->predicate_count = npreds;
+
+    for (size_t c = 0; c < ncols; c++) {
+        long f = (long)c;
+        if (opts && opts->column_count) f = csv_header_index(header, nfields, opts->columns[c]);
+        if (f < 0) {
+            fprintf(stderr, "CSV error: no column '%s' in '%s'.\n", opts->columns[c], filename);
+            return -1;
+        }
+        plan->source[c] = (size_t)f;
+        if ((size_t)f + 1 > plan->max_fields) plan->max_fields = (size_t)f + 1;
+    }
+    for (size_t i = 0; i < npreds; i++) {
+        const DP_RangePredicate *p = &opts->predicates[i];
+        long f = csv_header_index(header, nfields, p->column);
+        if (f < 0) {
+            fprintf(stderr, "CSV error: no column '%s' in '%s'.\n", p->column, filename);
+            return -1;
+        }
+        plan->predicates[i].field = (size_t)f;
+        plan->predicates[i].min = p->min;
+        plan->predicates[i].max = p->max;
+        if ((size_t)f + 1 > plan->max_fields) plan->max_fields = (size_t)f + 1;
+    }
+    return 0;
+}
+
+static void csv_plan_free(CsvPlan *plan) {
+    free(plan->source);
+    free(plan->predicates);
+}
+
+// Field of the first row at or after 'body' that passes the plan, as
+// dp_csv_value_field picks it (0 if there is no such row); -1 on error.
+// A compressed file is decoded only until that row turns up.
+static long csv_value_field(CsvBuffer *b, size_t body, const CsvPlan *plan) {
+    size_t pos = body;
+    int more = b->z != NULL;
+    for (;;) {
+        size_t end = more ? pos + dp_csv_complete(b->data + pos, b->len - pos) : b->len;
+        CsvReader r;
+        csv_reader_init(&r, b->data, b->len, pos, plan);
+        long n = csv_next_row(&r, end);
+        long field = n > 0 ? (long)dp_csv_value_field(r.row_fields, r.row_lens, (size_t)n) : n;
+        pos = r.pos;
+        csv_reader_free(&r);
+        if (n != 0 || !more) return field;
+
+        int pulled = csv_buffer_pull(b);
+        if (pulled < 0) return -1;
+        more = pulled > 0;
+    }
+}
+
+// Keep only the plan's first column, or with no columns named the field
+// csv_value_field picks
+static int csv_plan_value(CsvPlan *plan, CsvBuffer *b, size_t body, const DP_LoadOptions *opts) {
+    if (!opts || !opts->column_count) {
+        long field = csv_value_field(b, body, plan);
+        if (field < 0) return -1;
+        plan->source[0] = (size_t)field;
+    }
+    plan->ncols = 1;
+    plan->max_fields = plan->source[0] + 1;
+    for (size_t i = 0; i < plan->predicate_count; i++) {
+        if (plan->predicates[i].field + 1 > plan->max_fields) plan->max_fields = plan->predicates[i].field + 1;
+    }
+    return 0;
+}
+
+DP_Table *dp_table_load_csv(const char *filename) {
+    return dp_table_load_csv_opts(filename, NULL);
+}
+
+// Both passes over a body held whole in 'b'
+static DP_Table *csv_load_chunks(const char *filename, const CsvBuffer *b, size_t body, const CsvPlan *plan,
+                                 char **names, int *types, size_t ncols) {
+    CsvJob job = { b->data, b->len, ncols, plan, NULL, 0, NULL };
+    size_t rows;
+    size_t tasks = parallel_plan(b->len - body, CSV_MIN_CHUNK_BYTES);
+    int rc = csv_split(&job, body, tasks) == 0 ? csv_infer_chunks(&job, types, &rows) : -1;
+    if (rc == 1) {
+        // Quoting the split could not follow; load on one thread
+        csv_chunks_free(&job);
+        rc = csv_split(&job, body, 1) == 0 ? csv_infer_chunks(&job, types, &rows) : -1;
+    }
+
+    DP_Table *t = rc == 0 ? csv_create_table(filename, names, types, ncols) : NULL;
+    job.t = t;
+    if (t && (dp_table_reserve(t, rows) != 0 || csv_fill_chunks(&job) != 0)) {
+        fprintf(stderr, "CSV error: failed to load '%s'.\n", filename);
+        dp_table_free(t);
+        t = NULL;
+    }
+    if (t) t->row_count = rows;
+    csv_chunks_free(&job);
+    return t;
+}
+
+static DP_Table *csv_load(const char *filename, const DP_LoadOptions *opts, int value_only) {
+    CsvBuffer buf;
+    if (csv_buffer_open(&buf, filename) != 0) return NULL;
+
+    CsvReader r;
+    csv_reader_init(&r, buf.data, buf.len, 0, NULL);
+
+    DP_Table *t = NULL;
+    CsvPlan plan;
+    long n = csv_next_record(&r);   // Header row
+    int planned = n > 0 && csv_build_plan(&plan, &r, n, opts, filename) == 0 &&
+                  (!value_only || csv_plan_value(&plan, &buf, r.pos, opts) == 0);
+    if (planned && buf.z) {
+        // The value probe may have decoded more and moved the buffer
+        csv_reader_free(&r);
+        csv_reader_init(&r, buf.data, buf.len, 0, NULL);
+        csv_next_record(&r);
+    }
+    size_t ncols = planned ? plan.ncols : 0;
+    char **names = ncols ? calloc(ncols, sizeof(char *)) : NULL;
+    int *types = ncols ? malloc(ncols * sizeof(int)) : NULL;
+
+    if (names && types) {
+        for (size_t c = 0; c < ncols; c++) {
+            names[c] = strndup(r.fields[plan.source[c]], r.lens[plan.source[c]]);
+            types[c] = -1;
+        }
+
+        if (buf.z) {
+            // Only the header came from this decoder; the body is decoded afresh
+            dp_decoder_close(buf.z);
+            buf.z = NULL;
+            t = csv_load_windows(filename, r.pos, &plan, names, types, ncols);
+        } else {
+            t = csv_load_chunks(filename, &buf, r.pos, &plan, names, types, ncols);
+        }
+    }
+
+    for (size_t c = 0; names && c < ncols; c++) free(names[c]);
+    free(names);
+    free(types);
+    if (n > 0) csv_plan_free(&plan);
+    csv_reader_free(&r);
+    csv_buffer_close(&buf);
+    return t;
+}
+
+DP_Table *dp_table_load_csv_opts(const char *filename, const DP_LoadOptions *opts) {
+    return csv_load(filename, opts, 0);
+}
+
+DP_Table *dp_table_load_csv_value(const char *filename, const DP_LoadOptions *opts) {
+    return csv_load(filename, opts, 1);
+}
+
+size_t dp_csv_value_field(const char *const *fields, const size_t *lens, size_t nfields) {
+    double value;
+    for (size_t f = 0; f < nfields; f++) {
+        if (dp_parse_float(fields[f], lens[f], &value) == 0) return f;
+    }
+    return 0;
+}
+
+// ---------- Incremental CSV ----------
+
+struct DP_CsvCursor {
+    CsvPlan plan;
+};
+
+size_t dp_csv_complete(const char *data, size_t len) {
+    size_t pos = 0, end = 0;
+    while (pos < len) {
+        const char *newline = memchr(data + pos, '\n', len - pos);
+        size_t stop = newline ? (size_t)(newline - data) : len;
+        const char *quote = memchr(data + pos, '"', stop - pos);
+        if (!quote) {
+            if (!newline) break;
+            pos = end = stop + 1;
+            continue;
+        }
+
+        // Skip the quoted field; a doubled quote just reopens it
+        const char *close = memchr(quote + 1, '"', len - (size_t)(quote + 1 - data));
+        if (!close) break;
+        pos = (size_t)(close + 1 - data);
+    }
+    return end;
+}
+
+DP_CsvCursor *dp_csv_cursor_new(const char *data, size_t len, const DP_LoadOptions *opts,
+                                const char *source, size_t *header_len) {
+    DP_CsvCursor *c = malloc(sizeof(DP_CsvCursor));
+    if (!c) return NULL;
+
+    CsvReader r;
+    csv_reader_init(&r, data, len, 0, NULL);
+    long n = csv_next_record(&r);
+    int rc = n > 0 ? csv_build_plan(&c->plan, &r, n, opts, source) : -1;
+    *header_len = r.pos;
+    csv_reader_free(&r);
+    if (rc != 0) {
+        if (n > 0) csv_plan_free(&c->plan);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+int dp_csv_cursor_feed(DP_CsvCursor *c, const char *data, size_t len, DP_CsvRowFn fn, void *ctx) {
+    if (!c || !fn) return -1;
+
+    CsvReader r;
+    csv_reader_init(&r, data, len, 0, &c->plan);
+    long n;
+    int rc = 0;
+    while (rc == 0 && (n = csv_next_row(&r, len)) > 0) {
+        rc = fn(ctx, r.row_fields, r.row_lens, (size_t)n);
+    }
+    csv_reader_free(&r);
+    return n < 0 || rc != 0 ? -1 : 0;
+}
+
+void dp_csv_cursor_free(DP_CsvCursor *c) {
+    if (!c) return;
+    csv_plan_free(&c->plan);
+    free(c);
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/datatype.h"
+
+// Dictionary for a string column: every distinct value is stored once
+// and rows hold its 32-bit code
+typedef struct {
+    char *arena;            // Distinct strings, NUL-terminated, back to back
+    size_t arena_used;
+    size_t arena_capacity;
+    size_t *offsets;        // offsets[code] into arena
+    uint64_t *hashes;       // hashes[code]
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;        // Open-addressing table of code + 1 (0 = empty)
+    size_t slot_capacity;
+} DP_Dictionary;
+
+// One named, typed column. Storage depends on the type:
+//   INT    int64_t per row
+//   FLOAT  double per row
+//   DATE   int32_t days since 1970-01-01 per row
+//   BOOL   one bit per row, packed into 64-bit words
+//   STRING uint32_t dictionary code per row
+typedef struct {
+    char *name;
+    DataType type;
+    union {
+        int64_t *ints;
+        double *floats;
+        int32_t *dates;
+        uint64_t *bits;
+        uint32_t *codes;
+    } data;
+    DP_Dictionary *dict;    // STRING columns only
+} DP_Column;
+
+typedef struct {
+    char *name;
+    DP_Column *columns;
+    size_t column_count;
+    size_t row_count;
+    size_t capacity;        // Rows allocated in every column
+} DP_Table;
+
+// Table construction
+DP_Table *dp_table_new(const char *name);
+int dp_table_add_column(DP_Table *t, const char *name, DataType type);
+int dp_table_reserve(DP_Table *t, size_t rows);
+void dp_table_free(DP_Table *t);
+
+// Append one row given as text fields (one per column, 'lens' bytes
+// each); every field is parsed into its column's native type and
+// unparseable or missing fields become 0 / false / ""
+int dp_table_append_text(DP_Table *t, const char *const *fields, const size_t *lens, size_t nfields);
+
+// Column lookup by name; NULL if absent
+DP_Column *dp_table_column(const DP_Table *t, const char *name);
+
+// Row accessors
+int64_t dp_column_int(const DP_Column *col, size_t row);
+double dp_column_float(const DP_Column *col, size_t row);
+int32_t dp_column_date(const DP_Column *col, size_t row);
+int dp_column_bool(const DP_Column *col, size_t row);
+const char *dp_column_string(const DP_Column *col, size_t row);
+
+// Numeric view of any non-string column (dates as days, bools as 0/1)
+double dp_column_number(const DP_Column *col, size_t row);
+
+// Schema inference: the narrowest type that can hold 'text'
+// (empty text returns -1, meaning "no evidence"), and the type that
+// can hold values of both 'a' and 'b' (-1 is the identity)
+int dp_infer_type(const char *text, size_t len);
+int dp_merge_type(int a, int b);
+
+// Text parsing shared by the loaders
+int dp_parse_int(const char *text, size_t len, int64_t *out);
+int dp_parse_float(const char *text, size_t len, double *out);
+int dp_parse_date(const char *text, size_t len, int32_t *out);
+int dp_parse_bool(const char *text, size_t len, int *out);
+
+// Bytes held by the table's columns and dictionaries
+size_t dp_table_memory(const DP_Table *t);
+const char *dp_type_name(DataType type);
+void dp_table_print_schema(const DP_Table *t);
+
+// Keeps rows where min <= value <= max for the named column; fields
+// that are not numbers fail. Use -INFINITY / INFINITY for open ends.
+typedef struct {
+    const char *column;
+    double min;
+    double max;
+} DP_RangePredicate;
+
+// Pushdown for the file loaders: only the listed columns are kept, and
+// rows failing any predicate are dropped during the scan. Fields that
+// are neither kept nor tested are never parsed.
+typedef struct {
+    const char *const *columns;     // NULL / 0 keeps every column
+    size_t column_count;
+    const DP_RangePredicate *predicates;
+    size_t predicate_count;
+} DP_LoadOptions;
+
+// Load a CSV file with a header row into a typed table; column types
+// are inferred from the data. Large files are split at record
+// boundaries and parsed on parallel_threads() workers; the result is
+// identical to a single-threaded load.
+DP_Table *dp_table_load_csv(const char *filename);
+DP_Table *dp_table_load_csv_opts(const char *filename, const DP_LoadOptions *opts);
+
+// The field holding a row's value when the options name no column: the
+// first field of the first data row (the first that survives the
+// predicates) that reads as a number, or field 0 when none does. Later
+// rows read that field as a number, 0 if it is not one. The CSV loader
+// and DP_RecordFeed both decide this way.
+size_t dp_csv_value_field(const char *const *fields, const size_t *lens, size_t nfields);
+
+// One-column table of the value column: opts->columns[0] when named,
+// else the field dp_csv_value_field picks. No other field is parsed.
+DP_Table *dp_table_load_csv_value(const char *filename, const DP_LoadOptions *opts);
+
+// Incremental CSV for sources that keep growing (see dp_tail.h): a
+// cursor is built from the header record, then fed whole records.
+typedef struct DP_CsvCursor DP_CsvCursor;
+
+// Receives each row that survives the cursor's options: the kept fields
+// (the options' columns in order, or every field), valid for the call.
+// A non-zero return stops the feed, which then fails.
+typedef int (*DP_CsvRowFn)(void *ctx, const char *const *fields, const size_t *lens, size_t nfields);
+
+// Bytes of whole records at the start of data[0, len): up to and
+// including the last newline outside quotes. 'data' must begin at a
+// record boundary.
+size_t dp_csv_complete(const char *data, size_t len);
+
+// Cursor for the header record at the start of data[0, len), which must
+// hold at least that whole record; its length goes to *header_len. NULL
+// if the header lacks a column the options name.
+DP_CsvCursor *dp_csv_cursor_new(const char *data, size_t len, const DP_LoadOptions *opts,
+                                const char *source, size_t *header_len);
+int dp_csv_cursor_feed(DP_CsvCursor *c, const char *data, size_t len, DP_CsvRowFn fn, void *ctx);
+void dp_csv_cursor_free(DP_CsvCursor *c);
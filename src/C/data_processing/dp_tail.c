@@ -0,0 +1,131 @@
+#include "dp_tail.h"
+#include "dp_decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define TAIL_READ_SIZE (1 << 20)
+
+// Kept values and the aggregates move together, so a value that cannot
+// be kept stops the refresh
+static int tail_fold(void *ctx, double value) {
+    DP_TailSource *t = ctx;
+    if (dp_dataset_add(t->values, value) != 0) return -1;
+    dp_stream_agg_add(&t->agg, value);
+    return 0;
+}
+
+// ---------- Source ----------
+
+// Forget everything read so far (the file was truncated or replaced)
+static int tail_reset(DP_TailSource *t) {
+    DP_DataSet *values = dp_dataset_new(t->path);
+    if (!values) return -1;
+    if (t->values->sketch) dp_dataset_track_quantiles(values, t->values->sketch->k);
+    dp_dataset_free(t->values);
+    t->values = values;
+
+    dp_feed_reset(&t->feed);
+    t->offset = 0;
+    return dp_stream_agg_reset(&t->agg);
+}
+
+DP_TailSource *dp_tail_open(const char *path, const DP_LoadOptions *opts) {
+    if (!path) return NULL;
+    DP_TailSource *t = calloc(1, sizeof(DP_TailSource));
+    if (!t) return NULL;
+
+    t->path = strdup(path);
+    t->values = dp_dataset_new(path);
+    dp_stream_agg_init(&t->agg, 0);
+
+    // Only the value column and the predicates matter here
+    int ok = t->path && t->values;
+    if (ok && opts && opts->column_count) {
+        char **column = malloc(sizeof(char *));
+        ok = column && (column[0] = strdup(opts->columns[0])) != NULL;
+        t->opts.columns = (const char *const *)column;
+        t->opts.column_count = column ? 1 : 0;
+    }
+    size_t npreds = opts ? opts->predicate_count : 0;
+    if (ok && npreds) {
+        DP_RangePredicate *preds = calloc(npreds, sizeof(DP_RangePredicate));
+        t->opts.predicates = preds;
+        for (size_t i = 0; preds && i < npreds; i++) {
+            preds[i] = opts->predicates[i];
+            preds[i].column = strdup(opts->predicates[i].column);
+            if (!preds[i].column) ok = 0;
+            t->opts.predicate_count = i + 1;
+        }
+        ok = ok && preds;
+    }
+    int ndjson = dp_path_has_extension(path, ".ndjson") || dp_path_has_extension(path, ".jsonl");
+    dp_feed_init(&t->feed, ndjson, &t->opts, t->path, tail_fold, t);
+
+    if (!ok) {
+        dp_tail_close(t);
+        return NULL;
+    }
+    return t;
+}
+
+long dp_tail_refresh(DP_TailSource *t) {
+    if (!t) return -1;
+
+    int fd = open(t->path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int moved = st.st_dev != t->dev || st.st_ino != t->ino || (uint64_t)st.st_size < t->offset;
+    if (moved && (t->offset > 0 || t->values->count > 0) && tail_reset(t) != 0) {
+        close(fd);
+        return -1;
+    }
+    t->dev = st.st_dev;
+    t->ino = st.st_ino;
+
+    size_t before = t->values->count;
+    int rc = 0;
+    for (;;) {
+        char *space = dp_feed_space(&t->feed, TAIL_READ_SIZE);
+        ssize_t got = space ? pread(fd, space, TAIL_READ_SIZE, (off_t)t->offset) : -1;
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            if (got < 0) rc = -1;
+            break;
+        }
+        t->offset += (uint64_t)got;
+        if (dp_feed_commit(&t->feed, (size_t)got) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+    close(fd);
+
+    return rc != 0 ? -1 : (long)(t->values->count - before);
+}
+
+void dp_tail_close(DP_TailSource *t) {
+    if (!t) return;
+    if (t->opts.columns) {
+        free((char *)t->opts.columns[0]);
+        free((char **)t->opts.columns);
+    }
+    for (size_t i = 0; i < t->opts.predicate_count; i++) {
+        free((char *)t->opts.predicates[i].column);
+    }
+    free((DP_RangePredicate *)t->opts.predicates);
+    dp_feed_free(&t->feed);
+    dp_stream_agg_free(&t->agg);
+    if (t->values) dp_dataset_free(t->values);
+    free(t->path);
+    free(t);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "dp_dataset.h"
+#include "dp_stream.h"
+
+// Append-only source over a CSV or NDJSON file that keeps growing, such
+// as an event log. The source remembers how far it has read and the
+// unfinished last line; each refresh reads only the bytes appended
+// since, folds the new rows into 'values' and updates the running
+// aggregates, so its cost follows the new data rather than the file size.
+//
+// Rows are chosen as by dp_dataset_load_csv_opts / the NDJSON loader
+// (see DP_RecordFeed). A file that shrinks or is replaced (rotated) is
+// read again from the start, into a fresh 'values' dataset.
+typedef struct {
+    char *path;
+    DP_LoadOptions opts;        // Private copy of the caller's options
+    DP_RecordFeed feed;
+
+    uint64_t offset;            // Bytes of the file consumed so far
+    dev_t dev;                  // Identity of the file being followed
+    ino_t ino;
+
+    DP_DataSet *values;
+    DP_StreamAgg agg;           // Maintained over every value seen
+} DP_TailSource;
+
+// NULL if the options cannot be copied; a missing file is not an error
+// (it is picked up by a later refresh)
+DP_TailSource *dp_tail_open(const char *path, const DP_LoadOptions *opts);
+
+// Read what was appended since the last refresh; returns the number of
+// new rows, or -1 on error
+long dp_tail_refresh(DP_TailSource *t);
+
+void dp_tail_close(DP_TailSource *t);
@@ -1,26 +1,192 @@
 #include "ast.h"
+#include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-ASTNode *ast_new(NodeType type, const char *name, const char *value, int numeric_value) {
-    ASTNode *node = malloc(sizeof(ASTNode));
+/* Arena blocks: the usual size, and the alignment every allocation
+   gets. A request too big for a block gets a block of its own. */
+#define AST_ARENA_BLOCK_SIZE (64 * 1024)
+#define AST_ARENA_ALIGN 16
+
+typedef struct ASTArenaBlock {
+    struct ASTArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ASTArenaBlock;
+
+struct ASTArena {
+    ASTArenaBlock *blocks;      /* Newest first; allocations come from the head */
+    ASTNode *root;
+};
+
+static ASTArenaBlock *arena_block_new(size_t size) {
+    ASTArenaBlock *block = malloc(sizeof(ASTArenaBlock) + size + AST_ARENA_ALIGN);
+    if (!block) return NULL;
+    block->next = NULL;
+    block->used = 0;
+    block->size = size + AST_ARENA_ALIGN;
+    return block;
+}
+
+ASTArena *ast_arena_new(void) {
+    ASTArena *arena = malloc(sizeof(ASTArena));
+    if (!arena) return NULL;
+    arena->blocks = arena_block_new(AST_ARENA_BLOCK_SIZE);
+    arena->root = NULL;
+    if (!arena->blocks) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+/* Aligned room for size bytes in block, or NULL if it does not fit */
+static void *arena_block_take(ASTArenaBlock *block, size_t size) {
+    uintptr_t base = (uintptr_t)block->data;
+    uintptr_t at = (base + block->used + AST_ARENA_ALIGN - 1) & ~(uintptr_t)(AST_ARENA_ALIGN - 1);
+    if (at - base + size > block->size) return NULL;
+    block->used = at - base + size;
+    return (void *)at;
+}
+
+void *ast_arena_alloc(ASTArena *arena, size_t size) {
+    void *p = arena_block_take(arena->blocks, size);
+    if (p) return p;
+
+    if (size > AST_ARENA_BLOCK_SIZE / 4) {
+        /* Oversized: its own block, behind the head so the head's
+           free space is still used */
+        ASTArenaBlock *block = arena_block_new(size);
+        if (!block) return NULL;
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+        return arena_block_take(block, size);
+    }
+
+    ASTArenaBlock *block = arena_block_new(AST_ARENA_BLOCK_SIZE);
+    if (!block) return NULL;
+    block->next = arena->blocks;
+    arena->blocks = block;
+    return arena_block_take(block, size);
+}
+
+char *ast_arena_strndup(ASTArena *arena, const char *str, size_t len) {
+    char *copy = ast_arena_alloc(arena, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+static void ast_node_init(ASTNode *node, NodeType type, const char *name, const char *value, int numeric_value) {
     node->type = type;
-    node->name = name ? strdup(name) : NULL;
-    node->value = value ? strdup(value) : NULL;
+    node->name = name;
+    node->value = value;
     node->numeric_value = numeric_value;
+    node->float_value = 0.0;
+    node->data_type = DATA_TYPE_INT;
+    node->agg_type = AGG_SUM;
+    node->comparison_op = OP_EQ;
+    node->sort_dir = SORT_ASC;
+    node->join_type = JOIN_TYPE_INNER;
     node->children = NULL;
     node->child_count = 0;
+    node->child_capacity = 0;
+    node->line = 0;
+    node->column = 0;
+    node->arena = NULL;
+}
+
+ASTNode *ast_arena_node(ASTArena *arena, NodeType type, const char *name, const char *value, int numeric_value) {
+    ASTNode *node = ast_arena_alloc(arena, sizeof(ASTNode));
+    if (!node) return NULL;
+    ast_node_init(node, type, name, value, numeric_value);
+    node->arena = arena;
+    if (!arena->root) arena->root = node;
+    return node;
+}
+
+ASTNode *ast_arena_nodes(ASTArena *arena, size_t count) {
+    if (count == 0 || count > SIZE_MAX / sizeof(ASTNode)) return NULL;
+    ASTNode *nodes = ast_arena_alloc(arena, count * sizeof(ASTNode));
+    if (!nodes) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        ast_node_init(&nodes[i], NODE_DOCUMENT, NULL, NULL, 0);
+        nodes[i].arena = arena;
+    }
+    if (!arena->root) arena->root = nodes;
+    return nodes;
+}
+
+void ast_arena_free(ASTArena *arena) {
+    if (!arena) return;
+    ASTArenaBlock *block = arena->blocks;
+    while (block) {
+        ASTArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+ASTNode *ast_new(NodeType type, const char *name, const char *value, int numeric_value) {
+    ASTNode *node = malloc(sizeof(ASTNode));
+    ast_node_init(node, type, name ? strdup(name) : NULL, value ? strdup(value) : NULL, numeric_value);
     return node;
 }
 
+void ast_set_data_type(ASTNode *node, DataType dtype) {
+    if (node) node->data_type = dtype;
+}
+
+void ast_set_comparison_op(ASTNode *node, ComparisonOp op) {
+    if (node) node->comparison_op = op;
+}
+
+void ast_set_sort_direction(ASTNode *node, SortDirection dir) {
+    if (node) node->sort_dir = dir;
+}
+
+void ast_set_join_type(ASTNode *node, JoinType type) {
+    if (node) node->join_type = type;
+}
+
+void ast_set_aggregation(ASTNode *node, AggregationType agg) {
+    if (node) node->agg_type = agg;
+}
+
 void ast_add_child(ASTNode *parent, ASTNode *child) {
-    parent->children = realloc(parent->children, sizeof(ASTNode *) * (parent->child_count + 1));
-    parent->children[parent->child_count] = child;
-    parent->child_count++;
+    if (parent->child_count == parent->child_capacity) {
+        size_t capacity = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        ASTNode **children;
+        if (parent->arena) {
+            /* The outgrown array stays in the arena until it is freed;
+               with doubling that is never more than the live one */
+            children = ast_arena_alloc(parent->arena, sizeof(ASTNode *) * capacity);
+            if (children && parent->child_count > 0) {
+                memcpy(children, parent->children, sizeof(ASTNode *) * parent->child_count);
+            }
+        } else {
+            children = realloc(parent->children, sizeof(ASTNode *) * capacity);
+        }
+        if (!children) {
+            fprintf(stderr, "AST error: out of memory adding a child node.\n");
+            return;
+        }
+        parent->children = children;
+        parent->child_capacity = capacity;
+    }
+    parent->children[parent->child_count++] = child;
 }
 
 void ast_free(ASTNode *node) {
     if (!node) return;
+    if (node->arena) {
+        if (node->arena->root == node) ast_arena_free(node->arena);
+        return;
+    }
     if (node->name) free((void *)node->name);
     if (node->value) free((void *)node->value);
     for (size_t i = 0; i < node->child_count; i++) {
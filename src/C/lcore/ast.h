@@ -4,14 +4,8 @@
 #include <stddef.h>
 #include <time.h>
 
-/* Data type for type-safe operations (duplicated to avoid circular dependency) */
-typedef enum {
-    DATA_TYPE_INT,
-    DATA_TYPE_FLOAT,
-    DATA_TYPE_STRING,
-    DATA_TYPE_DATE,
-    DATA_TYPE_BOOL,
-} DataType;
+/* Data type for type-safe operations */
+#include "core/datatype.h"
 
 /* Extended node types for enterprise features */
 typedef enum {
@@ -28,7 +22,10 @@ typedef enum {
     NODE_JOIN,          /* New: dataset joins */
     NODE_COMPUTED_COL,  /* New: computed/derived columns */
     NODE_FUNCTION_CALL, /* New: function calls */
-    NODE_TEXT
+    NODE_TEXT,
+    NODE_CONDITION,     /* Comparison inside a filter predicate */
+    NODE_LOGICAL,       /* and / or / not inside a filter predicate */
+    NODE_OPERATOR       /* Arithmetic operator inside a computed expression */
 } NodeType;
 
 /* Aggregation function types */
@@ -40,6 +37,7 @@ typedef enum {
     AGG_COUNT,
     AGG_STDDEV,
     AGG_MEDIAN,
+    AGG_PERCENTILE,
 } AggregationType;
 
 /* Comparison operators for filtering */
@@ -60,6 +58,12 @@ typedef enum {
     SORT_DESC,
 } SortDirection;
 
+/* Join type */
+typedef enum {
+    JOIN_TYPE_INNER,
+    JOIN_TYPE_LEFT,
+} JoinType;
+
 /* AST Node structure with extended metadata */
 typedef struct ASTNode {
     NodeType type;
@@ -73,16 +77,41 @@ typedef struct ASTNode {
     AggregationType agg_type;   /* Aggregation type (if applicable) */
     ComparisonOp comparison_op; /* Comparison operator (for filters) */
     SortDirection sort_dir;     /* Sort direction */
+    JoinType join_type;         /* Join type */
     
     /* Child nodes for tree structure */
     struct ASTNode **children;
     size_t child_count;
+    size_t child_capacity;
     
     /* Metadata */
     int line;
     int column;
+
+    struct ASTArena *arena;     /* Arena the node lives in; NULL for a heap node */
 } ASTNode;
 
+/*
+ * Bump allocator for a parsed tree. The nodes, their strings and their
+ * child arrays are carved out of large blocks, so building a tree costs
+ * a few mallocs in all and freeing it releases the blocks without
+ * visiting a node. Arena nodes may point name and value at static
+ * strings as well; nothing in an arena is freed on its own.
+ */
+typedef struct ASTArena ASTArena;
+
+ASTArena *ast_arena_new(void);
+/* NULL when out of memory */
+void *ast_arena_alloc(ASTArena *arena, size_t size);
+/* NUL-terminated copy of len bytes of str */
+char *ast_arena_strndup(ASTArena *arena, const char *str, size_t len);
+/* Node whose name and value are kept as given, not copied. The first
+   node made in an arena is its root: ast_free on it frees the arena. */
+ASTNode *ast_arena_node(ASTArena *arena, NodeType type, const char *name, const char *value, int numeric_value);
+/* 'count' blank nodes in one array, for building a whole tree at once */
+ASTNode *ast_arena_nodes(ASTArena *arena, size_t count);
+void ast_arena_free(ASTArena *arena);
+
 /* Function prototypes */
 ASTNode *ast_new(NodeType type, const char *name, const char *value, int numeric_value);
 ASTNode *ast_new_float(NodeType type, const char *name, double float_value);
@@ -91,6 +120,9 @@ void ast_set_data_type(ASTNode *node, DataType dtype);
 void ast_set_comparison_op(ASTNode *node, ComparisonOp op);
 void ast_set_aggregation(ASTNode *node, AggregationType agg);
 void ast_set_sort_direction(ASTNode *node, SortDirection dir);
+void ast_set_join_type(ASTNode *node, JoinType type);
+/* Frees a heap node and its subtree, or the whole arena for an arena's
+   root; other arena nodes go only with their arena */
 void ast_free(ASTNode *node);
 
 #endif
\ No newline at end of file
@@ -3,30 +3,94 @@
 #include <string.h>
 #include <ctype.h>
 
-static int match_sum(const char *str, size_t len)   { return len == 3 && strcmp(str, "sum") == 0; }
-static int match_avg(const char *str, size_t len)   { return len == 3 && strcmp(str, "avg") == 0; }
-static int match_min(const char *str, size_t len)   { return len == 3 && strcmp(str, "min") == 0; }
-static int match_max(const char *str, size_t len)   { return len == 3 && strcmp(str, "max") == 0; }
-static int match_count(const char *str, size_t len) { return len == 5 && strcmp(str, "count") == 0; }
-
+/*
+ * Keywords by perfect hash: the slot is computed from the length and the
+ * first and last bytes, and those three alone tell every keyword apart,
+ * so an identifier costs one probe and one compare. The constants were
+ * found by search; a new keyword that collides shows up as an
+ * "initialized field overwritten" warning (-Woverride-init, in -Wextra)
+ * and needs new constants.
+ */
+#define KEYWORD_SLOTS 128
+#define KEYWORD_HASH(len, first, last) \
+    (((unsigned)(unsigned char)(first) * 7u + (unsigned)(unsigned char)(last) * 48u + (unsigned)(len) * 12u) & (KEYWORD_SLOTS - 1))
+#define KEYWORD(word, first, last, type) \
+    [KEYWORD_HASH(sizeof(word) - 1, first, last)] = { word, sizeof(word) - 1, type }
+
+typedef struct {
+    const char *word;
+    size_t length;          /* 0 for an empty slot */
+    TokenType type;
+} Keyword;
+
+static const Keyword keywords[KEYWORD_SLOTS] = {
+    KEYWORD("as", 'a', 's', TOKEN_AS),
+    KEYWORD("view", 'v', 'w', TOKEN_VIEW),
+    KEYWORD("dataset", 'd', 't', TOKEN_DATASET),
+    KEYWORD("plot", 'p', 't', TOKEN_PLOT),
+    KEYWORD("filter", 'f', 'r', TOKEN_FILTER),
+    KEYWORD("where", 'w', 'e', TOKEN_WHERE),
+    KEYWORD("aggregate", 'a', 'e', TOKEN_AGGREGATE),
+    KEYWORD("group_by", 'g', 'y', TOKEN_GROUP_BY),
+    KEYWORD("order_by", 'o', 'y', TOKEN_ORDER_BY),
+    KEYWORD("join", 'j', 'n', TOKEN_JOIN),
+    KEYWORD("export", 'e', 't', TOKEN_EXPORT),
+    KEYWORD("sort", 's', 't', TOKEN_SORT),
+    KEYWORD("computed", 'c', 'd', TOKEN_COMPUTED),
+    KEYWORD("select", 's', 't', TOKEN_SELECT),
+    KEYWORD("from", 'f', 'm', TOKEN_FROM),
+    KEYWORD("into", 'i', 'o', TOKEN_INTO),
+    KEYWORD("in", 'i', 'n', TOKEN_IN),
+    KEYWORD("IN", 'I', 'N', TOKEN_IN),
+    KEYWORD("by", 'b', 'y', TOKEN_BY),
+    KEYWORD("asc", 'a', 'c', TOKEN_ASC),
+    KEYWORD("desc", 'd', 'c', TOKEN_DESC),
+    KEYWORD("limit", 'l', 't', TOKEN_LIMIT),
+    KEYWORD("with", 'w', 'h', TOKEN_WITH),
+    KEYWORD("on", 'o', 'n', TOKEN_ON),
+    KEYWORD("left", 'l', 't', TOKEN_LEFT),
+    KEYWORD("inner", 'i', 'r', TOKEN_INNER),
+    KEYWORD("and", 'a', 'd', TOKEN_AND),
+    KEYWORD("AND", 'A', 'D', TOKEN_AND),
+    KEYWORD("or", 'o', 'r', TOKEN_OR),
+    KEYWORD("OR", 'O', 'R', TOKEN_OR),
+    KEYWORD("not", 'n', 't', TOKEN_NOT),
+    KEYWORD("NOT", 'N', 'T', TOKEN_NOT),
+    KEYWORD("sum", 's', 'm', TOKEN_SUM),
+    KEYWORD("avg", 'a', 'g', TOKEN_AVG),
+    KEYWORD("average", 'a', 'e', TOKEN_AVG),
+    KEYWORD("min", 'm', 'n', TOKEN_MIN),
+    KEYWORD("max", 'm', 'x', TOKEN_MAX),
+    KEYWORD("count", 'c', 't', TOKEN_COUNT),
+    KEYWORD("stddev", 's', 'v', TOKEN_STDDEV),
+    KEYWORD("median", 'm', 'n', TOKEN_MEDIAN),
+    KEYWORD("percentile", 'p', 'e', TOKEN_PERCENTILE),
+    KEYWORD("int", 'i', 't', TOKEN_INT_TYPE),
+    KEYWORD("float", 'f', 't', TOKEN_FLOAT_TYPE),
+    KEYWORD("double", 'd', 'e', TOKEN_FLOAT_TYPE),
+    KEYWORD("string", 's', 'g', TOKEN_STRING_TYPE),
+    KEYWORD("date", 'd', 'e', TOKEN_DATE_TYPE),
+    KEYWORD("bool", 'b', 'l', TOKEN_BOOL_TYPE),
+    KEYWORD("boolean", 'b', 'n', TOKEN_BOOL_TYPE),
+    KEYWORD("text", 't', 't', TOKEN_TEXT),
+    KEYWORD("bar", 'b', 'r', TOKEN_BAR),
+    KEYWORD("line", 'l', 'e', TOKEN_LINE),
+    KEYWORD("table", 't', 'e', TOKEN_TABLE),
+    KEYWORD("histogram", 'h', 'm', TOKEN_HISTOGRAM),
+    KEYWORD("scatter", 's', 'r', TOKEN_SCATTER),
+    KEYWORD("pie", 'p', 'e', TOKEN_PIE),
+    KEYWORD("heatmap", 'h', 'p', TOKEN_HEATMAP),
+};
+
+static TokenType keyword_type(const char *str, size_t len) {
+    const Keyword *k = &keywords[KEYWORD_HASH(len, str[0], str[len - 1])];
+    return k->length == len && memcmp(k->word, str, len) == 0 ? k->type : TOKEN_IDENTIFIER;
+}
 
 static int is_identifier_char(char c) {
     return isalnum(c) || c == '_';
 }
 
-static int match_as(const char *str, size_t len) {
-    return len == 2 && str[0] == 'a' && str[1] == 's';
-}
-
-static int match_view(const char *str, size_t len) {
-    return len == 4 && strcmp(str, "view") == 0;
-}
-
-static int match_text(const char *str, size_t len) {
-    return len == 4 && strcmp(str, "text") == 0;
-}
-
-
 void lexer_init(Lexer *lexer, const char *source) {
     lexer->source = source;
     lexer->pos = 0;
@@ -53,6 +117,7 @@ static char peek(Lexer *lexer) {
 Token lexer_next(Lexer *lexer) {
     Token token;
     token.lexeme = NULL;
+    token.length = 0;
     token.numeric_value = 0;
     token.line = lexer->line;
     token.column = lexer->column;
@@ -64,16 +129,20 @@ Token lexer_next(Lexer *lexer) {
 
     char c = peek(lexer);
     if (c == '\0') return token;
+    token.lexeme = src + lexer->pos;
+    token.length = 1;
 
+    /* Headers, numbers and identifiers never span lines, so they are
+       scanned without per-character line tracking */
     if (c == '#') {
-        advance(lexer);
-        size_t start = lexer->pos;
-        while (peek(lexer) != '\n' && peek(lexer) != '\0') advance(lexer);
-        size_t len = lexer->pos - start;
+        size_t start = lexer->pos + 1;
+        const char *end = strchr(src + start, '\n');
+        size_t len = end ? (size_t)(end - (src + start)) : strlen(src + start);
+        lexer->pos = start + len;
+        lexer->column += (int)len + 1;
         token.type = TOKEN_HEADER;
-        token.lexeme = malloc(len + 1);
-        strncpy((char *)token.lexeme, src + start, len);
-        ((char *)token.lexeme)[len] = '\0';
+        token.lexeme = src + start;
+        token.length = len;
         return token;
     }
 
@@ -81,19 +150,56 @@ Token lexer_next(Lexer *lexer) {
         case '{': advance(lexer); token.type = TOKEN_LBRACE; return token;
         case '}': advance(lexer); token.type = TOKEN_RBRACE; return token;
         case ':': advance(lexer); token.type = TOKEN_COLON; return token;
+        case ',': advance(lexer); token.type = TOKEN_COMMA; return token;
+        case '.': advance(lexer); token.type = TOKEN_DOT; return token;
+        case '(': advance(lexer); token.type = TOKEN_LPAREN; return token;
+        case ')': advance(lexer); token.type = TOKEN_RPAREN; return token;
+        case '+': advance(lexer); token.type = TOKEN_PLUS; return token;
+        case '-': advance(lexer); token.type = TOKEN_MINUS; return token;
+        case '*': advance(lexer); token.type = TOKEN_STAR; return token;
+        case '/': advance(lexer); token.type = TOKEN_SLASH; return token;
+        case '%': advance(lexer); token.type = TOKEN_PERCENT; return token;
+        case '=':
+            advance(lexer);
+            if (peek(lexer) == '=') { advance(lexer); token.type = TOKEN_EQ; }
+            else token.type = TOKEN_ASSIGN;
+            return token;
+        case '!':
+            advance(lexer);
+            if (peek(lexer) == '=') { advance(lexer); token.type = TOKEN_NE; }
+            else token.type = TOKEN_NOT;
+            return token;
+        case '<':
+            advance(lexer);
+            if (peek(lexer) == '=') { advance(lexer); token.type = TOKEN_LE; }
+            else token.type = TOKEN_LT;
+            return token;
+        case '>':
+            advance(lexer);
+            if (peek(lexer) == '=') { advance(lexer); token.type = TOKEN_GE; }
+            else token.type = TOKEN_GT;
+            return token;
+        case '&':
+            advance(lexer);
+            if (peek(lexer) == '&') { advance(lexer); token.type = TOKEN_AND; }
+            else token.type = TOKEN_UNKNOWN;
+            return token;
+        case '|':
+            advance(lexer);
+            if (peek(lexer) == '|') { advance(lexer); token.type = TOKEN_OR; }
+            else token.type = TOKEN_PIPE;
+            return token;
         case '\n': advance(lexer); token.type = TOKEN_NEWLINE; return token;
     }
 
     if (isdigit(c)) {
         size_t start = lexer->pos;
-        while (isdigit(peek(lexer))) advance(lexer);
-        size_t len = lexer->pos - start;
-        char *buf = malloc(len + 1);
-        strncpy(buf, src + start, len);
-        buf[len] = '\0';
+        unsigned value = 0;
+        while (isdigit(src[lexer->pos])) value = value * 10 + (unsigned)(src[lexer->pos++] - '0');
         token.type = TOKEN_NUMBER;
-        token.lexeme = buf;
-        token.numeric_value = atoi(buf);
+        token.length = lexer->pos - start;
+        token.numeric_value = (int)value;
+        lexer->column += (int)token.length;
         return token;
     }
 
@@ -101,44 +207,22 @@ Token lexer_next(Lexer *lexer) {
         advance(lexer);
         size_t start = lexer->pos;
         while (peek(lexer) != '"' && peek(lexer) != '\0') advance(lexer);
-        size_t len = lexer->pos - start;
-        char *buf = malloc(len + 1);
-        strncpy(buf, src + start, len);
-        buf[len] = '\0';
         token.type = TOKEN_STRING;
-        token.lexeme = buf;
+        token.lexeme = src + start;
+        token.length = lexer->pos - start;
         if (peek(lexer) == '"') advance(lexer);
         return token;
     }
 
     if (isalpha(c) || c == '_') {
         size_t start = lexer->pos;
-        while (is_identifier_char(peek(lexer))) advance(lexer);
+        while (is_identifier_char(src[lexer->pos])) lexer->pos++;
         size_t len = lexer->pos - start;
-        char *buf = malloc(len + 1);
-        strncpy(buf, src + start, len);
-        buf[len] = '\0';
-
-        /* Check for keywords */
-        if (match_as(buf, len)) {
-            token.type = TOKEN_AS; free(buf); token.lexeme = NULL;
-        } else if (match_view(buf, len)) {
-            token.type = TOKEN_VIEW; free(buf); token.lexeme = NULL;
-        } else if (match_sum(buf, len)) {
-            token.type = TOKEN_SUM; free(buf); token.lexeme = NULL;
-        } else if (match_avg(buf, len)) {
-            token.type = TOKEN_AVG; free(buf); token.lexeme = NULL;
-        } else if (match_min(buf, len)) {
-            token.type = TOKEN_MIN; free(buf); token.lexeme = NULL;
-        } else if (match_max(buf, len)) {
-            token.type = TOKEN_MAX; free(buf); token.lexeme = NULL;
-        } else if (match_count(buf, len)) {
-            token.type = TOKEN_COUNT; free(buf); token.lexeme = NULL;
-        } else if (match_text(buf, len)) {
-            token.type = TOKEN_TEXT; free(buf); token.lexeme = NULL;
-        } else {
-            token.type = TOKEN_IDENTIFIER; token.lexeme = buf;
-        }
+        const char *buf = src + start;
+        token.length = len;
+        lexer->column += (int)len;
+
+        token.type = keyword_type(buf, len);
         return token;
     }
 
@@ -147,7 +231,3 @@ Token lexer_next(Lexer *lexer) {
     token.type = TOKEN_UNKNOWN;
     return token;
 }
-
-void token_free(Token *token) {
-    if (token->lexeme) free((void *)token->lexeme);
-}
\ No newline at end of file
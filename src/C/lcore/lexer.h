@@ -42,6 +42,15 @@ typedef enum {
     TOKEN_SELECT,           /* 'select' keyword */
     TOKEN_FROM,             /* 'from' keyword */
     TOKEN_INTO,             /* 'into' keyword */
+    TOKEN_IN,               /* 'in' keyword */
+    TOKEN_BY,               /* 'by' keyword */
+    TOKEN_ASC,              /* 'asc' keyword */
+    TOKEN_DESC,             /* 'desc' keyword */
+    TOKEN_LIMIT,            /* 'limit' keyword */
+    TOKEN_WITH,             /* 'with' keyword */
+    TOKEN_ON,               /* 'on' keyword */
+    TOKEN_LEFT,             /* 'left' keyword */
+    TOKEN_INNER,            /* 'inner' keyword */
     
     /* Operators */
     TOKEN_EQ,               /* == */
@@ -69,6 +78,7 @@ typedef enum {
     TOKEN_COUNT,            /* 'count' */
     TOKEN_STDDEV,           /* 'stddev' */
     TOKEN_MEDIAN,           /* 'median' */
+    TOKEN_PERCENTILE,       /* 'percentile' */
     /* Data types */
     TOKEN_INT_TYPE,         /* 'int' */
     TOKEN_FLOAT_TYPE,       /* 'float' or 'double' */
@@ -91,10 +101,14 @@ typedef enum {
     TOKEN_UNKNOWN           /* Unrecognized token */
 } TokenType;
 
-/* Token structure with extended metadata */
+/* Token structure with extended metadata. The lexeme is a slice of the
+   source, 'length' bytes that are not NUL-terminated and stay valid as
+   long as the source does; strings exclude their quotes and headers the
+   leading '#'. */
 typedef struct {
     TokenType type;
     const char *lexeme;
+    size_t length;
     int numeric_value;
     double float_value;
     int line;
@@ -112,7 +126,6 @@ typedef struct {
 /* Function prototypes */
 void lexer_init(Lexer *lexer, const char *source);
 Token lexer_next(Lexer *lexer);
-void token_free(Token *token);
 const char *token_type_to_string(TokenType type);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 #include "core/dataset.h" 
 
 // Forward declarations
@@ -12,9 +13,15 @@ static ASTNode *parse_plot(Parser *parser);
 static ASTNode *parse_export(Parser *parser);
 static ASTNode *parse_view(Parser *parser);
 static ASTNode *parse_text(Parser *parser);
+static ASTNode *parse_aggregate(Parser *parser);
+static ASTNode *parse_filter(Parser *parser);
+static ASTNode *parse_condition(Parser *parser);
+static ASTNode *parse_sort(Parser *parser);
+static ASTNode *parse_join(Parser *parser);
+static ASTNode *parse_computed(Parser *parser);
+static ASTNode *parse_arith(Parser *parser);
 
 static void parser_advance(Parser *parser) {
-    token_free(&parser->current_token);
     parser->current_token = lexer_next(parser->lexer);
 }
 
@@ -22,21 +29,67 @@ static void parser_expect(Parser *parser, TokenType type) {
     if (parser->current_token.type != type) {
         fprintf(stderr, "Parse error: expected token %d, got %d at line %d, column %d\n",
                 type, parser->current_token.type, parser->current_token.line, parser->current_token.column);
-        fprintf(stderr, "  Current lexeme: %s\n", parser->current_token.lexeme ? parser->current_token.lexeme : "NULL");
+        if (parser->current_token.lexeme) {
+            fprintf(stderr, "  Current lexeme: %.*s\n", (int)parser->current_token.length, parser->current_token.lexeme);
+        } else {
+            fprintf(stderr, "  Current lexeme: NULL\n");
+        }
+        exit(1);
+    }
+}
+
+/* Keywords double as names (a dataset called "line", a row "count"),
+   except the operators and/or/not */
+static int token_is_name(TokenType type) {
+    return type == TOKEN_IDENTIFIER ||
+           (type >= TOKEN_AS && type <= TOKEN_INNER) ||
+           (type >= TOKEN_SUM && type <= TOKEN_HEATMAP);
+}
+
+/* Outside a condition the words and/or/not are names as well (a row
+   "OR" for Oregon); the symbols &&, || and ! never are */
+static int parser_at_name(const Parser *parser) {
+    const Token *token = &parser->current_token;
+    if (token_is_name(token->type)) return 1;
+    return (token->type == TOKEN_AND || token->type == TOKEN_OR || token->type == TOKEN_NOT) &&
+           isalpha((unsigned char)token->lexeme[0]);
+}
+
+static void parser_expect_name(Parser *parser) {
+    if (!parser_at_name(parser)) parser_expect(parser, TOKEN_IDENTIFIER);
+}
+
+/* The tree lives in the parse's arena; running out of memory ends the
+   parse like any other error */
+static void *parser_check_alloc(void *p) {
+    if (!p) {
+        fprintf(stderr, "Parse error: out of memory\n");
         exit(1);
     }
+    return p;
+}
+
+static ASTNode *parser_node(Parser *parser, NodeType type, const char *name, const char *value, int numeric_value) {
+    return parser_check_alloc(ast_arena_node(parser->arena, type, name, value, numeric_value));
+}
+
+/* The current token's text, copied into the arena */
+static char *parser_text(Parser *parser) {
+    const Token *token = &parser->current_token;
+    if (!token->lexeme) return NULL;
+    return parser_check_alloc(ast_arena_strndup(parser->arena, token->lexeme, token->length));
 }
 
 static ASTNode *parse_header(Parser *parser) {
     parser_expect(parser, TOKEN_HEADER);
-    char *text = strdup(parser->current_token.lexeme);
+    char *text = parser_text(parser);
     parser_advance(parser);
-    return ast_new(NODE_HEADER, NULL, text, 0);
+    return parser_node(parser, NODE_HEADER, NULL, text, 0);
 }
 
 static ASTNode *parse_row(Parser *parser) {
-    parser_expect(parser, TOKEN_IDENTIFIER);
-    char *label = strdup(parser->current_token.lexeme);
+    parser_expect_name(parser);
+    char *label = parser_text(parser);
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_COLON);
@@ -46,45 +99,60 @@ static ASTNode *parse_row(Parser *parser) {
     int value = parser->current_token.numeric_value;
     parser_advance(parser);
 
-    return ast_new(NODE_ROW, label, NULL, value);
+    return parser_node(parser, NODE_ROW, label, NULL, value);
 }
 
+/*
+ * dataset <name> "<title>" { <label>: <number> ... }
+ *
+ * The rows go straight from the tokens into a registered DataSet, the
+ * only copy of them; the NODE_DATASET node (name, value: title) has no
+ * children and refers to the dataset by name.
+ */
 static ASTNode *parse_dataset(Parser *parser) {
-    parser_expect(parser, TOKEN_IDENTIFIER); // "dataset"
+    parser_expect(parser, TOKEN_DATASET);
     parser_advance(parser);
 
-    parser_expect(parser, TOKEN_IDENTIFIER); // dataset name
-    char *name = strdup(parser->current_token.lexeme);
+    parser_expect_name(parser); // dataset name
+    char *name = parser_text(parser);
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_STRING); // title
-    char *title = strdup(parser->current_token.lexeme);
+    char *title = parser_text(parser);
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_LBRACE);
     parser_advance(parser);
 
-    ASTNode *dataset_node = ast_new(NODE_DATASET, name, title, 0);
+    ASTNode *dataset_node = parser_node(parser, NODE_DATASET, name, title, 0);
+
+    DataSet *ds = parser_check_alloc(malloc(sizeof(DataSet)));
+    dataset_init(ds, title);
 
     // Parse rows
     while (parser->current_token.type != TOKEN_RBRACE &&
            parser->current_token.type != TOKEN_EOF) {
-        ASTNode *row = parse_row(parser);
-        ast_add_child(dataset_node, row);
+        parser_expect_name(parser);
+        Token label = parser->current_token;
+        parser_advance(parser);
+
+        parser_expect(parser, TOKEN_COLON);
+        parser_advance(parser);
+
+        parser_expect(parser, TOKEN_NUMBER);
+        if (dataset_add_n(ds, label.lexeme, label.length, parser->current_token.numeric_value) != 0) {
+            exit(1);
+        }
+        parser_advance(parser);
     }
 
     parser_expect(parser, TOKEN_RBRACE);
     parser_advance(parser);
 
     // --- REGISTER DATASET ---
-    DataSet *ds = malloc(sizeof(DataSet));
-    dataset_init(ds, title);
-    for (size_t i = 0; i < dataset_node->child_count; i++) {
-        ASTNode *row = dataset_node->children[i];
-        dataset_add(ds, row->name, row->numeric_value);
-    }
     if (dataset_registry_add(name, ds) != 0) {
         fprintf(stderr, "Failed to register dataset '%s'\n", name);
+        dataset_release(ds);
     }
 
     return dataset_node;
@@ -94,18 +162,18 @@ static ASTNode *parse_view(Parser *parser) {
     parser_expect(parser, TOKEN_VIEW); // "view"
     parser_advance(parser);
 
-    parser_expect(parser, TOKEN_IDENTIFIER); // name
-    char *name = strdup(parser->current_token.lexeme);
+    parser_expect_name(parser); // name
+    char *name = parser_text(parser);
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_STRING); // title
-    char *title = strdup(parser->current_token.lexeme);
+    char *title = parser_text(parser);
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_LBRACE);
     parser_advance(parser);
 
-    ASTNode *view_node = ast_new(NODE_VIEW, name, title, 0);
+    ASTNode *view_node = parser_node(parser, NODE_VIEW, name, title, 0);
 
     while (parser->current_token.type != TOKEN_RBRACE &&
            parser->current_token.type != TOKEN_EOF) {
@@ -113,7 +181,7 @@ static ASTNode *parse_view(Parser *parser) {
         if (parser->current_token.type == TOKEN_TEXT) {
             ASTNode *text_node = parse_text(parser);
             ast_add_child(view_node, text_node);
-        } else if (parser->current_token.type == TOKEN_IDENTIFIER) {
+        } else if (parser_at_name(parser)) {
             ASTNode *row = parse_row(parser);
             ast_add_child(view_node, row);
         } else {
@@ -135,64 +203,487 @@ static ASTNode *parse_text(Parser *parser) {
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_STRING);
-    char *value = strdup(parser->current_token.lexeme);
+    char *value = parser_text(parser);
     parser_advance(parser);
 
-    return ast_new(NODE_TEXT, NULL, value, 0);
+    return parser_node(parser, NODE_TEXT, NULL, value, 0);
 }
 
-static ASTNode *parse_plot(Parser *parser) {
-    parser_expect(parser, TOKEN_IDENTIFIER); // "plot"
+/* <dataset> or <dataset>.<column>; returns the reference as one string */
+static char *parse_dataset_ref(Parser *parser) {
+    parser_expect_name(parser);
+    char *ref = parser_text(parser);
     parser_advance(parser);
 
-    parser_expect(parser, TOKEN_IDENTIFIER); // dataset name
-    char *dataset_name = strdup(parser->current_token.lexeme);
+    if (parser->current_token.type == TOKEN_DOT) {
+        parser_advance(parser);
+        parser_expect_name(parser); // column
+        const Token *column = &parser->current_token;
+        size_t len = strlen(ref);
+        char *joined = parser_check_alloc(ast_arena_alloc(parser->arena, len + column->length + 2));
+        memcpy(joined, ref, len);
+        joined[len] = '.';
+        memcpy(joined + len + 1, column->lexeme, column->length);
+        joined[len + 1 + column->length] = '\0';
+        ref = joined;
+        parser_advance(parser);
+    }
+    return ref;
+}
+
+static ASTNode *parse_plot(Parser *parser) {
+    parser_expect(parser, TOKEN_PLOT);
     parser_advance(parser);
 
+    char *dataset_name = parse_dataset_ref(parser);
+
     parser_expect(parser, TOKEN_AS);
     parser_advance(parser);
 
-    parser_expect(parser, TOKEN_IDENTIFIER); // plot type
-    char *plot_type = strdup(parser->current_token.lexeme);
+    parser_expect_name(parser); // plot type
+    char *plot_type = parser_text(parser);
     parser_advance(parser);
 
-    return ast_new(NODE_PLOT, dataset_name, plot_type, 0);
+    return parser_node(parser, NODE_PLOT, dataset_name, plot_type, 0);
 }
 
 static ASTNode *parse_export(Parser *parser) {
     fprintf(stderr, "DEBUG: parse_export()\n");
-    parser_expect(parser, TOKEN_IDENTIFIER); // "export"
+    parser_expect(parser, TOKEN_EXPORT);
     parser_advance(parser);
 
-    parser_expect(parser, TOKEN_IDENTIFIER); // format
-    char *format = strdup(parser->current_token.lexeme);
+    parser_expect_name(parser); // format
+    char *format = parser_text(parser);
     parser_advance(parser);
 
     parser_expect(parser, TOKEN_STRING); // filename
-    char *filename = strdup(parser->current_token.lexeme);
+    char *filename = parser_text(parser);
     parser_advance(parser);
 
-    return ast_new(NODE_EXPORT, format, filename, 0);
+    return parser_node(parser, NODE_EXPORT, format, filename, 0);
+}
+
+/*
+ * aggregate <source> group_by <key> <agg> into <target> [, <agg> into <target>]...
+ *
+ * Produces NODE_AGGREGATE (name: source, value: key column) with one
+ * NODE_FUNCTION_CALL child per output (name: function, value: target).
+ */
+static ASTNode *parse_aggregate(Parser *parser) {
+    parser_expect(parser, TOKEN_AGGREGATE);
+    parser_advance(parser);
+
+    char *source = parse_dataset_ref(parser);
+
+    parser_expect(parser, TOKEN_GROUP_BY);
+    parser_advance(parser);
+
+    parser_expect_name(parser); // key column
+    char *key = parser_text(parser);
+    parser_advance(parser);
+
+    ASTNode *aggregate_node = parser_node(parser, NODE_AGGREGATE, source, key, 0);
+
+    for (;;) {
+        const char *func_name = NULL;
+        AggregationType agg = AGG_SUM;
+
+        switch (parser->current_token.type) {
+            case TOKEN_SUM:    func_name = "sum";    agg = AGG_SUM; break;
+            case TOKEN_AVG:    func_name = "avg";    agg = AGG_AVG; break;
+            case TOKEN_MIN:    func_name = "min";    agg = AGG_MIN; break;
+            case TOKEN_MAX:    func_name = "max";    agg = AGG_MAX; break;
+            case TOKEN_COUNT:  func_name = "count";  agg = AGG_COUNT; break;
+            case TOKEN_STDDEV: func_name = "stddev"; agg = AGG_STDDEV; break;
+            default:
+                fprintf(stderr, "Expected aggregate function (sum, avg, min, max, count, stddev) "
+                        "at line %d, column %d\n",
+                        parser->current_token.line, parser->current_token.column);
+                exit(1);
+        }
+        parser_advance(parser);
+
+        parser_expect(parser, TOKEN_INTO);
+        parser_advance(parser);
+
+        parser_expect_name(parser); // target dataset
+        char *target = parser_text(parser);
+        parser_advance(parser);
+
+        ASTNode *output = parser_node(parser, NODE_FUNCTION_CALL, func_name, target, 0);
+        ast_set_aggregation(output, agg);
+        ast_add_child(aggregate_node, output);
+
+        if (parser->current_token.type != TOKEN_COMMA) break;
+        parser_advance(parser);
+    }
+
+    return aggregate_node;
+}
+
+/* Literal operand: number (optionally negative), string or bare word.
+   Numbers set numeric_value and DATA_TYPE_INT, text sets name and
+   DATA_TYPE_STRING. */
+static ASTNode *parse_literal(Parser *parser) {
+    int negative = 0;
+    if (parser->current_token.type == TOKEN_MINUS) {
+        negative = 1;
+        parser_advance(parser);
+    }
+
+    ASTNode *literal;
+    if (parser->current_token.type == TOKEN_NUMBER) {
+        int value = parser->current_token.numeric_value;
+        literal = parser_node(parser, NODE_ROW, NULL, NULL, negative ? -value : value);
+        ast_set_data_type(literal, DATA_TYPE_INT);
+    } else if (!negative && (parser->current_token.type == TOKEN_STRING ||
+                             token_is_name(parser->current_token.type))) {
+        literal = parser_node(parser, NODE_ROW, parser_text(parser), NULL, 0);
+        ast_set_data_type(literal, DATA_TYPE_STRING);
+    } else {
+        fprintf(stderr, "Expected literal at line %d, column %d\n",
+                parser->current_token.line, parser->current_token.column);
+        exit(1);
+    }
+    parser_advance(parser);
+    return literal;
+}
+
+/*
+ * <column> <op> <literal> | <column> [not] in ( <literal>, ... )
+ *
+ * NODE_CONDITION: name is the column, comparison_op the operator and
+ * every literal is a NODE_ROW child (one child unless IN / NOT IN).
+ */
+static ASTNode *parse_comparison(Parser *parser) {
+    // column; and/or/not are operators here, not names
+    if (!token_is_name(parser->current_token.type)) parser_expect(parser, TOKEN_IDENTIFIER);
+    ASTNode *cond = parser_node(parser, NODE_CONDITION, parser_text(parser), NULL, 0);
+    parser_advance(parser);
+
+    ComparisonOp op;
+    switch (parser->current_token.type) {
+        case TOKEN_EQ:
+        case TOKEN_ASSIGN: op = OP_EQ; break;
+        case TOKEN_NE: op = OP_NE; break;
+        case TOKEN_LT: op = OP_LT; break;
+        case TOKEN_LE: op = OP_LE; break;
+        case TOKEN_GT: op = OP_GT; break;
+        case TOKEN_GE: op = OP_GE; break;
+        case TOKEN_IN: op = OP_IN; break;
+        case TOKEN_NOT:
+            parser_advance(parser);
+            parser_expect(parser, TOKEN_IN);
+            op = OP_NOT_IN;
+            break;
+        default:
+            fprintf(stderr, "Expected comparison operator at line %d, column %d\n",
+                    parser->current_token.line, parser->current_token.column);
+            exit(1);
+    }
+    parser_advance(parser);
+    ast_set_comparison_op(cond, op);
+
+    if (op == OP_IN || op == OP_NOT_IN) {
+        parser_expect(parser, TOKEN_LPAREN);
+        parser_advance(parser);
+        for (;;) {
+            ast_add_child(cond, parse_literal(parser));
+            if (parser->current_token.type != TOKEN_COMMA) break;
+            parser_advance(parser);
+        }
+        parser_expect(parser, TOKEN_RPAREN);
+        parser_advance(parser);
+    } else {
+        ast_add_child(cond, parse_literal(parser));
+    }
+
+    return cond;
+}
+
+static ASTNode *parse_condition_unary(Parser *parser) {
+    if (parser->current_token.type == TOKEN_NOT) {
+        parser_advance(parser);
+        ASTNode *node = parser_node(parser, NODE_LOGICAL, "not", NULL, 0);
+        ast_add_child(node, parse_condition_unary(parser));
+        return node;
+    }
+
+    if (parser->current_token.type == TOKEN_LPAREN) {
+        parser_advance(parser);
+        ASTNode *inner = parse_condition(parser);
+        parser_expect(parser, TOKEN_RPAREN);
+        parser_advance(parser);
+        return inner;
+    }
+
+    return parse_comparison(parser);
+}
+
+static ASTNode *parse_condition_and(Parser *parser) {
+    ASTNode *left = parse_condition_unary(parser);
+    while (parser->current_token.type == TOKEN_AND) {
+        parser_advance(parser);
+        ASTNode *node = parser_node(parser, NODE_LOGICAL, "and", NULL, 0);
+        ast_add_child(node, left);
+        ast_add_child(node, parse_condition_unary(parser));
+        left = node;
+    }
+    return left;
+}
+
+/* Predicate with the usual precedence: not > and > or */
+static ASTNode *parse_condition(Parser *parser) {
+    ASTNode *left = parse_condition_and(parser);
+    while (parser->current_token.type == TOKEN_OR) {
+        parser_advance(parser);
+        ASTNode *node = parser_node(parser, NODE_LOGICAL, "or", NULL, 0);
+        ast_add_child(node, left);
+        ast_add_child(node, parse_condition_and(parser));
+        left = node;
+    }
+    return left;
+}
+
+/*
+ * filter <source> where <predicate> [into <target>]
+ *
+ * NODE_FILTER: name is the source, value the target (NULL filters the
+ * source in place), and the single child is the predicate.
+ */
+static ASTNode *parse_filter(Parser *parser) {
+    parser_expect(parser, TOKEN_FILTER);
+    parser_advance(parser);
+
+    char *source = parse_dataset_ref(parser);
+
+    parser_expect(parser, TOKEN_WHERE);
+    parser_advance(parser);
+
+    ASTNode *predicate = parse_condition(parser);
+
+    char *target = NULL;
+    if (parser->current_token.type == TOKEN_INTO) {
+        parser_advance(parser);
+        parser_expect_name(parser);
+        target = parser_text(parser);
+        parser_advance(parser);
+    }
+
+    ASTNode *filter_node = parser_node(parser, NODE_FILTER, source, target, 0);
+    ast_add_child(filter_node, predicate);
+    return filter_node;
+}
+
+/*
+ * sort <source> by|order_by <column> [asc|desc] [limit N] [into <target>]
+ *
+ * NODE_SORT: name is the source, value the target (NULL sorts the
+ * source in place), sort_dir the direction, numeric_value the limit
+ * (0 = all rows) and the single NODE_ROW child names the sort column.
+ */
+static ASTNode *parse_sort(Parser *parser) {
+    parser_expect(parser, TOKEN_SORT);
+    parser_advance(parser);
+
+    char *source = parse_dataset_ref(parser);
+
+    if (parser->current_token.type != TOKEN_ORDER_BY) {
+        parser_expect(parser, TOKEN_BY);
+    }
+    parser_advance(parser);
+
+    parser_expect_name(parser); // sort column
+    ASTNode *column = parser_node(parser, NODE_ROW, parser_text(parser), NULL, 0);
+    parser_advance(parser);
+
+    SortDirection dir = SORT_ASC;
+    if (parser->current_token.type == TOKEN_ASC || parser->current_token.type == TOKEN_DESC) {
+        dir = parser->current_token.type == TOKEN_DESC ? SORT_DESC : SORT_ASC;
+        parser_advance(parser);
+    }
+
+    int limit = 0;
+    if (parser->current_token.type == TOKEN_LIMIT) {
+        parser_advance(parser);
+        parser_expect(parser, TOKEN_NUMBER);
+        limit = parser->current_token.numeric_value;
+        if (limit <= 0) {
+            fprintf(stderr, "Sort limit must be positive at line %d, column %d\n",
+                    parser->current_token.line, parser->current_token.column);
+            exit(1);
+        }
+        parser_advance(parser);
+    }
+
+    char *target = NULL;
+    if (parser->current_token.type == TOKEN_INTO) {
+        parser_advance(parser);
+        parser_expect_name(parser);
+        target = parser_text(parser);
+        parser_advance(parser);
+    }
+
+    ASTNode *sort_node = parser_node(parser, NODE_SORT, source, target, limit);
+    ast_set_sort_direction(sort_node, dir);
+    ast_add_child(sort_node, column);
+    return sort_node;
+}
+
+/*
+ * join <left> with <right> on <column> [inner|left] into <target>
+ *
+ * A left join keeps every left row; a row without a match reads 0 in
+ * Target.<right>, the same as a matched right value of 0.
+ *
+ * NODE_JOIN: name is the left input, value the target, join_type the
+ * kind of join; children are the right input and the key column
+ * (NODE_ROW nodes, by name).
+ */
+static ASTNode *parse_join(Parser *parser) {
+    parser_expect(parser, TOKEN_JOIN);
+    parser_advance(parser);
+
+    char *left = parse_dataset_ref(parser);
+
+    parser_expect(parser, TOKEN_WITH);
+    parser_advance(parser);
+
+    char *right = parse_dataset_ref(parser);
+
+    parser_expect(parser, TOKEN_ON);
+    parser_advance(parser);
+
+    parser_expect_name(parser); // key column
+    char *key = parser_text(parser);
+    parser_advance(parser);
+
+    JoinType type = JOIN_TYPE_INNER;
+    if (parser->current_token.type == TOKEN_INNER || parser->current_token.type == TOKEN_LEFT) {
+        type = parser->current_token.type == TOKEN_LEFT ? JOIN_TYPE_LEFT : JOIN_TYPE_INNER;
+        parser_advance(parser);
+    }
+
+    parser_expect(parser, TOKEN_INTO);
+    parser_advance(parser);
+
+    parser_expect_name(parser); // target dataset
+    ASTNode *join_node = parser_node(parser, NODE_JOIN, left, parser_text(parser), 0);
+    parser_advance(parser);
+
+    ast_set_join_type(join_node, type);
+    ast_add_child(join_node, parser_node(parser, NODE_ROW, right, NULL, 0));
+    ast_add_child(join_node, parser_node(parser, NODE_ROW, key, NULL, 0));
+    return join_node;
+}
+
+/* Number, dataset reference or parenthesized expression */
+static ASTNode *parse_arith_primary(Parser *parser) {
+    if (parser->current_token.type == TOKEN_NUMBER) {
+        ASTNode *number = parser_node(parser, NODE_ROW, NULL, NULL, parser->current_token.numeric_value);
+        ast_set_data_type(number, DATA_TYPE_INT);
+        parser_advance(parser);
+        return number;
+    }
+
+    if (parser->current_token.type == TOKEN_LPAREN) {
+        parser_advance(parser);
+        ASTNode *inner = parse_arith(parser);
+        parser_expect(parser, TOKEN_RPAREN);
+        parser_advance(parser);
+        return inner;
+    }
+
+    char *ref = parse_dataset_ref(parser);
+    ASTNode *operand = parser_node(parser, NODE_ROW, ref, NULL, 0);
+    ast_set_data_type(operand, DATA_TYPE_STRING);
+    return operand;
+}
+
+static ASTNode *parse_arith_unary(Parser *parser) {
+    if (parser->current_token.type == TOKEN_MINUS) {
+        parser_advance(parser);
+        ASTNode *node = parser_node(parser, NODE_OPERATOR, "neg", NULL, 0);
+        ast_add_child(node, parse_arith_unary(parser));
+        return node;
+    }
+    return parse_arith_primary(parser);
+}
+
+static ASTNode *parse_arith_term(Parser *parser) {
+    ASTNode *left = parse_arith_unary(parser);
+    for (;;) {
+        const char *op;
+        switch (parser->current_token.type) {
+            case TOKEN_STAR:    op = "*"; break;
+            case TOKEN_SLASH:   op = "/"; break;
+            case TOKEN_PERCENT: op = "%"; break;
+            default: return left;
+        }
+        parser_advance(parser);
+        ASTNode *node = parser_node(parser, NODE_OPERATOR, op, NULL, 0);
+        ast_add_child(node, left);
+        ast_add_child(node, parse_arith_unary(parser));
+        left = node;
+    }
+}
+
+/* Arithmetic with the usual precedence: unary - > * / % > + - */
+static ASTNode *parse_arith(Parser *parser) {
+    ASTNode *left = parse_arith_term(parser);
+    while (parser->current_token.type == TOKEN_PLUS ||
+           parser->current_token.type == TOKEN_MINUS) {
+        const char *op = parser->current_token.type == TOKEN_PLUS ? "+" : "-";
+        parser_advance(parser);
+        ASTNode *node = parser_node(parser, NODE_OPERATOR, op, NULL, 0);
+        ast_add_child(node, left);
+        ast_add_child(node, parse_arith_term(parser));
+        left = node;
+    }
+    return left;
+}
+
+/*
+ * computed <target> = <expression>
+ *
+ * NODE_COMPUTED_COL: name is the target and the single child is the
+ * expression: NODE_OPERATOR nodes (name "+", "-", "*", "/", "%" or
+ * "neg") over NODE_ROW operands, either dataset references
+ * (DATA_TYPE_STRING, name) or integers (DATA_TYPE_INT, numeric_value).
+ */
+static ASTNode *parse_computed(Parser *parser) {
+    parser_expect(parser, TOKEN_COMPUTED);
+    parser_advance(parser);
+
+    parser_expect_name(parser); // target dataset
+    ASTNode *computed = parser_node(parser, NODE_COMPUTED_COL, parser_text(parser), NULL, 0);
+    parser_advance(parser);
+
+    parser_expect(parser, TOKEN_ASSIGN);
+    parser_advance(parser);
+
+    ast_add_child(computed, parse_arith(parser));
+    return computed;
 }
 
 void parser_init(Parser *parser, Lexer *lexer) {
     parser->lexer = lexer;
+    parser->arena = NULL;
     parser->current_token = lexer_next(lexer);
 }
 
 static ASTNode *parse_function_call(Parser *parser);
 
 ASTNode *parser_parse(Parser *parser) {
-    ASTNode *root = ast_new(NODE_DOCUMENT, NULL, NULL, 0);
+    parser->arena = parser_check_alloc(ast_arena_new());
+    ASTNode *root = parser_node(parser, NODE_DOCUMENT, NULL, NULL, 0);
 
     while (parser->current_token.type != TOKEN_EOF) {
         if (parser->current_token.type == TOKEN_HEADER) {
             ASTNode *header = parse_header(parser);
             ast_add_child(root, header);
         } 
-        else if (parser->current_token.type == TOKEN_IDENTIFIER && 
-                 parser->current_token.lexeme &&
-                 strcmp(parser->current_token.lexeme, "dataset") == 0) {
+        else if (parser->current_token.type == TOKEN_DATASET) {
             ASTNode *dataset = parse_dataset(parser);
             ast_add_child(root, dataset);
         }
@@ -200,15 +691,11 @@ ASTNode *parser_parse(Parser *parser) {
             ASTNode *view = parse_view(parser);
             ast_add_child(root, view);
         }
-        else if (parser->current_token.type == TOKEN_IDENTIFIER && 
-                 parser->current_token.lexeme &&
-                 strcmp(parser->current_token.lexeme, "plot") == 0) {
+        else if (parser->current_token.type == TOKEN_PLOT) {
             ASTNode *plot = parse_plot(parser);
             ast_add_child(root, plot);
         } 
-        else if (parser->current_token.type == TOKEN_IDENTIFIER && 
-                 parser->current_token.lexeme &&
-                 strcmp(parser->current_token.lexeme, "export") == 0) {
+        else if (parser->current_token.type == TOKEN_EXPORT) {
             ASTNode *export_node = parse_export(parser);
             ast_add_child(root, export_node);
         }
@@ -216,11 +703,34 @@ ASTNode *parser_parse(Parser *parser) {
             ASTNode *text_node = parse_text(parser);
             ast_add_child(root, text_node);
         }
+        else if (parser->current_token.type == TOKEN_AGGREGATE) {
+            ASTNode *aggregate = parse_aggregate(parser);
+            ast_add_child(root, aggregate);
+        }
+        else if (parser->current_token.type == TOKEN_FILTER) {
+            ASTNode *filter = parse_filter(parser);
+            ast_add_child(root, filter);
+        }
+        else if (parser->current_token.type == TOKEN_SORT) {
+            ASTNode *sort = parse_sort(parser);
+            ast_add_child(root, sort);
+        }
+        else if (parser->current_token.type == TOKEN_JOIN) {
+            ASTNode *join = parse_join(parser);
+            ast_add_child(root, join);
+        }
+        else if (parser->current_token.type == TOKEN_COMPUTED) {
+            ASTNode *computed = parse_computed(parser);
+            ast_add_child(root, computed);
+        }
         else if (parser->current_token.type == TOKEN_SUM ||
          parser->current_token.type == TOKEN_AVG ||
          parser->current_token.type == TOKEN_MIN ||
          parser->current_token.type == TOKEN_MAX ||
-         parser->current_token.type == TOKEN_COUNT) {
+         parser->current_token.type == TOKEN_COUNT ||
+         parser->current_token.type == TOKEN_STDDEV ||
+         parser->current_token.type == TOKEN_MEDIAN ||
+         parser->current_token.type == TOKEN_PERCENTILE) {
             ASTNode *func_call = parse_function_call(parser);
             ast_add_child(root, func_call);
         }
@@ -237,16 +747,20 @@ ASTNode *parser_parse(Parser *parser) {
 }
 
 static ASTNode *parse_function_call(Parser *parser) {
-    // Current token is one of TOKEN_SUM, TOKEN_AVG, TOKEN_MIN, TOKEN_MAX, TOKEN_COUNT
+    // Current token is an aggregation keyword (sum, avg, ..., percentile)
     TokenType func_type = parser->current_token.type;
     const char *func_name = NULL;
+    AggregationType agg = AGG_SUM;
 
     switch (func_type) {
-        case TOKEN_SUM:   func_name = "sum"; break;
-        case TOKEN_AVG:   func_name = "avg"; break;
-        case TOKEN_MIN:   func_name = "min"; break;
-        case TOKEN_MAX:   func_name = "max"; break;
-        case TOKEN_COUNT: func_name = "count"; break;
+        case TOKEN_SUM:    func_name = "sum";    agg = AGG_SUM; break;
+        case TOKEN_AVG:    func_name = "avg";    agg = AGG_AVG; break;
+        case TOKEN_MIN:    func_name = "min";    agg = AGG_MIN; break;
+        case TOKEN_MAX:    func_name = "max";    agg = AGG_MAX; break;
+        case TOKEN_COUNT:  func_name = "count";  agg = AGG_COUNT; break;
+        case TOKEN_STDDEV: func_name = "stddev"; agg = AGG_STDDEV; break;
+        case TOKEN_MEDIAN: func_name = "median"; agg = AGG_MEDIAN; break;
+        case TOKEN_PERCENTILE: func_name = "percentile"; agg = AGG_PERCENTILE; break;
         default:
             fprintf(stderr, "Unknown aggregation function at line %d, column %d\n",
                     parser->current_token.line, parser->current_token.column);
@@ -255,11 +769,19 @@ static ASTNode *parse_function_call(Parser *parser) {
 
     parser_advance(parser);
 
-    parser_expect(parser, TOKEN_IDENTIFIER); // dataset name
-    char *dataset_name = strdup(parser->current_token.lexeme);
-    parser_advance(parser);
+    char *dataset_name = parse_dataset_ref(parser);
 
-    return ast_new(NODE_FUNCTION_CALL, func_name, dataset_name, 0);
+    // percentile takes the rank (0-100) after the dataset name
+    int rank = 0;
+    if (func_type == TOKEN_PERCENTILE) {
+        parser_expect(parser, TOKEN_NUMBER);
+        rank = parser->current_token.numeric_value;
+        parser_advance(parser);
+    }
+
+    ASTNode *node = parser_node(parser, NODE_FUNCTION_CALL, func_name, dataset_name, rank);
+    ast_set_aggregation(node, agg);
+    return node;
 }
 
 ASTNode *ast_new_function_call(const char *func_name, const char *dataset_name) {
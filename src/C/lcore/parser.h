@@ -8,12 +8,14 @@
 typedef struct {
     Lexer *lexer;
     Token current_token;
+    ASTArena *arena;            /* Holds the tree parser_parse returns */
 } Parser;
 
 /* Initialize parser */
 void parser_init(Parser *parser, Lexer *lexer);
 
-/* Parse the source into an AST */
+/* Parse the source into an AST; the whole tree is allocated in one
+   arena and ast_free on the root releases it */
 ASTNode *parser_parse(Parser *parser);
 
 #endif
@@ -73,19 +73,24 @@ static void print_separator() {
 }
 */
 
-static int get_max_value(ASTNode *chart_data) {
+/* Row i's value as charts draw it (an int, like a dataset block row) */
+static int row_value(const DataSet *ds, size_t i) {
+    return (int)dataset_value(ds, i);
+}
+
+static int get_max_value(const DataSet *chart_data) {
     int max_value = 0;
     if (!chart_data) return 0;
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        if (chart_data->children[i]->numeric_value > max_value)
-            max_value = chart_data->children[i]->numeric_value;
+    for (size_t i = 0; i < chart_data->count; i++) {
+        if (row_value(chart_data, i) > max_value)
+            max_value = row_value(chart_data, i);
     }
     return max_value;
 }
 
 /* ========== BAR CHART (Horizontal) ========== */
-static void render_bar_chart(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count == 0) {
+static void render_bar_chart(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count == 0) {
         printf("  " DIM "(empty data set)" RESET "\n");
         return;
     }
@@ -99,12 +104,11 @@ static void render_bar_chart(ASTNode *chart_data) {
 
     printf(DIM "  Value Distribution\n" RESET);
 
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        ASTNode *row = chart_data->children[i];
-        int val = row->numeric_value;
+    for (size_t i = 0; i < chart_data->count; i++) {
+        int val = row_value(chart_data, i);
         int bar_len = (int)((double)val / max_value * BAR_MAX_LEN);
         
-        printf("  %-*.*s │", (int)TABLE_COL_WIDTH, (int)TABLE_COL_WIDTH, row->name);
+        printf("  %-*.*s │", (int)TABLE_COL_WIDTH, (int)TABLE_COL_WIDTH, dataset_label(chart_data, i));
         
         printf(ACCENT);
         for (int j = 0; j < bar_len; j++) {
@@ -117,8 +121,8 @@ static void render_bar_chart(ASTNode *chart_data) {
 }
 
 /* ========== LINE CHART (Sparkline/Time-series) ========== */
-static void render_line_chart(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count < 2) {
+static void render_line_chart(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count < 2) {
         printf("  " DIM "(needs 2+ data points for a line chart)" RESET "\n");
         return;
     }
@@ -141,12 +145,12 @@ static void render_line_chart(ASTNode *chart_data) {
     }
 
     // Pass 1: Plot the points and draw vertical lines
-    for (size_t x = 0; x < chart_data->child_count; x++) {
-        int val = chart_data->children[x]->numeric_value;
+    for (size_t x = 0; x < chart_data->count; x++) {
+        int val = row_value(chart_data, x);
         int current_y = (int)(val * scale_y); // 0 to CHART_HEIGHT - 1
 
         // Position on the X-axis
-        int plot_x = 7 + (int)((double)x / (chart_data->child_count - 1) * (plot_width - 1));
+        int plot_x = 7 + (int)((double)x / (chart_data->count - 1) * (plot_width - 1));
         
         if (plot_x >= CONSOLE_WIDTH) continue;
         
@@ -197,35 +201,34 @@ static void render_line_chart(ASTNode *chart_data) {
     printf("\n");
 
     printf("       ");
-    int step = chart_data->child_count / 5; 
+    int step = chart_data->count / 5; 
     if (step == 0) step = 1;
-    for (size_t i = 0; i < chart_data->child_count; i += step) {
+    for (size_t i = 0; i < chart_data->count; i += step) {
         // Corrected format specifiers to cast size_t result to int
-        int width = (int)((double)plot_width / (chart_data->child_count / step));
-        printf(" %-*.*s", width, width, chart_data->children[i]->name);
+        int width = (int)((double)plot_width / (chart_data->count / step));
+        printf(" %-*.*s", width, width, dataset_label(chart_data, i));
     }
     printf("\n");
 }
 
 /* ========== PIE CHART (Donut/Ring ASCII Representation) ========== */
-static void render_pie_chart(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count == 0) {
+static void render_pie_chart(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count == 0) {
         printf("  " DIM "(empty data set)" RESET "\n");
         return;
     }
 
     int total = 0;
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        total += chart_data->children[i]->numeric_value;
+    for (size_t i = 0; i < chart_data->count; i++) {
+        total += row_value(chart_data, i);
     }
 
     if (total == 0) return;
 
     printf(DIM "  Share of Total (n=%d)\n" RESET, total);
 
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        ASTNode *row = chart_data->children[i];
-        double percent = (double)row->numeric_value / total * 100.0;
+    for (size_t i = 0; i < chart_data->count; i++) {
+        double percent = (double)row_value(chart_data, i) / total * 100.0;
         int bar_width = (int)(percent / 4);
         if (bar_width > 25) bar_width = 25;
 
@@ -238,13 +241,13 @@ static void render_pie_chart(ASTNode *chart_data) {
         printf(" %5.1f%% │ %-*.*s\n", percent, 
             (int)(CONSOLE_WIDTH - 15 - bar_width), 
             (int)(CONSOLE_WIDTH - 15 - bar_width),
-            row->name);
+            dataset_label(chart_data, i));
     }
 }
 
 /* ========== TABLE CHART (Clean Grid) ========== */
-static void render_table_chart(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count == 0) {
+static void render_table_chart(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count == 0) {
         printf("  " DIM "(empty data set)" RESET "\n");
         return;
     }
@@ -268,13 +271,12 @@ static void render_table_chart(ASTNode *chart_data) {
     for (int i = 0; i < value_col_width; i++) printf("─");
     printf("┤\n" RESET);
 
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        ASTNode *row = chart_data->children[i];
+    for (size_t i = 0; i < chart_data->count; i++) {
         printf("  │ %-*.*s │ %10d │\n", 
                label_col_width - 2, 
                label_col_width - 2, 
-               row->name, 
-               row->numeric_value);
+               dataset_label(chart_data, i), 
+               row_value(chart_data, i));
     }
 
     printf(ACCENT "  └");
@@ -285,8 +287,8 @@ static void render_table_chart(ASTNode *chart_data) {
 }
 
 /* ========== HISTOGRAM (Vertical Bar Distribution) ========== */
-static void render_histogram(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count == 0) {
+static void render_histogram(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count == 0) {
         printf("  " DIM "(empty data set)" RESET "\n");
         return;
     }
@@ -301,9 +303,8 @@ static void render_histogram(ASTNode *chart_data) {
     for (int h = max_height - 1; h >= 0; h--) {
         printf("  %4d │ ", (int)((double)(h + 1) / max_height * max_value));
         
-        for (size_t i = 0; i < chart_data->child_count; i++) {
-            ASTNode *row = chart_data->children[i];
-            int bar_height = (int)((double)row->numeric_value / max_value * max_height);
+        for (size_t i = 0; i < chart_data->count; i++) {
+            int bar_height = (int)((double)row_value(chart_data, i) / max_value * max_height);
             
             if (bar_height > h) {
                 printf(ACCENT BLOCK_FULL RESET);
@@ -316,23 +317,22 @@ static void render_histogram(ASTNode *chart_data) {
 
     // X-axis
     printf("       └");
-    for (size_t i = 0; i < chart_data->child_count; i++) {
+    for (size_t i = 0; i < chart_data->count; i++) {
         printf("─");
     }
     printf("\n");
 
     // Labels - one char per column
     printf("         ");
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        ASTNode *row = chart_data->children[i];
-        printf("%.*s", 1, row->name);
+    for (size_t i = 0; i < chart_data->count; i++) {
+        printf("%.*s", 1, dataset_label(chart_data, i));
     }
     printf("\n");
 }
 
 /* ========== SCATTER PLOT (Simple Point Grid) ========== */
-static void render_scatter_plot(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count < 2) {
+static void render_scatter_plot(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count < 2) {
         printf("  " DIM "(needs 2+ points)" RESET "\n");
         return;
     }
@@ -349,8 +349,8 @@ static void render_scatter_plot(ASTNode *chart_data) {
         int value_at_y = (int)((double)(y + 1) / height * max_value);
         printf("%5d │", value_at_y);
 
-        for (size_t x = 0; x < chart_data->child_count; x++) {
-            int val = chart_data->children[x]->numeric_value;
+        for (size_t x = 0; x < chart_data->count; x++) {
+            int val = row_value(chart_data, x);
             int point_y = (int)((double)val / max_value * height);
             
             // Removed unused 'plot_x' variable
@@ -367,57 +367,55 @@ static void render_scatter_plot(ASTNode *chart_data) {
     // Axes
     printf("      └");
     // Corrected sign comparison warning by casting to int
-    for (int i = 0; i < (int)chart_data->child_count; i++) printf("─");
+    for (int i = 0; i < (int)chart_data->count; i++) printf("─");
     printf("\n");
 
     // X-axis labels (one char per point)
     printf("       ");
-    for (size_t i = 0; i < chart_data->child_count; i++) {
-        printf("%c", chart_data->children[i]->name[0]);
+    for (size_t i = 0; i < chart_data->count; i++) {
+        printf("%c", dataset_label(chart_data, i)[0]);
     }
     printf("\n");
 
     // Values row
     printf("       ");
-    for (size_t i = 0; i < chart_data->child_count; i++) {
+    for (size_t i = 0; i < chart_data->count; i++) {
         char val_str[16];
-        snprintf(val_str, sizeof(val_str), "%d", chart_data->children[i]->numeric_value);
+        snprintf(val_str, sizeof(val_str), "%d", row_value(chart_data, i));
         printf("%c", val_str[0]);
     }
     printf("\n");
 }
 
 /* ========== KPI Component (Key Performance Indicator) ========== */
-static void render_kpi(ASTNode *chart_data) {
-    if (!chart_data || chart_data->child_count == 0) {
+static void render_kpi(const DataSet *chart_data) {
+    if (!chart_data || chart_data->count == 0) {
         printf("  " DIM "(empty data set)" RESET "\n");
         return;
     }
 
-    ASTNode *main_kpi = chart_data->children[0];
-    int main_value = main_kpi->numeric_value;
-    const char *label = main_kpi->name ? main_kpi->name : "Metric";
+    int main_value = row_value(chart_data, 0);
+    const char *label = dataset_label(chart_data, 0);
 
     printf("  " DIM "Value of %s\n" RESET, label);
     printf("  " BOLD ACCENT "%.*s" RESET, (int)TABLE_COL_WIDTH, label);
     printf(BOLD " %d\n" RESET, main_value);
 
-    if (chart_data->child_count > 1) {
-        ASTNode *comp_kpi = chart_data->children[1];
-        int comp_value = comp_kpi->numeric_value;
+    if (chart_data->count > 1) {
+        int comp_value = row_value(chart_data, 1);
         int diff = main_value - comp_value;
         double percent_change = (comp_value != 0) ? ((double)diff / comp_value * 100.0) : 0.0;
 
         const char *color = (diff >= 0) ? POSITIVE : NEGATIVE;
         const char *arrow = (diff >= 0) ? ARROW_UP : ARROW_DOWN;
 
-        printf("  " DIM "vs. %s: " RESET, comp_kpi->name ? comp_kpi->name : "Previous");
+        printf("  " DIM "vs. %s: " RESET, dataset_label(chart_data, 1));
         printf("%s%s %d (%+.1f%%)" RESET "\n", color, arrow, abs(diff), percent_change);
     }
 }
 
 /* ========== MAIN CHART RENDERER ========== */
-void render_chart(ASTNode *chart_node, ASTNode *data_node) {
+void render_chart(ASTNode *chart_node, const DataSet *data_node) {
     if (!chart_node || !data_node) {
         printf("  " DIM "(invalid chart definition)" RESET "\n");
         return;
@@ -459,19 +457,18 @@ void render_chart(ASTNode *chart_node, ASTNode *data_node) {
 
 /* ========== LEGACY FUNCTIONS - Simplified into Frame + Data List ========== */
 
-void render_dataset(ASTNode *dataset) {
+void render_dataset(const DataSet *dataset, const char *title) {
     if (!dataset) return;
     
-    print_frame_header(dataset->value ? dataset->value : "Dataset", "Raw Data");
+    print_frame_header(title ? title : dataset->title, "Raw Data");
     
     int max_value = get_max_value(dataset);
 
-    for (size_t i = 0; i < dataset->child_count; i++) {
-        ASTNode *row = dataset->children[i];
-        int val = row->numeric_value;
+    for (size_t i = 0; i < dataset->count; i++) {
+        int val = row_value(dataset, i);
         int bar_len = max_value > 0 ? (int)((double)val / max_value * 35) : 0;
         
-        printf("  %-16s │", row->name);
+        printf("  %-16s │", dataset_label(dataset, i));
         for (int j = 0; j < bar_len; j++) printf(ACCENT BLOCK_FULL RESET);
         printf(DIM " %8d\n" RESET, val);
     }
@@ -2,9 +2,16 @@
 #define RENDER_H
 
 #include "ast.h"
+#include "core/dataset.h"
 
-/* Render the AST to terminal */
-void render_dataset(ASTNode *node);
+/* Render the AST to terminal. Chart and dataset rows are read in place
+   from a (read-only) DataSet, so rendering copies nothing. */
+
+/* A plot node (name: title, value: chart type) over the rows of 'data' */
+void render_chart(ASTNode *chart_node, const DataSet *data);
+
+/* The rows of a dataset block; 'title' NULL uses the dataset's own */
+void render_dataset(const DataSet *ds, const char *title);
 
 void render_view(ASTNode *node);
 void render_text(ASTNode *node);
@@ -0,0 +1,558 @@
+#include "script_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "core/dataset.h"
+#include "data_processing/dp_cache.h"
+
+#define SCRIPT_CACHE_MAGIC "LCSCRIPT"
+#define SCRIPT_CACHE_VERSION 1
+#define SCRIPT_CACHE_BYTE_ORDER 0x01020304u
+#define SCRIPT_CACHE_NO_STRING UINT32_MAX
+
+/* NodeType values are written as they are, so a build with a different
+   set of node types must not read the file */
+#define SCRIPT_CACHE_NODE_TYPES ((uint32_t)NODE_OPERATOR + 1)
+
+/*
+ * File layout: header, the node records, the dataset directory, the
+ * string table and the data section holding the datasets' rows.
+ *
+ * Nodes are stored breadth-first, so the children of every node are
+ * consecutive records and the tree is rebuilt as one node array with
+ * no per-node allocation: the first child of record i follows the
+ * children of all records before it. String references are offsets
+ * into the string table, row arrays offsets into the data section.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_len;
+    uint64_t source_hash[2];
+    uint32_t node_types;
+    uint32_t node_count;
+    uint32_t dataset_count;
+    uint32_t reserved;
+    uint64_t checksum;          /* Of the four sections, see script_checksum */
+    uint64_t strings_offset;
+    uint64_t strings_len;
+    uint64_t data_offset;
+    uint64_t data_len;
+} ScriptCacheHeader;
+
+typedef struct {
+    double float_value;
+    uint8_t type;
+    uint8_t data_type;
+    uint8_t agg_type;
+    uint8_t comparison_op;
+    uint8_t sort_dir;
+    uint8_t join_type;
+    uint8_t reserved[2];
+    uint32_t name;              /* String offset, or SCRIPT_CACHE_NO_STRING */
+    uint32_t value;
+    int32_t numeric_value;
+    uint32_t child_count;
+    int32_t line;
+    int32_t column;
+} ScriptCacheNode;
+
+/* Rows of one dataset block: 'rows' int64 values, 'rows' uint64 label
+   offsets and the NUL-terminated labels, all in the data section */
+typedef struct {
+    uint32_t name;
+    uint32_t title;
+    uint64_t rows;
+    uint64_t values;
+    uint64_t label_offsets;
+    uint64_t labels;
+    uint64_t labels_len;
+} ScriptCacheDataset;
+
+/* ========== Keys ========== */
+
+/* Two independent word-at-a-time 64-bit hashes of the script text */
+static void script_hash(const char *source, size_t len, uint64_t out[2]) {
+    uint64_t a = 14695981039346656037ULL;
+    uint64_t b = 0x9e3779b97f4a7c15ULL ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, source + i, 8);
+        a = (a ^ w) * 1099511628211ULL;
+        a ^= a >> 29;
+        b = (b + w) * 0xff51afd7ed558ccdULL;
+        b ^= b >> 32;
+    }
+    for (; i < len; i++) {
+        a = (a ^ (unsigned char)source[i]) * 1099511628211ULL;
+        b = (b + (unsigned char)source[i]) * 0xff51afd7ed558ccdULL;
+        b ^= b >> 32;
+    }
+    out[0] = a;
+    out[1] = b;
+}
+
+/* Checked on load only with LCORE_CACHE_VERIFY=1, as for the data cache */
+static int script_cache_verify_enabled(void) {
+    const char *env = getenv("LCORE_CACHE_VERIFY");
+    return env && strcmp(env, "1") == 0;
+}
+
+static uint64_t script_checksum(const char *nodes, size_t nodes_len, const char *datasets, size_t datasets_len,
+                                const char *strings, size_t strings_len, const char *data, size_t data_len) {
+    const char *parts[4] = { nodes, datasets, strings, data };
+    size_t lens[4] = { nodes_len, datasets_len, strings_len, data_len };
+    uint64_t sum = 0;
+    for (int i = 0; i < 4; i++) {
+        uint64_t hash[2];
+        script_hash(parts[i], lens[i], hash);
+        sum = sum * 1099511628211ULL + hash[0];
+    }
+    return sum;
+}
+
+static int script_cache_path(const uint64_t hash[2], char *out, size_t cap) {
+    char dir[PATH_MAX];
+    if (dp_cache_dir(dir, sizeof(dir)) != 0) return -1;
+    int n = snprintf(out, cap, "%s/%016llx%016llx.lcs", dir,
+                     (unsigned long long)hash[0], (unsigned long long)hash[1]);
+    return n > 0 && (size_t)n < cap ? 0 : -1;
+}
+
+/* ========== Writing ========== */
+
+/* Growable byte buffer for one section; 'failed' sticks once set */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} ScriptBuffer;
+
+/* Room for n more bytes */
+static int buffer_reserve(ScriptBuffer *b, size_t n) {
+    if (b->failed) return -1;
+    if (b->len + n <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) {
+        b->failed = 1;
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+/* Append n bytes as they are; returns their offset */
+static size_t buffer_append(ScriptBuffer *b, const void *p, size_t n) {
+    if (buffer_reserve(b, n) != 0) return 0;
+    size_t at = b->len;
+    if (n) memcpy(b->data + at, p, n);
+    b->len += n;
+    return at;
+}
+
+/* Same, at the next 8-byte aligned offset */
+static size_t buffer_put(ScriptBuffer *b, const void *p, size_t n) {
+    static const char zeros[8];
+    buffer_append(b, zeros, (8 - (b->len & 7)) & 7);
+    return buffer_append(b, p, n);
+}
+
+typedef struct {
+    ScriptBuffer nodes;
+    ScriptBuffer datasets;
+    ScriptBuffer strings;
+    ScriptBuffer data;
+    uint32_t node_count;
+    uint32_t dataset_count;
+} ScriptWriter;
+
+static uint32_t writer_string(ScriptWriter *w, const char *s) {
+    if (!s) return SCRIPT_CACHE_NO_STRING;
+    size_t n = strlen(s) + 1;
+    if (w->strings.len + n >= SCRIPT_CACHE_NO_STRING) w->strings.failed = 1;
+    size_t at = buffer_append(&w->strings, s, n);
+    return w->strings.failed ? SCRIPT_CACHE_NO_STRING : (uint32_t)at;
+}
+
+static void writer_record(ScriptWriter *w, const ASTNode *node) {
+    ScriptCacheNode rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.float_value = node->float_value;
+    rec.type = (uint8_t)node->type;
+    rec.data_type = (uint8_t)node->data_type;
+    rec.agg_type = (uint8_t)node->agg_type;
+    rec.comparison_op = (uint8_t)node->comparison_op;
+    rec.sort_dir = (uint8_t)node->sort_dir;
+    rec.join_type = (uint8_t)node->join_type;
+    rec.name = writer_string(w, node->name);
+    rec.value = writer_string(w, node->value);
+    rec.numeric_value = node->numeric_value;
+    rec.child_count = (uint32_t)node->child_count;
+    rec.line = node->line;
+    rec.column = node->column;
+    buffer_put(&w->nodes, &rec, sizeof(rec));
+}
+
+/* Every node of the tree, breadth-first */
+static void writer_tree(ScriptWriter *w, const ASTNode *root) {
+    size_t count = 1, cap = 1024;
+    const ASTNode **order = malloc(cap * sizeof(*order));
+    if (!order) {
+        w->nodes.failed = 1;
+        return;
+    }
+    order[0] = root;
+    for (size_t i = 0; i < count && !w->nodes.failed; i++) {
+        const ASTNode *node = order[i];
+        if (node->child_count >= UINT32_MAX - count) {
+            w->nodes.failed = 1;
+            break;
+        }
+        if (count + node->child_count > cap) {
+            while (cap < count + node->child_count) cap *= 2;
+            const ASTNode **grown = realloc(order, cap * sizeof(*order));
+            if (!grown) {
+                w->nodes.failed = 1;
+                break;
+            }
+            order = grown;
+        }
+        for (size_t c = 0; c < node->child_count; c++) order[count++] = node->children[c];
+        writer_record(w, node);
+    }
+    w->node_count = (uint32_t)count;
+    free(order);
+}
+
+/* The rows a dataset block registered, flattened (the registry may
+   have compressed them) */
+static void writer_dataset(ScriptWriter *w, const char *name, const DataSet *ds) {
+    ScriptCacheDataset rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.name = writer_string(w, name);
+    rec.title = writer_string(w, ds->title);
+    rec.rows = ds->count;
+
+    ScriptBuffer *b = &w->data;
+    rec.values = buffer_put(b, NULL, 0);
+    for (size_t i = 0; i < ds->count; i++) {
+        int64_t v = dataset_value(ds, i);
+        buffer_put(b, &v, sizeof(v));
+    }
+    rec.label_offsets = buffer_put(b, NULL, 0);
+    uint64_t used = 0;
+    for (size_t i = 0; i < ds->count; i++) {
+        buffer_put(b, &used, sizeof(used));
+        used += strlen(dataset_label(ds, i)) + 1;
+    }
+    rec.labels = buffer_put(b, NULL, 0);
+    for (size_t i = 0; i < ds->count; i++) {
+        const char *label = dataset_label(ds, i);
+        buffer_append(b, label, strlen(label) + 1);
+    }
+    rec.labels_len = used;
+
+    buffer_put(&w->datasets, &rec, sizeof(rec));
+    w->dataset_count++;
+}
+
+static void writer_free(ScriptWriter *w) {
+    free(w->nodes.data);
+    free(w->datasets.data);
+    free(w->strings.data);
+    free(w->data.data);
+}
+
+int script_cache_store(const char *source, size_t len, const ASTNode *root) {
+    if (!source || !root) return -1;
+
+    ScriptCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    script_hash(source, len, h.source_hash);
+    char path[PATH_MAX];
+    if (script_cache_path(h.source_hash, path, sizeof(path)) != 0) return -1;
+
+    ScriptWriter w;
+    memset(&w, 0, sizeof(w));
+    writer_tree(&w, root);
+    for (size_t i = 0; i < root->child_count; i++) {
+        const ASTNode *child = root->children[i];
+        if (child->type != NODE_DATASET || !child->name) continue;
+        const DataSet *ds = dataset_registry_get(child->name);
+        if (ds) writer_dataset(&w, child->name, ds);
+    }
+
+    int rc = w.nodes.failed || w.datasets.failed || w.strings.failed || w.data.failed ? -1 : 0;
+
+    memcpy(h.magic, SCRIPT_CACHE_MAGIC, 8);
+    h.version = SCRIPT_CACHE_VERSION;
+    h.byte_order = SCRIPT_CACHE_BYTE_ORDER;
+    h.source_len = len;
+    h.node_types = SCRIPT_CACHE_NODE_TYPES;
+    h.node_count = w.node_count;
+    h.dataset_count = w.dataset_count;
+    h.strings_offset = sizeof(h) + w.nodes.len + w.datasets.len;
+    h.strings_len = w.strings.len;
+    h.data_offset = (h.strings_offset + w.strings.len + 7) & ~(uint64_t)7;
+    h.data_len = w.data.len;
+    if (rc == 0) {
+        h.checksum = script_checksum(w.nodes.data, w.nodes.len, w.datasets.data, w.datasets.len,
+                                     w.strings.data, w.strings.len, w.data.data, w.data.len);
+    }
+
+    /* Write to a temporary file and rename it over the entry, so a
+       reader never sees half a file */
+    char tmp[PATH_MAX];
+    FILE *f = NULL;
+    if (rc == 0) {
+        int n = snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+        f = n > 0 && (size_t)n < sizeof(tmp) ? fopen(tmp, "wb") : NULL;
+        if (!f) rc = -1;
+    }
+    if (f) {
+        static const char zeros[8];
+        size_t pad = (size_t)(h.data_offset - (h.strings_offset + w.strings.len));
+        if (fwrite(&h, sizeof(h), 1, f) != 1 ||
+            fwrite(w.nodes.data, 1, w.nodes.len, f) != w.nodes.len ||
+            fwrite(w.datasets.data, 1, w.datasets.len, f) != w.datasets.len ||
+            fwrite(w.strings.data, 1, w.strings.len, f) != w.strings.len ||
+            fwrite(zeros, 1, pad, f) != pad ||
+            fwrite(w.data.data, 1, w.data.len, f) != w.data.len) {
+            rc = -1;
+        }
+        if (fclose(f) != 0) rc = -1;
+        if (rc == 0 && rename(tmp, path) != 0) rc = -1;
+        if (rc != 0) unlink(tmp);
+    }
+
+    writer_free(&w);
+    return rc;
+}
+
+/* ========== Reading ========== */
+
+typedef struct {
+    const ScriptCacheHeader *header;
+    const ScriptCacheNode *nodes;
+    const ScriptCacheDataset *datasets;
+    const char *data;
+    char *strings;              /* The string table, copied into the arena */
+    ASTArena *arena;
+} ScriptReader;
+
+/* String at 'offset', or NULL; 0 if the offset is out of range */
+static int reader_string(const ScriptReader *r, uint32_t offset, const char **out) {
+    if (offset == SCRIPT_CACHE_NO_STRING) {
+        *out = NULL;
+        return 1;
+    }
+    if (offset >= r->header->strings_len) return 0;
+    *out = r->strings + offset;
+    return 1;
+}
+
+/* The whole tree in one node array, or NULL if the records do not form
+   a tree. Node i + 1 is the i-th child in breadth-first order, so one
+   pointer table serves as every node's children array. */
+static ASTNode *reader_tree(ScriptReader *r) {
+    uint32_t count = r->header->node_count;
+    ASTNode *nodes = ast_arena_nodes(r->arena, count);
+    ASTNode **kids = ast_arena_alloc(r->arena, (count > 1 ? count - 1 : 1) * sizeof(ASTNode *));
+    if (!nodes || !kids) return NULL;
+    for (uint32_t i = 1; i < count; i++) kids[i - 1] = &nodes[i];
+
+    uint32_t next = 1;          /* Record of the next node's first child */
+    for (uint32_t i = 0; i < count; i++) {
+        const ScriptCacheNode *rec = &r->nodes[i];
+        ASTNode *node = &nodes[i];
+        if (rec->type >= SCRIPT_CACHE_NODE_TYPES || rec->child_count > count - next ||
+            !reader_string(r, rec->name, &node->name) || !reader_string(r, rec->value, &node->value)) {
+            return NULL;
+        }
+        node->type = (NodeType)rec->type;
+        node->numeric_value = rec->numeric_value;
+        node->float_value = rec->float_value;
+        node->data_type = (DataType)rec->data_type;
+        node->agg_type = (AggregationType)rec->agg_type;
+        node->comparison_op = (ComparisonOp)rec->comparison_op;
+        node->sort_dir = (SortDirection)rec->sort_dir;
+        node->join_type = (JoinType)rec->join_type;
+        node->line = rec->line;
+        node->column = rec->column;
+        if (rec->child_count > 0) {
+            node->children = kids + (next - 1);
+            node->child_count = rec->child_count;
+            node->child_capacity = rec->child_count;
+            next += rec->child_count;
+        }
+    }
+    return next == count ? nodes : NULL;
+}
+
+/* A heap DataSet with the rows of dataset record 'rec', or NULL if the
+   record is damaged */
+static DataSet *reader_dataset(const ScriptReader *r, const ScriptCacheDataset *rec, const char **name) {
+    const char *title;
+    uint64_t data_len = r->header->data_len;
+    uint64_t rows = rec->rows;
+    if (!reader_string(r, rec->name, name) || !*name ||
+        !reader_string(r, rec->title, &title) || !title ||
+        rows > data_len / 16 ||
+        rec->values > data_len - rows * 8 ||
+        rec->label_offsets > data_len - rows * 8 ||
+        rec->labels > data_len || rec->labels_len > data_len - rec->labels ||
+        (rows > 0 && (rec->labels_len == 0 || r->data[rec->labels + rec->labels_len - 1] != '\0'))) {
+        return NULL;
+    }
+
+    DataSet *ds = malloc(sizeof(DataSet));
+    if (!ds) return NULL;
+    dataset_init(ds, title);
+    if (dataset_reserve(ds, (size_t)rows, (size_t)rec->labels_len) != 0) {
+        dataset_release(ds);
+        return NULL;
+    }
+
+    const char *offsets = r->data + rec->label_offsets;
+    for (size_t i = 0; i < rows; i++) {
+        uint64_t offset;
+        memcpy(&offset, offsets + i * 8, 8);
+        if (offset >= rec->labels_len) {
+            dataset_release(ds);
+            return NULL;
+        }
+        ds->label_offsets[i] = (size_t)offset;
+    }
+    memcpy(ds->values, r->data + rec->values, (size_t)rows * sizeof(int64_t));
+    memcpy(ds->label_arena, r->data + rec->labels, (size_t)rec->labels_len);
+    ds->arena_used = (size_t)rec->labels_len;
+    ds->count = (size_t)rows;
+    return ds;
+}
+
+/* Map the entry for this hash and check that it is whole and was
+   written for this text by a compatible build */
+static const ScriptCacheHeader *script_cache_open(const uint64_t hash[2], size_t source_len, size_t *map_len) {
+    char path[PATH_MAX];
+    if (script_cache_path(hash, path, sizeof(path)) != 0) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ScriptCacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;      /* Everything is read once, front to back */
+#endif
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    size_t len = (size_t)st.st_size;
+    const ScriptCacheHeader *h = map;
+    uint64_t tables = (uint64_t)h->node_count * sizeof(ScriptCacheNode) +
+                      (uint64_t)h->dataset_count * sizeof(ScriptCacheDataset);
+    int ok = memcmp(h->magic, SCRIPT_CACHE_MAGIC, 8) == 0 &&
+             h->version == SCRIPT_CACHE_VERSION &&
+             h->byte_order == SCRIPT_CACHE_BYTE_ORDER &&
+             h->node_types == SCRIPT_CACHE_NODE_TYPES &&
+             h->source_len == source_len &&
+             h->source_hash[0] == hash[0] && h->source_hash[1] == hash[1] &&
+             h->node_count > 0 &&
+             h->strings_offset == sizeof(*h) + tables &&
+             h->strings_offset <= len && h->strings_len <= len - h->strings_offset &&
+             (h->strings_len == 0 || ((const char *)map)[h->strings_offset + h->strings_len - 1] == '\0') &&
+             h->data_offset >= h->strings_offset + h->strings_len &&
+             h->data_offset <= len && h->data_len <= len - h->data_offset;
+    if (ok && script_cache_verify_enabled()) {
+        const char *base = map;
+        size_t nodes_len = (size_t)h->node_count * sizeof(ScriptCacheNode);
+        ok = h->checksum == script_checksum(base + sizeof(*h), nodes_len,
+                                            base + sizeof(*h) + nodes_len,
+                                            (size_t)h->dataset_count * sizeof(ScriptCacheDataset),
+                                            base + h->strings_offset, (size_t)h->strings_len,
+                                            base + h->data_offset, (size_t)h->data_len);
+    }
+    if (!ok) {
+        munmap(map, len);
+        return NULL;
+    }
+    *map_len = len;
+    return h;
+}
+
+ASTNode *script_cache_load(const char *source, size_t len) {
+    if (!source) return NULL;
+    uint64_t hash[2];
+    script_hash(source, len, hash);
+
+    size_t map_len;
+    const ScriptCacheHeader *h = script_cache_open(hash, len, &map_len);
+    if (!h) return NULL;
+
+    ScriptReader r;
+    memset(&r, 0, sizeof(r));
+    r.header = h;
+    r.nodes = (const ScriptCacheNode *)(h + 1);
+    r.datasets = (const ScriptCacheDataset *)(r.nodes + h->node_count);
+    r.data = (const char *)h + h->data_offset;
+    r.arena = ast_arena_new();
+
+    /* One copy of the string table backs every name and value */
+    ASTNode *root = NULL;
+    if (r.arena) {
+        r.strings = ast_arena_alloc(r.arena, h->strings_len ? (size_t)h->strings_len : 1);
+        if (r.strings) {
+            memcpy(r.strings, (const char *)h + h->strings_offset, (size_t)h->strings_len);
+            root = reader_tree(&r);
+        }
+    }
+    if (!root) {
+        ast_arena_free(r.arena);
+        munmap((void *)h, map_len);
+        return NULL;
+    }
+
+    /* Build every dataset before registering any, so a damaged entry
+       leaves the registry as it was and the script is parsed instead */
+    DataSet **sets = calloc(h->dataset_count ? h->dataset_count : 1, sizeof(DataSet *));
+    const char **names = calloc(h->dataset_count ? h->dataset_count : 1, sizeof(char *));
+    int ok = sets && names;
+    for (uint32_t i = 0; ok && i < h->dataset_count; i++) {
+        sets[i] = reader_dataset(&r, &r.datasets[i], &names[i]);
+        ok = sets[i] != NULL;
+    }
+    if (ok) {
+        for (uint32_t i = 0; i < h->dataset_count; i++) {
+            if (dataset_registry_add(names[i], sets[i]) != 0) {
+                fprintf(stderr, "Failed to register dataset '%s'\n", names[i]);
+                dataset_release(sets[i]);
+            }
+        }
+    } else {
+        for (uint32_t i = 0; sets && i < h->dataset_count; i++) dataset_release(sets[i]);
+        ast_arena_free(r.arena);
+        root = NULL;
+    }
+
+    free(sets);
+    free(names);
+    munmap((void *)h, map_len);
+    return root;
+}
@@ -0,0 +1,34 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include <stddef.h>
+#include "ast.h"
+
+/*
+ * Compiled script cache.
+ *
+ * A parsed script is saved as its AST, flattened, plus an inline copy
+ * of every dataset block's rows. The file is named after a 128-bit hash
+ * of the script's text. Running the same text again maps that file and
+ * rebuilds the tree and the datasets from it without lexing or parsing.
+ *
+ * Files share the directory of the data cache (see dp_cache.h):
+ * $LCORE_CACHE_DIR, else $XDG_CACHE_HOME/lcore, else ~/.cache/lcore.
+ * LCORE_CACHE=0 turns both off.
+ */
+
+/*
+ * The compiled form of 'source' (len bytes of script text), or NULL on
+ * a miss. On a hit the script's dataset blocks are registered just as
+ * parsing would have, and the tree is freed with ast_free.
+ */
+ASTNode *script_cache_load(const char *source, size_t len);
+
+/*
+ * Save 'root', the freshly parsed tree of 'source', together with the
+ * rows its dataset blocks registered. Call it before running anything
+ * that changes the registry. Returns 0, or -1 if nothing was written.
+ */
+int script_cache_store(const char *source, size_t len, const ASTNode *root);
+
+#endif
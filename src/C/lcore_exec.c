@@ -5,37 +5,505 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
+#include <inttypes.h>
 
 /* Project headers */
 #include "core/dataset.h"
+#include "core/groupby.h"
+#include "core/filter.h"
+#include "core/sort.h"
+#include "core/join.h"
+#include "core/expr.h"
 #include "lcore/lexer.h"
 #include "lcore/parser.h"
 #include "lcore/ast.h"
 #include "lcore/render.h"
+#include "lcore/script_cache.h"
 
-/* Forward declaration - defined in render.h */
-void render_chart(ASTNode *chart_node, ASTNode *data_node);
+/* ========== Dataset References ========== */
 
-/* ========== Helper: Convert DataSet to AST ========== */
-/**
- * Convert a DataSet from registry into an AST NODE_DATASET
- * This creates temporary AST nodes for chart rendering
+/*
+ * Resolve "Name" or "Name.column". Registered datasets are returned as
+ * they are; a column reference yields a new view of that column, which
+ * the caller must release (*owned is set to 1). NULL if nothing matches.
  */
-static ASTNode *dataset_to_ast(const DataSet *ds, const char *name) {
-    if (!ds) return NULL;
+static DataSet *resolve_dataset(const char *ref, int *owned) {
+    *owned = 0;
 
-    ASTNode *data = ast_new(NODE_DATASET, name, ds->title, 0);
+    DataSet *ds = dataset_registry_get(ref);
+    if (ds) return ds;
 
-    /* Iterate through dataset rows using the known structure */
-    for (size_t i = 0; i < ds->count; i++) {
-        ASTNode *row = ast_new(NODE_ROW, 
-                              ds->labels[i],    /* label from labels array */
-                              NULL,
-                              ds->values[i]);   /* value from values array */
-        ast_add_child(data, row);
+    const char *dot = strchr(ref, '.');
+    char name[DATASET_MAX_TITLE];
+    if (!dot || (size_t)(dot - ref) >= sizeof(name)) return NULL;
+
+    memcpy(name, ref, dot - ref);
+    name[dot - ref] = '\0';
+    ds = dataset_registry_get(name);
+
+    int column = ds ? dataset_find_column(ds, dot + 1) : -1;
+    if (column < 0) return NULL;
+
+    DataSet *view = dataset_column_view(ds, (size_t)column, ds->title);
+    if (view) *owned = 1;
+    return view;
+}
+
+/* Register a derived dataset under 'target', or rebind 'source' to it */
+static void register_result(const char *source, const char *target, DataSet *ds) {
+    int rc;
+    if (target) {
+        rc = dataset_registry_add(target, ds);
+    } else if (strchr(source, '.')) {
+        fprintf(stderr, "Error: '%s' is a column; give the result a name with 'into'\n", source);
+        rc = -1;
+    } else {
+        rc = dataset_registry_replace(source, ds);
+    }
+
+    if (rc != 0) {
+        fprintf(stderr, "Failed to register dataset '%s'\n", target ? target : source);
+        dataset_release(ds);
+    }
+}
+
+/* ========== Aggregation ========== */
+
+/* One fused pass serves the whole run of statements on this dataset */
+static const DataSetStats *agg_cache_stats(LCoreAggCache *cache, const DataSet *ds) {
+    if (cache->ds != ds) {
+        dataset_stats(ds, &cache->stats);
+        cache->ds = ds;
     }
+    return &cache->stats;
+}
+
+void lcore_exec_function_call(const ASTNode *node, LCoreAggCache *cache) {
+    /* Function calls have:
+       - name: function name (e.g., "sum", "avg", "min", "max", "count")
+       - value: dataset name
+       - numeric_value: rank, for "percentile"
+    */
+
+    int owned;
+    DataSet *ds = resolve_dataset(node->value, &owned);
+    if (!ds) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", node->value);
+        return;
+    }
+
+    /* Column views are rebuilt per statement, so they get their own cache */
+    LCoreAggCache local = { 0 };
+    if (owned) cache = &local;
+
+    if (strcmp(node->name, "sum") == 0) {
+        printf("Sum(%s) = %" PRId64 "\n", node->value, agg_cache_stats(cache, ds)->sum);
+    } 
+    else if (strcmp(node->name, "avg") == 0) {
+        printf("Avg(%s) = %.2f\n", node->value, agg_cache_stats(cache, ds)->mean);
+    } 
+    else if (strcmp(node->name, "min") == 0) {
+        printf("Min(%s) = %" PRId64 "\n", node->value, agg_cache_stats(cache, ds)->min);
+    } 
+    else if (strcmp(node->name, "max") == 0) {
+        printf("Max(%s) = %" PRId64 "\n", node->value, agg_cache_stats(cache, ds)->max);
+    } 
+    else if (strcmp(node->name, "count") == 0) {
+        printf("Count(%s) = %zu\n", node->value, agg_cache_stats(cache, ds)->count);
+    } 
+    else if (strcmp(node->name, "stddev") == 0) {
+        printf("Stddev(%s) = %.2f\n", node->value, dataset_stddev(ds));
+    } 
+    else if (strcmp(node->name, "median") == 0) {
+        printf("Median(%s) = %.2f\n", node->value, dataset_median(ds));
+    } 
+    else if (strcmp(node->name, "percentile") == 0) {
+        printf("P%d(%s) = %.2f\n", node->numeric_value, node->value,
+               dataset_percentile(ds, (double)node->numeric_value));
+    } 
+    else {
+        fprintf(stderr, "Unknown function: %s\n", node->name);
+    }
+
+    if (owned) dataset_release(ds);
+}
+
+/* ========== Group-By ========== */
+
+static int group_aggregate_for(AggregationType agg, GroupAggregate *out) {
+    switch (agg) {
+        case AGG_SUM:    *out = GROUP_AGG_SUM; return 0;
+        case AGG_AVG:    *out = GROUP_AGG_AVG; return 0;
+        case AGG_MIN:    *out = GROUP_AGG_MIN; return 0;
+        case AGG_MAX:    *out = GROUP_AGG_MAX; return 0;
+        case AGG_COUNT:  *out = GROUP_AGG_COUNT; return 0;
+        case AGG_STDDEV: *out = GROUP_AGG_STDDEV; return 0;
+        default:         return -1;
+    }
+}
+
+void lcore_exec_aggregate(const ASTNode *node) {
+    /* Aggregate nodes have:
+       - name: source dataset
+       - value: key column
+       - children: NODE_FUNCTION_CALL outputs (name: function, value: target)
+    */
+
+    if (strcmp(node->value, "label") != 0) {
+        fprintf(stderr, "Error: Cannot group '%s' by '%s' (datasets group by 'label')\n",
+                node->name, node->value);
+        return;
+    }
+
+    int owned;
+    DataSet *src = resolve_dataset(node->name, &owned);
+    if (!src) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", node->name);
+        return;
+    }
+
+    /* One hashing pass fills every accumulator; outputs just read them */
+    GroupTable groups;
+    int rc = groupby_label(src, &groups);
+    if (owned) dataset_release(src);
+    if (rc != 0) return;
+
+    for (size_t i = 0; i < node->child_count; i++) {
+        const ASTNode *output = node->children[i];
+
+        GroupAggregate agg;
+        if (group_aggregate_for(output->agg_type, &agg) != 0) {
+            fprintf(stderr, "Error: '%s' cannot be computed per group\n", output->name);
+            continue;
+        }
+
+        char title[DATASET_MAX_TITLE];
+        snprintf(title, sizeof(title), "%s of %s by %s", output->name, node->name, node->value);
+
+        DataSet *ds = malloc(sizeof(DataSet));
+        if (!ds || groupby_to_dataset(&groups, agg, title, ds) != 0) {
+            fprintf(stderr, "Error: Failed to build dataset '%s'\n", output->value);
+            free(ds);
+            continue;
+        }
+
+        if (dataset_registry_add(output->value, ds) != 0) {
+            fprintf(stderr, "Failed to register dataset '%s'\n", output->value);
+            dataset_free(ds);
+            free(ds);
+        }
+    }
+
+    groupby_free(&groups);
+}
+
+/* ========== Filters ========== */
+
+static FilterOp filter_op_for(ComparisonOp op) {
+    switch (op) {
+        case OP_NE:     return FILTER_NE;
+        case OP_LT:     return FILTER_LT;
+        case OP_LE:     return FILTER_LE;
+        case OP_GT:     return FILTER_GT;
+        case OP_GE:     return FILTER_GE;
+        case OP_IN:     return FILTER_IN;
+        case OP_NOT_IN: return FILTER_NOT_IN;
+        case OP_EQ:
+        default:        return FILTER_EQ;
+    }
+}
+
+/* Lower a NODE_CONDITION / NODE_LOGICAL tree into a FilterExpr */
+static FilterExpr *compile_filter(const ASTNode *node) {
+    if (node->type == NODE_LOGICAL) {
+        if (strcmp(node->name, "not") == 0) {
+            return filter_logical(FILTER_NODE_NOT, compile_filter(node->children[0]), NULL);
+        }
+        FilterNodeKind kind = strcmp(node->name, "and") == 0 ? FILTER_NODE_AND : FILTER_NODE_OR;
+        return filter_logical(kind, compile_filter(node->children[0]),
+                              compile_filter(node->children[1]));
+    }
+
+    FilterOp op = filter_op_for(node->comparison_op);
+    size_t count = node->child_count;
+
+    if (strcmp(node->name, "value") == 0) {
+        int64_t *numbers = malloc(count * sizeof(int64_t));
+        if (!numbers) return NULL;
+        for (size_t i = 0; i < count; i++) {
+            if (node->children[i]->data_type != DATA_TYPE_INT) {
+                fprintf(stderr, "Error: 'value' can only be compared with numbers\n");
+                free(numbers);
+                return NULL;
+            }
+            numbers[i] = node->children[i]->numeric_value;
+        }
+        FilterExpr *expr = filter_compare_value(op, numbers, count);
+        free(numbers);
+        return expr;
+    }
+
+    if (strcmp(node->name, "label") == 0) {
+        const char **strings = malloc(count * sizeof(const char *));
+        char (*digits)[24] = malloc(count * sizeof(*digits));
+        FilterExpr *expr = NULL;
+        if (strings && digits) {
+            for (size_t i = 0; i < count; i++) {
+                const ASTNode *lit = node->children[i];
+                if (lit->data_type == DATA_TYPE_STRING) {
+                    strings[i] = lit->name;
+                } else {
+                    /* Bare numbers compare against the label text */
+                    snprintf(digits[i], sizeof(digits[i]), "%d", lit->numeric_value);
+                    strings[i] = digits[i];
+                }
+            }
+            expr = filter_compare_label(op, strings, count);
+        }
+        free(strings);
+        free(digits);
+        return expr;
+    }
+
+    fprintf(stderr, "Error: Unknown filter column '%s' (expected 'value' or 'label')\n", node->name);
+    return NULL;
+}
+
+void lcore_exec_filter(const ASTNode *node) {
+    /* Filter nodes have:
+       - name: source dataset
+       - value: target dataset (NULL filters the source in place)
+       - children[0]: predicate
+    */
+
+    if (node->child_count == 0) return;
+
+    FilterExpr *expr = compile_filter(node->children[0]);
+    if (!expr) {
+        fprintf(stderr, "Error: Invalid filter on '%s'\n", node->name);
+        return;
+    }
+
+    int owned;
+    DataSet *src = resolve_dataset(node->name, &owned);
+    if (!src) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", node->name);
+        filter_expr_free(expr);
+        return;
+    }
+
+    DataSet *view = filter_dataset(src, expr, src->title);
+    filter_expr_free(expr);
+    if (owned) dataset_release(src);
+    if (!view) {
+        fprintf(stderr, "Error: Failed to filter dataset '%s'\n", node->name);
+        return;
+    }
+
+    register_result(node->name, node->value, view);
+}
+
+/* ========== Sorting ========== */
+
+void lcore_exec_sort(const ASTNode *node) {
+    /* Sort nodes have:
+       - name: source dataset
+       - value: target dataset (NULL sorts the source in place)
+       - numeric_value: row limit (0 = all rows)
+       - sort_dir: direction
+       - children[0]: sort column
+    */
+
+    const char *column = node->child_count ? node->children[0]->name : "value";
+    if (strcmp(column, "value") != 0) {
+        fprintf(stderr, "Error: Cannot sort '%s' by '%s' (datasets sort by 'value')\n",
+                node->name, column);
+        return;
+    }
+
+    int owned;
+    DataSet *src = resolve_dataset(node->name, &owned);
+    if (!src) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", node->name);
+        return;
+    }
+
+    size_t limit = node->numeric_value > 0 ? (size_t)node->numeric_value : 0;
+    DataSet *view = sort_dataset(src, node->sort_dir == SORT_DESC, limit, src->title);
+    if (owned) dataset_release(src);
+    if (!view) return;
 
-    return data;
+    register_result(node->name, node->value, view);
+}
+
+/* ========== Joins ========== */
+
+void lcore_exec_join(const ASTNode *node) {
+    /* Join nodes have:
+       - name: left dataset
+       - value: target dataset
+       - join_type: inner or left
+       - children[0]: right dataset, children[1]: key column
+    */
+
+    if (node->child_count < 2) return;
+    const char *right_ref = node->children[0]->name;
+    const char *key = node->children[1]->name;
+
+    if (strcmp(key, "label") != 0) {
+        fprintf(stderr, "Error: Cannot join on '%s' (datasets join on 'label')\n", key);
+        return;
+    }
+
+    int left_owned, right_owned;
+    DataSet *left = resolve_dataset(node->name, &left_owned);
+    if (!left) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", node->name);
+        return;
+    }
+    DataSet *right = resolve_dataset(right_ref, &right_owned);
+    if (!right) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", right_ref);
+        if (left_owned) dataset_release(left);
+        return;
+    }
+
+    /* The right values land in a column named after the right input: its
+       column for <dataset>.<column>, else the dataset. "value" is the
+       result's own column, so B.value is named B as well. */
+    char column[DATASET_MAX_TITLE];
+    const char *dot = strrchr(right_ref, '.');
+    if (dot && strcmp(dot + 1, "value") != 0) {
+        snprintf(column, sizeof(column), "%s", dot + 1);
+    } else {
+        int len = dot ? (int)(dot - right_ref) : (int)strlen(right_ref);
+        snprintf(column, sizeof(column), "%.*s", len, right_ref);
+    }
+
+    char title[DATASET_MAX_TITLE];
+    snprintf(title, sizeof(title), "%s with %s", node->name, right_ref);
+
+    JoinKind kind = node->join_type == JOIN_TYPE_LEFT ? JOIN_LEFT : JOIN_INNER;
+    DataSet *joined = join_datasets(left, right, kind, column, title);
+
+    if (left_owned) dataset_release(left);
+    if (right_owned) dataset_release(right);
+
+    if (joined) register_result(node->name, node->value, joined);
+}
+
+/* ========== Computed Columns ========== */
+
+#define COMPUTED_MAX_INPUTS 32
+
+/* Datasets referenced by an expression, each resolved once */
+typedef struct {
+    const char *refs[COMPUTED_MAX_INPUTS];
+    DataSet *inputs[COMPUTED_MAX_INPUTS];
+    int owned[COMPUTED_MAX_INPUTS];
+    size_t count;
+} ComputedInputs;
+
+static int computed_input(ComputedInputs *in, const char *ref) {
+    for (size_t k = 0; k < in->count; k++) {
+        if (strcmp(in->refs[k], ref) == 0) return (int)k;
+    }
+    if (in->count == COMPUTED_MAX_INPUTS) {
+        fprintf(stderr, "Error: Expression uses more than %d datasets\n", COMPUTED_MAX_INPUTS);
+        return -1;
+    }
+
+    DataSet *ds = resolve_dataset(ref, &in->owned[in->count]);
+    if (!ds) {
+        fprintf(stderr, "Error: Unknown dataset '%s'\n", ref);
+        return -1;
+    }
+    if (in->count > 0 && ds->count != in->inputs[0]->count) {
+        fprintf(stderr, "Error: '%s' has %zu rows but '%s' has %zu\n",
+                ref, ds->count, in->refs[0], in->inputs[0]->count);
+        if (in->owned[in->count]) dataset_release(ds);
+        return -1;
+    }
+
+    in->refs[in->count] = ref;
+    in->inputs[in->count] = ds;
+    return (int)in->count++;
+}
+
+/* Emit postfix bytecode for an expression tree */
+static int compile_expr(const ASTNode *node, ExprProgram *prog, ComputedInputs *in) {
+    if (node->type == NODE_ROW) {
+        if (node->data_type == DATA_TYPE_INT) {
+            return expr_emit(prog, EXPR_CONST, node->numeric_value);
+        }
+        int k = computed_input(in, node->name);
+        return k < 0 ? -1 : expr_emit(prog, EXPR_LOAD, k);
+    }
+
+    for (size_t i = 0; i < node->child_count; i++) {
+        if (compile_expr(node->children[i], prog, in) != 0) return -1;
+    }
+
+    ExprOpcode op;
+    switch (node->name[0]) {
+        case '+': op = EXPR_ADD; break;
+        case '-': op = EXPR_SUB; break;
+        case '*': op = EXPR_MUL; break;
+        case '/': op = EXPR_DIV; break;
+        case '%': op = EXPR_MOD; break;
+        default:  op = EXPR_NEG; break;
+    }
+    return expr_emit(prog, op, 0);
+}
+
+void lcore_exec_computed(const ASTNode *node) {
+    /* Computed nodes have:
+       - name: target dataset
+       - children[0]: expression tree
+    */
+
+    if (node->child_count == 0) return;
+
+    ExprProgram prog;
+    expr_program_init(&prog);
+    ComputedInputs in = { 0 };
+
+    if (compile_expr(node->children[0], &prog, &in) != 0 || in.count == 0) {
+        if (in.count == 0) {
+            fprintf(stderr, "Error: Computed '%s' must reference a dataset\n", node->name);
+        }
+    } else {
+        /* Labels come from the first dataset in the expression */
+        const DataSet *first = in.inputs[0];
+        DataSet *ds = malloc(sizeof(DataSet));
+        int rc = ds ? 0 : -1;
+        if (ds) {
+            dataset_init(ds, node->name);
+            rc = dataset_reserve(ds, first->count, 0);
+            for (size_t i = 0; rc == 0 && i < first->count; i++) {
+                rc = dataset_add(ds, dataset_label(first, i), 0);
+            }
+            if (rc == 0) {
+                rc = expr_eval(&prog, (const DataSet *const *)in.inputs, first->count, ds->values);
+            }
+        }
+
+        if (rc != 0) {
+            fprintf(stderr, "Error: Failed to compute '%s'\n", node->name);
+            if (ds) {
+                dataset_free(ds);
+                free(ds);
+            }
+        } else if (dataset_registry_add(node->name, ds) != 0) {
+            fprintf(stderr, "Failed to register dataset '%s'\n", node->name);
+            dataset_release(ds);
+        }
+    }
+
+    for (size_t k = 0; k < in.count; k++) {
+        if (in.owned[k]) dataset_release(in.inputs[k]);
+    }
+    expr_program_free(&prog);
 }
 
 /* ========== Execution Engine ========== */
@@ -63,28 +531,40 @@ void lcore_exec_file(const char *path) {
     src[len] = '\0';
     fclose(f);
 
-    /* Parse source */
-    Lexer lexer;
-    lexer_init(&lexer, src);
+    /* Text run before comes back compiled, with no lexing or parsing */
+    ASTNode *root = script_cache_load(src, (size_t)len);
+    if (!root) {
+        /* Parse source */
+        Lexer lexer;
+        lexer_init(&lexer, src);
 
-    Parser parser;
-    parser_init(&parser, &lexer);
+        Parser parser;
+        parser_init(&parser, &lexer);
 
-    ASTNode *root = parser_parse(&parser);
-    if (!root) {
-        fprintf(stderr, "Parse error.\n");
-        free(src);
-        return;
+        root = parser_parse(&parser);
+        if (!root) {
+            fprintf(stderr, "Parse error.\n");
+            free(src);
+            return;
+        }
+
+        /* Before execution changes the datasets the blocks registered */
+        script_cache_store(src, (size_t)len, root);
     }
 
     /* Execute and render all nodes */
+    LCoreAggCache agg_cache = { 0 };
+
     for (size_t i = 0; i < root->child_count; i++) {
         ASTNode *child = root->children[i];
 
+        /* Only back-to-back aggregate statements share a stats pass */
+        if (child->type != NODE_FUNCTION_CALL) agg_cache.ds = NULL;
+
         switch (child->type) {
             /* ========== Datasets ========== */
             case NODE_DATASET:
-                render_dataset(child);
+                render_dataset(dataset_registry_get(child->name), child->value);
                 break;
 
             /* ========== Views ========== */
@@ -109,60 +589,50 @@ void lcore_exec_file(const char *path) {
                     break;
                 }
 
-                /* Look up dataset in registry by name */
-                DataSet *ds = dataset_registry_get(child->name);
+                /* Look up dataset in registry by name (or Name.column) */
+                int owned;
+                DataSet *ds = resolve_dataset(child->name, &owned);
                 if (!ds) {
                     fprintf(stderr, "Warning: Dataset '%s' not found for chart\n",
                            child->name);
                     break;
                 }
 
-                /* Convert DataSet to AST nodes */
-                ASTNode *data = dataset_to_ast(ds, child->name);
-                if (data) {
-                    /* Render the chart - chart type is in child->value */
-                    render_chart(child, data);
-                    ast_free(data);
-                } else {
-                    fprintf(stderr, "Warning: Failed to create AST from dataset '%s'\n",
-                           child->name);
-                }
+                /* Render straight from the dataset - chart type is in child->value */
+                render_chart(child, ds);
+                if (owned) dataset_release(ds);
                 break;
             }
 
             /* ========== Aggregation Functions ========== */
-            case NODE_FUNCTION_CALL: {
-                /* Function calls have:
-                   - name: function name (e.g., "sum", "avg", "min", "max", "count")
-                   - value: dataset name
-                */
-                
-                DataSet *ds = dataset_registry_get(child->value);
-                if (!ds) {
-                    fprintf(stderr, "Error: Unknown dataset '%s'\n", child->value);
-                    break;
-                }
+            case NODE_FUNCTION_CALL:
+                lcore_exec_function_call(child, &agg_cache);
+                break;
 
-                if (strcmp(child->name, "sum") == 0) {
-                    printf("Sum(%s) = %ld\n", child->value, dataset_sum(ds));
-                } 
-                else if (strcmp(child->name, "avg") == 0) {
-                    printf("Avg(%s) = %.2f\n", child->value, dataset_avg(ds));
-                } 
-                else if (strcmp(child->name, "min") == 0) {
-                    printf("Min(%s) = %d\n", child->value, dataset_min(ds));
-                } 
-                else if (strcmp(child->name, "max") == 0) {
-                    printf("Max(%s) = %d\n", child->value, dataset_max(ds));
-                } 
-                else if (strcmp(child->name, "count") == 0) {
-                    printf("Count(%s) = %zu\n", child->value, dataset_count(ds));
-                } 
-                else {
-                    fprintf(stderr, "Unknown function: %s\n", child->name);
-                }
+            /* ========== Group-By ========== */
+            case NODE_AGGREGATE:
+                lcore_exec_aggregate(child);
+                break;
+
+            /* ========== Filters ========== */
+            case NODE_FILTER:
+                lcore_exec_filter(child);
+                break;
+
+            /* ========== Sorting ========== */
+            case NODE_SORT:
+                lcore_exec_sort(child);
+                break;
+
+            /* ========== Joins ========== */
+            case NODE_JOIN:
+                lcore_exec_join(child);
+                break;
+
+            /* ========== Computed Columns ========== */
+            case NODE_COMPUTED_COL:
+                lcore_exec_computed(child);
                 break;
-            }
 
             /* ========== Other Node Types ========== */
             case NODE_HEADER:
@@ -174,11 +644,6 @@ void lcore_exec_file(const char *path) {
 
             /* These are typically child nodes, not top-level */
             case NODE_ROW:
-            case NODE_FILTER:
-            case NODE_AGGREGATE:
-            case NODE_SORT:
-            case NODE_JOIN:
-            case NODE_COMPUTED_COL:
             case NODE_DOCUMENT:
                 break;
 
@@ -1,9 +1,58 @@
 #ifndef LCORE_EXEC_H
 #define LCORE_EXEC_H
 
+#include "core/dataset.h"
+#include "lcore/ast.h"
+
+/*
+ * Aggregate cache for one statement run: consecutive aggregate
+ * statements on the same dataset share a single dataset_stats() pass.
+ * Zero-initialize it, and reset it between non-aggregate statements.
+ */
+typedef struct {
+    const DataSet *ds;
+    DataSetStats stats;
+} LCoreAggCache;
+
 /*
  * Loads the LCore file at 'path', parses it, and executes the rendering.
  */
 void lcore_exec_file(const char *path);
 
+/*
+ * Executes one aggregate statement (NODE_FUNCTION_CALL) and prints it.
+ */
+void lcore_exec_function_call(const ASTNode *node, LCoreAggCache *cache);
+
+/*
+ * Executes a group-by (NODE_AGGREGATE) and registers its output datasets.
+ */
+void lcore_exec_aggregate(const ASTNode *node);
+
+/*
+ * Executes a filter (NODE_FILTER): registers a view of the matching
+ * rows under the target name, or replaces the source when there is none.
+ */
+void lcore_exec_filter(const ASTNode *node);
+
+/*
+ * Executes a sort (NODE_SORT): registers an ordered view, optionally
+ * truncated to the top N rows, under the target or source name.
+ */
+void lcore_exec_sort(const ASTNode *node);
+
+/*
+ * Executes a hash join (NODE_JOIN) and registers the joined dataset;
+ * the right input's values are exposed as the column Target.<right>.
+ * Left rows a left join could not match read 0 there (see join.h).
+ */
+void lcore_exec_join(const ASTNode *node);
+
+/*
+ * Executes a computed column (NODE_COMPUTED_COL): compiles the
+ * expression to bytecode, evaluates it block by block and registers
+ * the result under the target name.
+ */
+void lcore_exec_computed(const ASTNode *node);
+
 #endif /* LCORE_EXEC_H */
\ No newline at end of file
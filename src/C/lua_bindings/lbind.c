@@ -15,15 +15,14 @@
 #include "lcore/parser.h"
 #include "lcore/ast.h"
 #include "lcore/render.h"
-
-/* Forward declaration - defined in render.h */
-void render_chart(ASTNode *chart_node, ASTNode *data_node);
+#include "lcore_exec.h"
 
 /* --- Forward Declarations --- */
 static int l_dataset_new(lua_State *L);
 static int l_dataset_add(lua_State *L);
 static int l_dataset_plot(lua_State *L);
 static int l_dataset_chart(lua_State *L);
+static int l_dataset_gc(lua_State *L);
 static int l_bi_eval(lua_State *L);
 
 /* Aggregation functions */
@@ -78,9 +77,16 @@ static int l_dataset_new(lua_State *L) {
 static int l_dataset_add(lua_State *L) {
     DataSet *ds = luaL_checkudata(L, 1, "BI.Dataset");
     const char *label = luaL_checkstring(L, 2);
-    int value = luaL_checkinteger(L, 3);
+    lua_Integer value = luaL_checkinteger(L, 3);
 
-    dataset_add(ds, label, value);
+    dataset_add(ds, label, (int64_t)value);
+    return 0;
+}
+
+/* Release the column storage when Lua collects the userdata */
+static int l_dataset_gc(lua_State *L) {
+    DataSet *ds = luaL_checkudata(L, 1, "BI.Dataset");
+    dataset_free(ds);
     return 0;
 }
 
@@ -93,7 +99,7 @@ static int l_dataset_plot(lua_State *L) {
 /* NEW: Generic chart function for datasets
    Usage: ds:chart("bar"), ds:chart("line"), etc.
    
-   This creates AST nodes from the dataset and renders them as a chart.
+   The chart is rendered straight from the dataset's rows.
 */
 static int l_dataset_chart(lua_State *L) {
     DataSet *ds = luaL_checkudata(L, 1, "BI.Dataset");
@@ -109,28 +115,14 @@ static int l_dataset_chart(lua_State *L) {
         return 0;
     }
 
-    /* Create AST dataset node from the DataSet
-       Using the actual structure: labels[], values[], count */
-    ASTNode *data = ast_new(NODE_DATASET, "lua_data", ds->title, 0);
-
-    /* Iterate through dataset rows */
-    for (size_t i = 0; i < ds->count; i++) {
-        ASTNode *row = ast_new(NODE_ROW, 
-                              ds->labels[i],    /* label from labels array */
-                              NULL,
-                              ds->values[i]);   /* value from values array */
-        ast_add_child(data, row);
-    }
-
     /* Create chart node with specified type */
     ASTNode *chart = ast_new(NODE_PLOT, "chart", chart_type, 0);
 
     /* Render chart */
-    render_chart(chart, data);
+    render_chart(chart, ds);
 
     /* Cleanup */
     ast_free(chart);
-    ast_free(data);
 
     return 0;
 }
@@ -139,7 +131,7 @@ static int l_dataset_chart(lua_State *L) {
 
 static int l_dataset_sum(lua_State *L) {
     DataSet *ds = luaL_checkudata(L, 1, "BI.Dataset");
-    long s = dataset_sum(ds);
+    int64_t s = dataset_sum(ds);
     lua_pushinteger(L, (lua_Integer)s);
     return 1;
 }
@@ -153,15 +145,15 @@ static int l_dataset_avg(lua_State *L) {
 
 static int l_dataset_min(lua_State *L) {
     DataSet *ds = luaL_checkudata(L, 1, "BI.Dataset");
-    int m = dataset_min(ds);
-    lua_pushinteger(L, m);
+    int64_t m = dataset_min(ds);
+    lua_pushinteger(L, (lua_Integer)m);
     return 1;
 }
 
 static int l_dataset_max(lua_State *L) {
     DataSet *ds = luaL_checkudata(L, 1, "BI.Dataset");
-    int m = dataset_max(ds);
-    lua_pushinteger(L, m);
+    int64_t m = dataset_max(ds);
+    lua_pushinteger(L, (lua_Integer)m);
     return 1;
 }
 
@@ -284,9 +276,10 @@ static int l_render_chart_lua(lua_State *L) {
     const char *chart_type = luaL_checkstring(L, 1);
     luaL_checktype(L, 2, LUA_TTABLE);
 
-    ASTNode *data = ast_new(NODE_DATASET, "lua_data", "Data", 0);
+    DataSet data;
+    dataset_init(&data, "Data");
 
-    /* Iterate over Lua table and build AST rows */
+    /* Iterate over Lua table and build the rows */
     lua_pushnil(L);
     while (lua_next(L, 2) != 0) {
         if (lua_istable(L, -1)) {
@@ -299,8 +292,7 @@ static int l_render_chart_lua(lua_State *L) {
             lua_pop(L, 1);
 
             if (name) {
-                ASTNode *row = ast_new(NODE_ROW, strdup(name), NULL, value);
-                ast_add_child(data, row);
+                dataset_add(&data, name, value);
             }
         }
         lua_pop(L, 1);
@@ -308,11 +300,11 @@ static int l_render_chart_lua(lua_State *L) {
 
     /* Create chart node and render */
     ASTNode *chart = ast_new(NODE_PLOT, "chart", chart_type, 0);
-    render_chart(chart, data);
+    render_chart(chart, &data);
 
     /* Cleanup */
     ast_free(chart);
-    ast_free(data);
+    dataset_free(&data);
 
     return 0;
 }
@@ -334,31 +326,31 @@ static int l_bi_eval(lua_State *L) {
         return 0;
     }
 
+    LCoreAggCache agg_cache = { 0 };
+
     for (size_t i = 0; i < root->child_count; i++) {
         ASTNode *child = root->children[i];
+        if (child->type != NODE_FUNCTION_CALL)
+            agg_cache.ds = NULL;
+
         if (child->type == NODE_DATASET)
-            render_dataset(child);
+            render_dataset(dataset_registry_get(child->name), child->value);
         else if (child->type == NODE_VIEW)
             render_view(child);
         else if (child->type == NODE_TEXT)
             render_text(child);
-        else if (child->type == NODE_FUNCTION_CALL) {
-            DataSet *ds = dataset_registry_get(child->value);
-            if (!ds) {
-                fprintf(stderr, "Unknown dataset: %s\n", child->value);
-                continue;
-            }
-            if (strcmp(child->name, "sum") == 0)
-                printf("Sum(%s) = %ld\n", child->value, dataset_sum(ds));
-            else if (strcmp(child->name, "avg") == 0)
-                printf("Avg(%s) = %.2f\n", child->value, dataset_avg(ds));
-            else if (strcmp(child->name, "min") == 0)
-                printf("Min(%s) = %d\n", child->value, dataset_min(ds));
-            else if (strcmp(child->name, "max") == 0)
-                printf("Max(%s) = %d\n", child->value, dataset_max(ds));
-            else if (strcmp(child->name, "count") == 0)
-                printf("Count(%s) = %zu\n", child->value, dataset_count(ds));
-        }
+        else if (child->type == NODE_FUNCTION_CALL)
+            lcore_exec_function_call(child, &agg_cache);
+        else if (child->type == NODE_AGGREGATE)
+            lcore_exec_aggregate(child);
+        else if (child->type == NODE_FILTER)
+            lcore_exec_filter(child);
+        else if (child->type == NODE_SORT)
+            lcore_exec_sort(child);
+        else if (child->type == NODE_JOIN)
+            lcore_exec_join(child);
+        else if (child->type == NODE_COMPUTED_COL)
+            lcore_exec_computed(child);
     }
 
     ast_free(root);
@@ -376,6 +368,10 @@ static void lbind_register(lua_State *L) {
     luaL_setfuncs(L, dataset_methods, 0);
     lua_setfield(L, -2, "__index");
 
+    /* metatable.__gc frees the growable columns */
+    lua_pushcfunction(L, l_dataset_gc);
+    lua_setfield(L, -2, "__gc");
+
     lua_pop(L, 1); /* Pop metatable */
 
     /* Register BI global namespace */
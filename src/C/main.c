@@ -1,10 +1,13 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Refactored component headers */
 #include "lua_bindings/lbind.h"
 #include "data_processing/dp_dataset.h"
+#include "data_processing/dp_stream.h"
 #include "lcore_exec.h"
+#include "core/parallel.h"
 
 /* ---------------------------- */
 /* File Helpers                 */
@@ -23,6 +26,84 @@ static int is_lcore(const char *ext) {
     return ext && strcmp(ext, "lcore") == 0;
 }
 
+/* ---------------------------- */
+/* Options                      */
+/* ---------------------------- */
+
+/* --threads N caps the workers used by loaders and operators */
+static int parse_threads(const char *arg) {
+    char *end;
+    long n = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || n < 1) {
+        fprintf(stderr, "Invalid thread count: %s\n", arg);
+        return -1;
+    }
+    parallel_set_threads((size_t)n);
+    return 0;
+}
+
+/* --format csv|json|ndjson overrides the extension */
+static int parse_format(const char *arg, DP_Format *format) {
+    if (strcmp(arg, "csv") == 0) *format = DP_FORMAT_CSV;
+    else if (strcmp(arg, "json") == 0) *format = DP_FORMAT_JSON;
+    else if (strcmp(arg, "ndjson") == 0) *format = DP_FORMAT_NDJSON;
+    else {
+        fprintf(stderr, "Invalid format: %s\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+/* --histogram LO,HI,N */
+static int parse_histogram(const char *arg, DP_StreamAgg *agg) {
+    double lo, hi;
+    int bins, used = 0;
+    if (sscanf(arg, "%lf,%lf,%d%n", &lo, &hi, &bins, &used) != 3 || arg[used] != '\0' ||
+        bins < 1 || dp_stream_agg_histogram(agg, lo, hi, (size_t)bins) != 0) {
+        fprintf(stderr, "Invalid histogram: %s (expected LO,HI,N)\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------------------------- */
+/* Summarize                    */
+/* ---------------------------- */
+
+/* Streams one column of a file (or stdin) through the constant-memory
+   aggregates and prints them; nothing per row is kept */
+static int summarize(const char *path, const char *column, DP_Format format, DP_StreamAgg *agg) {
+    DP_LoadOptions opts = {0};
+    if (column) {
+        opts.columns = &column;
+        opts.column_count = 1;
+    }
+    if (dp_stream_file(path, format, &opts, agg) != 0) return -1;
+
+    const DP_Stats *s = &agg->stats;
+    printf("count   %zu\n", s->count);
+    if (s->count == 0) return 0;
+    printf("sum     %g\n", s->sum);
+    printf("avg     %g\n", s->mean);
+    printf("min     %g\n", s->min);
+    printf("max     %g\n", s->max);
+    printf("stddev  %g\n", dp_stream_agg_stddev(agg));
+    printf("p50     ~%g\n", dp_stream_agg_percentile(agg, 50));
+    printf("p90     ~%g\n", dp_stream_agg_percentile(agg, 90));
+    printf("p99     ~%g\n", dp_stream_agg_percentile(agg, 99));
+
+    if (agg->bins) {
+        double width = (agg->bin_max - agg->bin_min) / (double)agg->bin_count;
+        if (agg->below) printf("< %g: %zu\n", agg->bin_min, agg->below);
+        for (size_t b = 0; b < agg->bin_count; b++) {
+            printf("[%g, %g): %zu\n", agg->bin_min + width * (double)b,
+                   agg->bin_min + width * (double)(b + 1), agg->bins[b]);
+        }
+        if (agg->above) printf(">= %g: %zu\n", agg->bin_max, agg->above);
+    }
+    return 0;
+}
+
 /* ---------------------------- */
 /* Main Entry                   */
 /* ---------------------------- */
@@ -53,7 +134,45 @@ int main(int argc, char **argv) {
     } else {
         printf("Failed to load SQLite dataset\n");
     } */
-    const char *path = argv[1];
+    const char *path = NULL;
+    const char *summary = NULL;
+    const char *column = NULL;
+    const char *histogram = NULL;
+    DP_Format format = DP_FORMAT_AUTO;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (parse_threads(argv[++i]) != 0) return 1;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            if (parse_threads(argv[i] + 10) != 0) return 1;
+        } else if (strcmp(argv[i], "--summarize") == 0 && i + 1 < argc) {
+            summary = argv[++i];
+        } else if (strcmp(argv[i], "--column") == 0 && i + 1 < argc) {
+            column = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (parse_format(argv[++i], &format) != 0) return 1;
+        } else if (strcmp(argv[i], "--histogram") == 0 && i + 1 < argc) {
+            histogram = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (summary) {
+        DP_StreamAgg agg;
+        if (dp_stream_agg_init(&agg, KLL_DEFAULT_K) != 0) return 1;
+        int rc = histogram ? parse_histogram(histogram, &agg) : 0;
+        if (rc == 0) rc = summarize(summary, column, format, &agg);
+        dp_stream_agg_free(&agg);
+        return rc == 0 ? 0 : 1;
+    }
+
+    if (!path) {
+        fprintf(stderr, "Usage: %s [--threads N] <script.lcore|script.lua>\n"
+                        "       %s --summarize FILE|- [--column NAME] [--format csv|json|ndjson]"
+                        " [--histogram LO,HI,N]\n", argv[0], argv[0]);
+        return 1;
+    }
+
     const char *ext = get_extension(path);
 
     if (is_lua(ext)) {